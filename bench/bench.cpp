@@ -0,0 +1,521 @@
+//
+// Created by zzy on 12/17/23.
+//
+// Throughput of every parse mode on synthetic corpora: GB/s, documents/s,
+// cycles per byte and heap allocations per document. The corpora come from a
+// seeded generator, so every run and every machine parses the same bytes.
+//
+//   bench [--mb N] [--repeat N] [--kernel NAME] [--filter TEXT] [--scaling]
+//         [FILE...]
+//
+// Files given on the command line are measured next to the corpora, a
+// .ndjson file as a stream of documents. --scaling measures one deeply nested
+// and one wide document at growing sizes instead: the cycles per byte stay
+// flat as long as building the tree is linear in the input.
+#include <simdjson/json.h>
+#include <x86intrin.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::atomic<size_t> allocations{0};
+
+void* counted_alloc(size_t size, size_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = alignment <= alignof(std::max_align_t)
+                ? std::malloc(size == 0 ? 1 : size)
+                : std::aligned_alloc(alignment,
+                                     (size + alignment - 1) / alignment *
+                                         alignment);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+}  // namespace
+
+// every allocation of the process, the library included, goes through here
+void* operator new(size_t size) {
+  return counted_alloc(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size) {
+  return counted_alloc(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  return counted_alloc(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return counted_alloc(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+// splitmix64: the same sequence with every standard library, unlike the
+// distributions of <random>
+class corpus_generator {
+ public:
+  explicit corpus_generator(uint64_t seed) : _state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+  uint64_t below(uint64_t bound) { return next() % bound; }
+
+  // an object of the kind services exchange: short keys, ids, names,
+  // flags, a few numbers and a nested object and array
+  void record(std::string& out, uint64_t id) {
+    out += "{\"id\":";
+    out += std::to_string(id);
+    out += ",\"name\":\"";
+    word(out, 4 + below(12));
+    out += ' ';
+    word(out, 4 + below(12));
+    out += "\",\"email\":\"";
+    word(out, 6 + below(6));
+    out += "@example.com\",\"active\":";
+    out += below(2) ? "true" : "false";
+    out += ",\"score\":";
+    number(out);
+    out += ",\"tags\":[";
+    for (uint64_t i = 0, n = below(5); i < n; i++) {
+      out += i == 0 ? "\"" : ",\"";
+      word(out, 3 + below(8));
+      out += '"';
+    }
+    out += "],\"address\":{\"street\":\"";
+    word(out, 8 + below(10));
+    out += "\",\"zip\":";
+    out += std::to_string(10000 + below(90000));
+    out += ",\"note\":";
+    if (below(4) == 0) {
+      out += "null";
+    } else {
+      out += '"';
+      word(out, 10 + below(30));
+      out += '"';
+    }
+    out += "}}";
+  }
+  void word(std::string& out, uint64_t length) {
+    for (uint64_t i = 0; i < length; i++) {
+      out += static_cast<char>('a' + below(26));
+    }
+  }
+  // integers, decimals and exponents in turn
+  void number(std::string& out) {
+    switch (below(3)) {
+      case 0:
+        out += std::to_string(static_cast<int64_t>(next() >> 20) -
+                              (int64_t(1) << 43));
+        break;
+      case 1:
+        out += std::to_string(below(1000000));
+        out += '.';
+        out += std::to_string(below(1000000));
+        break;
+      default:
+        out += std::to_string(1 + below(9));
+        out += '.';
+        out += std::to_string(below(100000));
+        out += below(2) ? "e-" : "e+";
+        out += std::to_string(below(300));
+        break;
+    }
+  }
+  // text with escapes and multi-byte utf-8
+  void text(std::string& out, uint64_t length) {
+    static constexpr std::string_view kPieces[] = {
+        "plain ascii ", "\\\"quoted\\\" ", "line\\nbreak ", "tab\\there ",
+        "caf\xc3\xa9 ", "\xe4\xb8\xad\xe6\x96\x87 ", "\xf0\x9f\x98\x80 ",
+        "\\u00e9\\u4e2d ", "back\\\\slash "};
+    const size_t end = out.size() + length;
+    while (out.size() < end) {
+      out += kPieces[below(std::size(kPieces))];
+    }
+  }
+
+ private:
+  uint64_t _state;
+};
+
+constexpr uint64_t kSeed = 20231217;
+
+std::string records_corpus(size_t size) {
+  corpus_generator gen(kSeed);
+  std::string out = "[";
+  for (uint64_t id = 0; out.size() < size; id++) {
+    if (id != 0) {
+      out += ',';
+    }
+    gen.record(out, id);
+  }
+  out += ']';
+  return out;
+}
+
+std::string numbers_corpus(size_t size) {
+  corpus_generator gen(kSeed + 1);
+  std::string out = "[";
+  for (size_t row = 0; out.size() < size; row++) {
+    out += row == 0 ? "[" : ",[";
+    for (int i = 0; i < 16; i++) {
+      if (i != 0) {
+        out += ',';
+      }
+      gen.number(out);
+    }
+    out += ']';
+  }
+  out += ']';
+  return out;
+}
+
+std::string strings_corpus(size_t size) {
+  corpus_generator gen(kSeed + 2);
+  std::string out = "[";
+  for (size_t i = 0; out.size() < size; i++) {
+    out += i == 0 ? "\"" : ",\"";
+    gen.text(out, 16 + gen.below(240));
+    out += '"';
+  }
+  out += ']';
+  return out;
+}
+
+// objects and arrays in turn, 64 levels deep, with a few scalars per level
+std::string nested_corpus(size_t size) {
+  corpus_generator gen(kSeed + 3);
+  std::string out = "[";
+  for (size_t tree = 0; out.size() < size; tree++) {
+    if (tree != 0) {
+      out += ',';
+    }
+    constexpr int kDepth = 64;
+    for (int level = 0; level < kDepth; level++) {
+      if (level % 2 == 0) {
+        out += "{\"k\":";
+        out += std::to_string(gen.below(100));
+        out += ",\"v\":";
+      } else {
+        out += "[";
+        out += std::to_string(gen.below(100));
+        out += ",";
+      }
+    }
+    out += "null";
+    for (int level = kDepth - 1; level >= 0; level--) {
+      out += level % 2 == 0 ? '}' : ']';
+    }
+  }
+  out += ']';
+  return out;
+}
+
+std::string ndjson_corpus(size_t size) {
+  corpus_generator gen(kSeed + 4);
+  std::string out;
+  for (uint64_t id = 0; out.size() < size; id++) {
+    gen.record(out, id);
+    out += '\n';
+  }
+  return out;
+}
+
+// a single document `depth` levels deep, objects and arrays in turn, with a
+// scalar next to the child on every level
+std::string deep_corpus(size_t depth) {
+  corpus_generator gen(kSeed + 5);
+  std::string out;
+  for (size_t level = 0; level < depth; level++) {
+    if (level % 2 == 0) {
+      out += "{\"id\":";
+      out += std::to_string(gen.below(1000000));
+      out += ",\"child\":";
+    } else {
+      out += "[\"";
+      gen.word(out, 4 + gen.below(8));
+      out += "\",";
+    }
+  }
+  out += "null";
+  for (size_t level = depth; level-- > 0;) {
+    out += level % 2 == 0 ? '}' : ']';
+  }
+  return out;
+}
+
+// a single object of `members` distinct keys, with numbers, strings and
+// short arrays as values
+std::string wide_corpus(size_t members) {
+  corpus_generator gen(kSeed + 6);
+  std::string out = "{";
+  for (size_t i = 0; i < members; i++) {
+    out += i == 0 ? "\"" : ",\"";
+    gen.word(out, 4);
+    out += std::to_string(i);
+    out += "\":";
+    switch (i % 3) {
+      case 0:
+        gen.number(out);
+        break;
+      case 1:
+        out += '"';
+        gen.word(out, 4 + gen.below(12));
+        out += '"';
+        break;
+      default:
+        out += '[';
+        out += std::to_string(gen.below(100));
+        out += ',';
+        out += std::to_string(gen.below(100));
+        out += ']';
+        break;
+    }
+  }
+  out += '}';
+  return out;
+}
+
+struct workload {
+  std::string name;
+  simdjson::PaddedString json;
+  bool ndjson;
+  size_t max_depth = simdjson::kDefaultMaxDepth;
+};
+
+struct measurement {
+  double seconds;
+  uint64_t cycles;
+  size_t documents;
+  size_t allocations;
+};
+
+// the best of `repeat` runs after a warm-up one. `run` returns the number of
+// documents it parsed and keeps the result alive until it returns, so the
+// release of the tree is not timed.
+measurement measure(int repeat,
+                    const std::function<size_t(std::function<void()>)>& run) {
+  measurement best{1e30, 0, 0, 0};
+  for (int i = 0; i <= repeat; i++) {
+    std::chrono::steady_clock::time_point start;
+    double seconds = 0;
+    uint64_t cycles = 0;
+    size_t allocated = 0;
+    const size_t documents = run([&, first = true]() mutable {
+      // called once before and once after the parse
+      if (first) {
+        first = false;
+        allocated = allocations.load(std::memory_order_relaxed);
+        start = std::chrono::steady_clock::now();
+        cycles = __rdtsc();
+        return;
+      }
+      cycles = __rdtsc() - cycles;
+      seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+      allocated = allocations.load(std::memory_order_relaxed) - allocated;
+    });
+    if (i != 0 && seconds < best.seconds) {
+      best = {seconds, cycles, documents, allocated};
+    }
+  }
+  return best;
+}
+
+void report(const workload& w, std::string_view mode, const measurement& m) {
+  const double bytes = static_cast<double>(w.json.size());
+  std::printf("%-16.16s %-10s %9.2f %8.3f %12.0f %10.2f %12.1f\n",
+              w.name.c_str(), std::string(mode).c_str(), bytes / 1e6,
+              bytes / m.seconds / 1e9, m.documents / m.seconds,
+              static_cast<double>(m.cycles) / bytes,
+              static_cast<double>(m.allocations) / m.documents);
+}
+
+void run_single(const workload& w, int repeat) {
+  simdjson::JsonParser parser;
+  simdjson::JsonParseError error;
+  parser.set_max_depth(w.max_depth);
+  const std::string_view json = w.json.view();
+  report(w, "normal", measure(repeat, [&](auto mark) {
+           mark();
+           simdjson::Json result = parser.parse_normal_impl(json);
+           mark();
+           return size_t(1);
+         }));
+  report(w, "simd", measure(repeat, [&](auto mark) {
+           mark();
+           simdjson::Json result = parser.parse_simd_impl(json);
+           mark();
+           return size_t(1);
+         }));
+  report(w, "arena", measure(repeat, [&](auto mark) {
+           mark();
+           parser.parse_in_arena(json);
+           mark();
+           return size_t(1);
+         }));
+  report(w, "node", measure(repeat, [&](auto mark) {
+           mark();
+           simdjson::JsonNode result = parser.parse_node(json, error);
+           mark();
+           return size_t(1);
+         }));
+  report(w, "document", measure(repeat, [&](auto mark) {
+           mark();
+           parser.parse_document(w.json);
+           mark();
+           return size_t(1);
+         }));
+  if (parser.parse_document(w.json).is_error() || !error.empty()) {
+    std::fprintf(stderr, "%s does not parse\n", w.name.c_str());
+  }
+}
+
+void run_ndjson(const workload& w, int repeat) {
+  simdjson::JsonParser parser;
+  std::vector<simdjson::JsonDocument> documents;
+  report(w, "stream", measure(repeat, [&](auto mark) {
+           size_t count = 0;
+           mark();
+           auto stream = parser.parse_many(w.json);
+           for (auto it = stream.begin(); it != stream.end(); ++it) {
+             count++;
+           }
+           mark();
+           return count;
+         }));
+  report(w, "many", measure(repeat, [&](auto mark) {
+           mark();
+           const size_t count = parser.parse_many(w.json, documents);
+           mark();
+           return count;
+         }));
+  // four members of every record into typed columns, no tree is built
+  simdjson::JsonColumns columns;
+  columns.add_column("id", simdjson::JsonColumnType::INT64)
+      .add_column("name", simdjson::JsonColumnType::STRING)
+      .add_column("score", simdjson::JsonColumnType::DOUBLE)
+      .add_column("active", simdjson::JsonColumnType::BOOL);
+  report(w, "columns", measure(repeat, [&](auto mark) {
+           columns.clear();
+           mark();
+           const size_t count = parser.parse_columns(w.json, columns);
+           mark();
+           return count;
+         }));
+  if (columns.is_error()) {
+    std::fprintf(stderr, "%s: %s\n", w.name.c_str(),
+                 columns.get_error().c_str());
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t megabytes = 16;
+  int repeat = 10;
+  std::string filter;
+  bool scaling = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (arg == "--mb" && i + 1 < argc) {
+      megabytes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      repeat = std::atoi(argv[++i]);
+    } else if (arg == "--kernel" && i + 1 < argc) {
+      if (!simdjson::force_kernel(argv[++i])) {
+        std::fprintf(stderr, "kernel %s is not available\n", argv[i]);
+        return 1;
+      }
+    } else if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--scaling") {
+      scaling = true;
+    } else if (arg.starts_with("--")) {
+      std::fprintf(stderr,
+                   "usage: %s [--mb N] [--repeat N] [--kernel NAME] "
+                   "[--filter TEXT] [--scaling] [FILE...]\n",
+                   argv[0]);
+      return 1;
+    } else {
+      files.emplace_back(arg);
+    }
+  }
+  repeat = std::max(repeat, 1);
+
+  const size_t size = megabytes << 20;
+  std::vector<workload> workloads;
+  if (scaling) {
+    // four times the size per step, up to the depth the destructors of the
+    // trees recurse through safely
+    for (size_t depth = 1 << 8; depth <= (1 << 16); depth <<= 2) {
+      workloads.push_back({"deep-" + std::to_string(depth),
+                           simdjson::PaddedString(deep_corpus(depth)), false,
+                           depth});
+    }
+    for (size_t members = 1 << 10; members <= (1 << 20); members <<= 2) {
+      workloads.push_back({"wide-" + std::to_string(members),
+                           simdjson::PaddedString(wide_corpus(members)),
+                           false});
+    }
+  } else {
+    workloads.push_back(
+        {"records", simdjson::PaddedString(records_corpus(size)), false});
+    workloads.push_back(
+        {"numbers", simdjson::PaddedString(numbers_corpus(size)), false});
+    workloads.push_back(
+        {"strings", simdjson::PaddedString(strings_corpus(size)), false});
+    workloads.push_back(
+        {"nested", simdjson::PaddedString(nested_corpus(size)), false});
+    workloads.push_back(
+        {"ndjson", simdjson::PaddedString(ndjson_corpus(size)), true});
+  }
+  for (const std::string& path : files) {
+    simdjson::PaddedString json;
+    if (!json.load(path)) {
+      std::fprintf(stderr, "cannot read %s\n", path.c_str());
+      return 1;
+    }
+    const std::string name = path.substr(path.find_last_of('/') + 1);
+    workloads.push_back({name, std::move(json), name.ends_with(".ndjson")});
+  }
+
+  std::printf("kernel %s, best of %d runs, cycles from the tsc\n",
+              std::string(simdjson::active_kernel().name).c_str(), repeat);
+  std::printf("%-16s %-10s %9s %8s %12s %10s %12s\n", "workload", "mode", "MB",
+              "GB/s", "docs/s", "cycles/B", "allocs/doc");
+  for (const workload& w : workloads) {
+    if (!filter.empty() && w.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    if (w.ndjson) {
+      run_ndjson(w, repeat);
+    } else {
+      run_single(w, repeat);
+    }
+  }
+  return 0;
+}
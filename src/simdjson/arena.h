@@ -0,0 +1,108 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace simdjson {
+
+// A growable bump allocator for the nodes of one parse. Deallocation is a
+// no-op, rewind() forgets every allocation at once but keeps the memory, so
+// once the arena has grown to the size of the typical document, parsing into
+// it does not touch the global heap any more.
+class JsonArena final : public std::pmr::memory_resource {
+ public:
+  explicit JsonArena(size_t initial_size = 64 * 1024)
+      : _next_chunk_size(initial_size) {}
+  JsonArena(const JsonArena&) = delete;
+  JsonArena& operator=(const JsonArena&) = delete;
+
+  // forget every allocation, the chunks used by the last parse are merged
+  // into one so the next parse of the same size fits in a single chunk
+  void rewind() {
+    if (_chunks.size() > 1) {
+      const size_t total = capacity();
+      _chunks.clear();
+      add_chunk(total);
+    }
+    _used_before = 0;
+    if (!_chunks.empty()) {
+      _ptr = _chunks.front().data.get();
+      _end = _ptr + _chunks.front().size;
+    }
+  }
+
+  // bytes handed out since the last rewind
+  size_t used() const {
+    return _chunks.empty() ? 0
+                           : _used_before + (_ptr - _chunks.back().data.get());
+  }
+  // bytes reserved from the global heap
+  size_t capacity() const {
+    size_t total = 0;
+    for (const auto& chunk : _chunks) {
+      total += chunk.size;
+    }
+    return total;
+  }
+  // number of chunks requested from the global heap, it stays the same
+  // across parses once the arena is warm
+  size_t chunk_count() const { return _chunks.size(); }
+
+ private:
+  struct chunk {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    std::byte* aligned = align(_ptr, alignment);
+    if (_ptr == nullptr || aligned + bytes > _end) {
+      grow(bytes + alignment);
+      aligned = align(_ptr, alignment);
+    }
+    _ptr = aligned + bytes;
+    return aligned;
+  }
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  static std::byte* align(std::byte* ptr, size_t alignment) {
+    const auto addr = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + ((alignment - addr % alignment) % alignment);
+  }
+
+  void grow(size_t min_size) {
+    if (!_chunks.empty()) {
+      _used_before += _ptr - _chunks.back().data.get();
+    }
+    add_chunk(std::max(_next_chunk_size, min_size));
+    _next_chunk_size *= 2;
+  }
+
+  void add_chunk(size_t size) {
+    _chunks.push_back(
+        {std::make_unique_for_overwrite<std::byte[]>(size), size});
+    _ptr = _chunks.back().data.get();
+    _end = _ptr + size;
+  }
+
+  std::vector<chunk> _chunks;
+  std::byte* _ptr = nullptr;
+  std::byte* _end = nullptr;
+  size_t _used_before = 0;
+  size_t _next_chunk_size;
+};
+}  // namespace simdjson
+
+#endif  // ARENA_H
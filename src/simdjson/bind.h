@@ -0,0 +1,277 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef BIND_H
+#define BIND_H
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ondemand.h"
+#include "result.h"
+
+namespace simdjson {
+
+// One member of a struct bound to the json member `name`.
+template <typename T, typename M>
+struct JsonBinding {
+  std::string_view name;
+  M T::*member;
+};
+
+template <typename T, typename M>
+constexpr JsonBinding<T, M> json_field(std::string_view name, M T::*member) {
+  return {name, member};
+}
+
+// Describes the members of T for parse_into, by specialization:
+//
+//   template <>
+//   struct simdjson::JsonFields<Point> {
+//     static constexpr auto fields = std::make_tuple(
+//         json_field("x", &Point::x), json_field("y", &Point::y));
+//   };
+//
+// Members may be bool, integers, floating point, std::string, std::optional
+// and std::vector of those, or structs with JsonFields of their own. Json
+// members without a field are skipped, fields without a json member keep
+// their value.
+template <typename T>
+struct JsonFields {};
+
+template <typename T>
+concept JsonBindable = requires { JsonFields<T>::fields; };
+
+template <typename U>
+bool bind_value(OnDemandValue value, U& out, JsonParseError& error);
+
+constexpr uint64_t field_hash(std::string_view key, uint64_t seed) {
+  uint64_t h = seed ^ key.size();
+  for (char c : key) {
+    h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  }
+  return h ^ (h >> 29);
+}
+
+// a seed and a mask for which every name hashes to its own slot
+template <size_t N>
+struct field_slots {
+  static constexpr uint8_t kEmpty = 0xff;
+  // up to 32 to 64 slots per name, so a few hundred names still find a seed
+  static constexpr size_t kMaxBits = std::bit_width(N) + 5;
+  uint64_t seed = 0;
+  size_t mask = 0;
+  std::array<uint8_t, size_t(1) << kMaxBits> slots{};
+};
+
+// the smallest table, then the first seed, without a collision
+template <size_t N>
+constexpr field_slots<N> find_field_slots(
+    const std::array<std::string_view, N>& names) {
+  static_assert(N < field_slots<N>::kEmpty, "too many fields");
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j++) {
+      if (names[i] == names[j]) {
+        throw "duplicate field names";
+      }
+    }
+  }
+  field_slots<N> t;
+  t.slots.fill(field_slots<N>::kEmpty);
+  for (size_t bits = std::bit_width(N); bits <= field_slots<N>::kMaxBits;
+       bits++) {
+    for (uint64_t seed = 0; seed < 1024; seed++) {
+      t.seed = seed;
+      t.mask = (size_t(1) << bits) - 1;
+      size_t placed = 0;
+      while (placed < N) {
+        uint8_t& slot = t.slots[field_hash(names[placed], seed) & t.mask];
+        if (slot != field_slots<N>::kEmpty) {
+          break;
+        }
+        slot = static_cast<uint8_t>(placed++);
+      }
+      if (placed == N) {
+        return t;
+      }
+      // empty the table again for the next seed
+      for (size_t i = 0; i < placed; i++) {
+        t.slots[field_hash(names[i], seed) & t.mask] = field_slots<N>::kEmpty;
+      }
+    }
+  }
+  throw "no perfect hash found for the field names";
+}
+
+// The fields of T behind a perfect hash found at compile time, so a key
+// costs one hash, one table load and one comparison with the only name it
+// can be, then an indirect call to the decoder of that member.
+template <JsonBindable T>
+class field_table {
+ public:
+  // false if the value of a known member has the wrong type
+  static bool bind(std::string_view key, OnDemandValue value, T& out,
+                   JsonParseError& error) {
+    const uint8_t slot = kSlots.slots[field_hash(key, kSlots.seed) &
+                                      kSlots.mask];
+    if (slot == field_slots<kCount>::kEmpty || kNames[slot] != key) {
+      return true;
+    }
+    return kBinders[slot](value, out, error);
+  }
+
+ private:
+  using binder = bool (*)(OnDemandValue, T&, JsonParseError&);
+
+  static constexpr auto& kFields = JsonFields<T>::fields;
+  static constexpr size_t kCount =
+      std::tuple_size_v<std::remove_cvref_t<decltype(kFields)>>;
+
+  template <size_t I>
+  static bool bind_field(OnDemandValue value, T& out, JsonParseError& error) {
+    const auto& field = std::get<I>(kFields);
+    if (bind_value(value, out.*field.member, error)) {
+      return true;
+    }
+    // a malformed value is not one of another type
+    if (value.document()->is_error()) {
+      error = value.document()->get_error();
+    } else if (error.empty()) {
+      error = "Unexpected type for member '" + std::string(field.name) + "'";
+    }
+    return false;
+  }
+
+  static constexpr std::array<std::string_view, kCount> kNames = std::apply(
+      [](const auto&... field) {
+        return std::array<std::string_view, kCount>{field.name...};
+      },
+      kFields);
+  static constexpr field_slots<kCount> kSlots = find_field_slots(kNames);
+  static constexpr std::array<binder, kCount> kBinders =
+      []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<binder, kCount>{&bind_field<I>...};
+      }(std::make_index_sequence<kCount>());
+};
+
+template <typename U>
+struct is_optional : std::false_type {};
+template <typename U>
+struct is_optional<std::optional<U>> : std::true_type {};
+template <typename U>
+struct is_vector : std::false_type {};
+template <typename U>
+struct is_vector<std::vector<U>> : std::true_type {};
+
+// decode `value` into `out`, false if it has another type. `error` is only
+// set by nested objects, which name the member that failed.
+template <typename U>
+bool bind_value(OnDemandValue value, U& out, JsonParseError& error) {
+  if constexpr (std::is_same_v<U, bool>) {
+    auto b = value.get_value<bool>();
+    if (!b) {
+      return false;
+    }
+    out = *b;
+    return true;
+  } else if constexpr (std::is_integral_v<U>) {
+    const auto number = value.get_value<json_number>();
+    if (!number) {
+      return false;
+    }
+    // the parser only reports UINT64 above INT64_MAX
+    if (number->type == number_type::INT64 && std::in_range<U>(number->i)) {
+      out = static_cast<U>(number->i);
+      return true;
+    }
+    if (number->type == number_type::UINT64 && std::in_range<U>(number->u)) {
+      out = static_cast<U>(number->u);
+      return true;
+    }
+    return false;
+  } else if constexpr (std::is_floating_point_v<U>) {
+    const auto number = value.get_value<json_number>();
+    if (!number) {
+      return false;
+    }
+    switch (number->type) {
+      case number_type::INT64:
+        out = static_cast<U>(number->i);
+        break;
+      case number_type::UINT64:
+        out = static_cast<U>(number->u);
+        break;
+      case number_type::DOUBLE:
+        out = static_cast<U>(number->d);
+        break;
+    }
+    return true;
+  } else if constexpr (std::is_same_v<U, std::string>) {
+    auto s = value.get_value<std::string_view>();
+    if (!s) {
+      return false;
+    }
+    out.assign(s->data(), s->size());
+    return true;
+  } else if constexpr (is_optional<U>::value) {
+    if (value.is_null()) {
+      out.reset();
+      return true;
+    }
+    return bind_value(value, out.emplace(), error);
+  } else if constexpr (is_vector<U>::value) {
+    auto array = value.get_value<OnDemandArray>();
+    if (!array) {
+      return false;
+    }
+    out.clear();
+    for (const OnDemandValue element : *array) {
+      // through a local, std::vector<bool> has no element references
+      typename U::value_type decoded{};
+      if (!bind_value(element, decoded, error)) {
+        return false;
+      }
+      out.push_back(std::move(decoded));
+    }
+    return true;
+  } else {
+    static_assert(JsonBindable<U>, "specialize JsonFields for this type");
+    auto object = value.get_value<OnDemandObject>();
+    if (!object) {
+      return false;
+    }
+    for (const OnDemandField field : *object) {
+      // malformed, the document holds the error
+      if (!field.value.exists() ||
+          !field_table<U>::bind(field.key, field.value, out, error)) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+// the root of `doc` into `out`, an error of the document comes first
+template <typename U>
+void bind_document(OnDemandDocument& doc, U& out, JsonParseError& error) {
+  error.clear();
+  const bool bound = !doc.is_error() && bind_value(doc.root(), out, error);
+  if (doc.is_error()) {
+    error = doc.get_error();
+  } else if (!bound && error.empty()) {
+    error = "Unexpected type at the root";
+  }
+}
+}  // namespace simdjson
+
+#endif  // BIND_H
@@ -0,0 +1,164 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "result.h"
+
+namespace simdjson {
+
+// the type of the values of a JsonColumn. A number is accepted by a DOUBLE
+// column whatever its form, by an INT64 column only when it is an integer.
+enum class JsonColumnType : uint8_t { INT64, DOUBLE, BOOL, STRING };
+
+// One column of a JsonColumns: the values of one member, or of one element,
+// of every record, in the buffers of the Arrow columnar format. Row i is
+// valid when bit i of the validity bitmap is set, bits are numbered from the
+// least significant bit of each byte. A null or missing value is a cleared
+// bit over a zero slot.
+//   INT64   one int64_t per row (Arrow Int64)
+//   DOUBLE  one double per row (Arrow Float64)
+//   BOOL    one bit per row, numbered like the validity bits (Arrow Boolean)
+//   STRING  size() + 1 offsets, row i is data()[offsets[i], offsets[i + 1])
+//           (Arrow LargeUtf8)
+class JsonColumn {
+ public:
+  // a column of the member `name` of object records
+  JsonColumn(std::string_view name, JsonColumnType type)
+      : _name(name), _member(true), _type(type) {}
+  // a column of the element at `position` of array records
+  JsonColumn(size_t position, JsonColumnType type)
+      : _position(position), _type(type) {}
+
+  bool is_member() const { return _member; }
+  const std::string& name() const { return _name; }
+  size_t position() const { return _position; }
+  JsonColumnType type() const { return _type; }
+  size_t size() const { return _size; }
+  size_t null_count() const;
+  bool is_valid(size_t row) const { return test_bit(_validity, row); }
+
+  // the Arrow buffers, only the ones of type() are filled
+  const std::vector<uint8_t>& validity() const { return _validity; }
+  std::span<const int64_t> int64_values() const { return _int64; }
+  std::span<const double> double_values() const { return _double; }
+  const std::vector<uint8_t>& bool_values() const { return _bits; }
+  std::span<const int64_t> offsets() const { return _offsets; }
+  std::span<const char> data() const { return _data; }
+
+  // one value, of a valid row of a column of that type
+  int64_t int64_at(size_t row) const {
+    assert(_type == JsonColumnType::INT64);
+    return _int64[row];
+  }
+  double double_at(size_t row) const {
+    assert(_type == JsonColumnType::DOUBLE);
+    return _double[row];
+  }
+  bool bool_at(size_t row) const {
+    assert(_type == JsonColumnType::BOOL);
+    return test_bit(_bits, row);
+  }
+  std::string_view string_at(size_t row) const {
+    assert(_type == JsonColumnType::STRING);
+    return std::string_view(_data.data() + _offsets[row],
+                            _offsets[row + 1] - _offsets[row]);
+  }
+
+  // for the parser: a null row is appended first, then the value of the
+  // last row is set, again for a duplicate member
+  void append_null();
+  void set_null();
+  void set(int64_t value);
+  void set(double value);
+  void set(bool value);
+  void set(std::string_view value);
+  // drop the rows from `rows` on, the capacity is kept
+  void truncate(size_t rows);
+
+ private:
+  static bool test_bit(const std::vector<uint8_t>& bits, size_t i) {
+    return (bits[i / 8] >> (i % 8)) & 1;
+  }
+  static void set_bit(std::vector<uint8_t>& bits, size_t i, bool value) {
+    const uint8_t mask = static_cast<uint8_t>(1 << (i % 8));
+    bits[i / 8] = value ? bits[i / 8] | mask : bits[i / 8] & ~mask;
+  }
+
+  std::string _name;
+  size_t _position = 0;
+  bool _member = false;
+  JsonColumnType _type;
+  size_t _size = 0;
+  std::vector<uint8_t> _validity;
+  std::vector<int64_t> _int64;
+  std::vector<double> _double;
+  std::vector<uint8_t> _bits;
+  std::vector<int64_t> _offsets{0};
+  std::vector<char> _data;
+};
+
+// The target of parse_columns: the columns to extract from each record of
+// an NDJSON input, and the rows extracted so far.
+//
+//   JsonColumns columns;
+//   columns.add_column("asin", JsonColumnType::STRING)
+//       .add_column("rating", JsonColumnType::DOUBLE);
+//   parser.parse_columns(ndjson, columns);
+//
+// Columns read the top-level members of object records, or the top-level
+// elements of array records. Members and elements without a column are
+// skipped without being decoded.
+class JsonColumns {
+ public:
+  // a column for the member `name` of object records, the last of
+  // duplicate members wins
+  JsonColumns& add_column(std::string_view name, JsonColumnType type);
+  // a column for the element at `position` of array records
+  JsonColumns& add_column(size_t position, JsonColumnType type);
+
+  size_t column_count() const { return _columns.size(); }
+  size_t row_count() const { return _rows; }
+  const JsonColumn& operator[](size_t column) const {
+    return _columns[column];
+  }
+  // the column of the member `name`, nullptr if there is none
+  const JsonColumn* find(std::string_view name) const;
+  // drop the rows and the error, the columns and the capacity are kept
+  void clear();
+
+  // the failure of the last parse_columns, the rows before the failing
+  // record are kept. Its message is only built by get_error.
+  bool is_error() const { return static_cast<bool>(_error); }
+  JsonParseError get_error() const {
+    return is_error() ? _error.message() : JsonParseError();
+  }
+  error_code get_error_code() const { return _error.code; }
+  size_t get_error_offset() const { return _error.offset; }
+
+  // for the parser: the index of the column of the member `name`,
+  // column_count() if there is none
+  size_t member_column(std::string_view name) const;
+  JsonColumn& column(size_t column) { return _columns[column]; }
+  // a record is a null row in every column until its values are set
+  void start_row();
+  void end_row() { _rows++; }
+  void discard_row();
+  void set_error(const JsonError& error) { _error = error; }
+
+ private:
+  std::vector<JsonColumn> _columns;
+  size_t _rows = 0;
+  JsonError _error;
+};
+}  // namespace simdjson
+
+#endif  // COLUMNAR_H
@@ -0,0 +1,335 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "result.h"
+
+namespace simdjson {
+
+// A read-only document stored as one tape of 64-bit words plus one string
+// buffer. Each word keeps its type in the top 8 bits and a payload in the
+// low 56 bits:
+//   'r'  root, payload is the index of the closing root word
+//   '{'  '['  payload low 32 bits: index after the matching close word,
+//             bits 32..55: number of fields / elements (saturated)
+//   '}'  ']'  payload is the index of the matching open word
+//   '"'  payload is the offset of the string in the string buffer, where it
+//        is stored as a 4 bytes length, the decoded bytes and a '\0'.
+//        With kTapeBorrowedString set, the string had no escape and the
+//        payload is its offset in the input instead, its length is stored
+//        in the next word.
+//   'l'  'u'  'd'  int64 / uint64 / double, the value is stored raw in the
+//                  next word, uint64 only above INT64_MAX
+//   't'  'f'  'n'  true, false, null
+enum class JsonTapeType : uint8_t {
+  ROOT = 'r',
+  START_OBJECT = '{',
+  END_OBJECT = '}',
+  START_ARRAY = '[',
+  END_ARRAY = ']',
+  STRING = '"',
+  INT64 = 'l',
+  UINT64 = 'u',
+  DOUBLE = 'd',
+  TRUE_VALUE = 't',
+  FALSE_VALUE = 'f',
+  NULL_VALUE = 'n',
+};
+
+constexpr uint64_t kTapePayloadMask = (uint64_t(1) << 56) - 1;
+constexpr uint64_t kTapeCountMask = 0xFFFFFF;
+constexpr uint64_t kTapeBorrowedString = uint64_t(1) << 55;
+
+class JsonDocument;
+class JsonElement;
+class JsonObjectView;
+class JsonArrayView;
+
+// a value inside a JsonDocument, only valid as long as the document
+class JsonElement {
+ public:
+  JsonElement() = default;
+  JsonElement(const JsonDocument* doc, size_t index)
+      : _doc(doc), _index(index) {}
+
+  JsonTapeType type() const;
+  bool is_string() const { return type() == JsonTapeType::STRING; }
+  bool is_int64() const { return type() == JsonTapeType::INT64; }
+  bool is_uint64() const { return type() == JsonTapeType::UINT64; }
+  bool is_double() const { return type() == JsonTapeType::DOUBLE; }
+  bool is_bool() const {
+    return type() == JsonTapeType::TRUE_VALUE ||
+           type() == JsonTapeType::FALSE_VALUE;
+  }
+  bool is_object() const { return type() == JsonTapeType::START_OBJECT; }
+  bool is_array() const { return type() == JsonTapeType::START_ARRAY; }
+  bool is_null() const { return type() == JsonTapeType::NULL_VALUE; }
+
+  // access values, T is one of std::string_view, int64_t, uint64_t, double,
+  // bool, JsonObjectView or JsonArrayView
+  template <typename T>
+  T get_value() const;
+
+  // lookup in an object / array, the key or index must exist
+  JsonElement operator[](std::string_view key) const;
+  JsonElement operator[](size_t index) const;
+
+  // tape index of the word after this value, skips whole containers
+  size_t next_index() const;
+  size_t tape_index() const { return _index; }
+
+ private:
+  uint64_t word() const;
+  uint64_t payload() const { return word() & kTapePayloadMask; }
+
+  const JsonDocument* _doc = nullptr;
+  size_t _index = 0;
+};
+
+class JsonArrayView {
+ public:
+  class iterator {
+   public:
+    iterator(const JsonDocument* doc, size_t index)
+        : _doc(doc), _index(index) {}
+    JsonElement operator*() const { return JsonElement(_doc, _index); }
+    iterator& operator++() {
+      _index = JsonElement(_doc, _index).next_index();
+      return *this;
+    }
+    bool operator==(const iterator& other) const {
+      return _index == other._index;
+    }
+
+   private:
+    const JsonDocument* _doc;
+    size_t _index;
+  };
+
+  JsonArrayView(const JsonDocument* doc, size_t index)
+      : _doc(doc), _index(index) {}
+  iterator begin() const { return {_doc, _index + 1}; }
+  iterator end() const;
+  size_t size() const;
+  // linear walk over the elements, skipping nested containers
+  JsonElement at(size_t index) const;
+
+ private:
+  const JsonDocument* _doc;
+  size_t _index;
+};
+
+struct JsonField {
+  std::string_view key;
+  JsonElement value;
+};
+
+class JsonObjectView {
+ public:
+  class iterator {
+   public:
+    iterator(const JsonDocument* doc, size_t index)
+        : _doc(doc), _index(index) {}
+    // a key takes one word, or two when borrowed from the input
+    JsonField operator*() const {
+      const JsonElement key(_doc, _index);
+      return {key.get_value<std::string_view>(),
+              JsonElement(_doc, key.next_index())};
+    }
+    iterator& operator++() {
+      _index = JsonElement(_doc, JsonElement(_doc, _index).next_index())
+                   .next_index();
+      return *this;
+    }
+    bool operator==(const iterator& other) const {
+      return _index == other._index;
+    }
+
+   private:
+    const JsonDocument* _doc;
+    size_t _index;
+  };
+
+  JsonObjectView(const JsonDocument* doc, size_t index)
+      : _doc(doc), _index(index) {}
+  iterator begin() const { return {_doc, _index + 1}; }
+  iterator end() const;
+  size_t size() const;
+  // linear scan over the keys, end() if the key is missing
+  iterator find(std::string_view key) const;
+  bool contains(std::string_view key) const { return find(key) != end(); }
+  JsonElement at(std::string_view key) const {
+    auto it = find(key);
+    assert(it != end());
+    return (*it).value;
+  }
+
+ private:
+  const JsonDocument* _doc;
+  size_t _index;
+};
+
+class JsonDocument {
+ public:
+  JsonElement root() const { return JsonElement(this, 1); }
+
+  // check if error, the message is only built by get_error
+  bool is_error() const { return static_cast<bool>(_error); }
+  JsonParseError get_error() const {
+    return is_error() ? _error.message() : JsonParseError();
+  }
+  error_code get_error_code() const { return _error.code; }
+  size_t get_error_offset() const { return _error.offset; }
+
+  // for the parser: drop the previous parse but keep the buffers
+  void clear() {
+    _tape.clear();
+    _strings.clear();
+    _error = {};
+    _input = nullptr;
+  }
+  std::vector<uint64_t>& tape() { return _tape; }
+  std::vector<char>& strings() { return _strings; }
+  // the input the borrowed strings point into
+  void set_input(const char* input) { _input = input; }
+  void set_error(const JsonError& error) { _error = error; }
+
+ private:
+  friend class JsonElement;
+  friend class JsonArrayView;
+  friend class JsonObjectView;
+
+  std::vector<uint64_t> _tape;
+  std::vector<char> _strings;
+  const char* _input = nullptr;
+  JsonError _error;
+};
+
+inline uint64_t JsonElement::word() const { return _doc->_tape[_index]; }
+
+inline JsonTapeType JsonElement::type() const {
+  return static_cast<JsonTapeType>(word() >> 56);
+}
+
+inline size_t JsonElement::next_index() const {
+  switch (type()) {
+    case JsonTapeType::START_OBJECT:
+    case JsonTapeType::START_ARRAY:
+      return static_cast<uint32_t>(payload());
+    case JsonTapeType::INT64:
+    case JsonTapeType::UINT64:
+    case JsonTapeType::DOUBLE:
+      return _index + 2;
+    case JsonTapeType::STRING:
+      return payload() & kTapeBorrowedString ? _index + 2 : _index + 1;
+    default:
+      return _index + 1;
+  }
+}
+
+template <typename T>
+T JsonElement::get_value() const {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    assert(is_string());
+    if (payload() & kTapeBorrowedString) {
+      return {_doc->_input + (payload() & ~kTapeBorrowedString),
+              static_cast<size_t>(_doc->_tape[_index + 1])};
+    }
+    const char* str = _doc->_strings.data() + payload();
+    uint32_t len;
+    std::memcpy(&len, str, sizeof(len));
+    return {str + sizeof(len), len};
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    assert(is_int64());
+    return static_cast<int64_t>(_doc->_tape[_index + 1]);
+  } else if constexpr (std::is_same_v<T, uint64_t>) {
+    assert(is_uint64());
+    return _doc->_tape[_index + 1];
+  } else if constexpr (std::is_same_v<T, double>) {
+    assert(is_double());
+    return std::bit_cast<double>(_doc->_tape[_index + 1]);
+  } else if constexpr (std::is_same_v<T, bool>) {
+    assert(is_bool());
+    return type() == JsonTapeType::TRUE_VALUE;
+  } else if constexpr (std::is_same_v<T, JsonObjectView>) {
+    assert(is_object());
+    return JsonObjectView(_doc, _index);
+  } else {
+    static_assert(std::is_same_v<T, JsonArrayView>, "unsupported type");
+    assert(is_array());
+    return JsonArrayView(_doc, _index);
+  }
+}
+
+inline JsonElement JsonElement::operator[](std::string_view key) const {
+  return get_value<JsonObjectView>().at(key);
+}
+
+inline JsonElement JsonElement::operator[](size_t index) const {
+  return get_value<JsonArrayView>().at(index);
+}
+
+// the open word points past the close word, which is where iteration stops
+inline JsonArrayView::iterator JsonArrayView::end() const {
+  return {_doc, static_cast<uint32_t>(_doc->_tape[_index]) - size_t(1)};
+}
+
+inline size_t JsonArrayView::size() const {
+  const size_t count = (_doc->_tape[_index] & kTapePayloadMask) >> 32;
+  if (count < kTapeCountMask) {
+    return count;
+  }
+  size_t n = 0;
+  for (auto it = begin(); it != end(); ++it) {
+    ++n;
+  }
+  return n;
+}
+
+inline JsonElement JsonArrayView::at(size_t index) const {
+  auto it = begin();
+  for (; index > 0 && it != end(); --index) {
+    ++it;
+  }
+  assert(it != end());
+  return *it;
+}
+
+inline JsonObjectView::iterator JsonObjectView::end() const {
+  return {_doc, static_cast<uint32_t>(_doc->_tape[_index]) - size_t(1)};
+}
+
+inline size_t JsonObjectView::size() const {
+  const size_t count = (_doc->_tape[_index] & kTapePayloadMask) >> 32;
+  if (count < kTapeCountMask) {
+    return count;
+  }
+  size_t n = 0;
+  for (auto it = begin(); it != end(); ++it) {
+    ++n;
+  }
+  return n;
+}
+
+inline JsonObjectView::iterator JsonObjectView::find(
+    std::string_view key) const {
+  for (auto it = begin(); it != end(); ++it) {
+    if ((*it).key == key) {
+      return it;
+    }
+  }
+  return end();
+}
+}  // namespace simdjson
+
+#endif  // DOCUMENT_H
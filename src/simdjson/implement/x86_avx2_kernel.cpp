@@ -0,0 +1,159 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <immintrin.h>
+#include <cstring>
+#include "x86_compress.h"
+#include "x86_kernel.h"
+#include "x86_target.h"
+
+SIMDJSON_TARGET_REGION("avx2,bmi,bmi2,pclmul,popcnt")
+namespace simdjson {
+namespace {
+// one avx2 register of bytes, for the utf-8 check
+struct simd8 {
+  static constexpr size_t kSize = 32;
+  __m256i value;
+
+  static simd8 splat(uint8_t c) {
+    return {_mm256_set1_epi8(static_cast<char>(c))};
+  }
+  static simd8 load(const uint8_t* ptr) {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr))};
+  }
+  // a lookup table of 16 bytes in every lane
+  static simd8 table(const uint8_t (&t)[16]) {
+    return {_mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)))};
+  }
+
+  simd8 shr4() const {
+    return {_mm256_and_si256(_mm256_srli_epi16(value, 4),
+                             _mm256_set1_epi8(0x0F))};
+  }
+  simd8 lookup(simd8 table) const {
+    return {_mm256_shuffle_epi8(table.value, value)};
+  }
+  // the register shifted by N bytes, the gap filled from the end of
+  // `before`. alignr works per lane, so the lanes are first moved by one
+  template <int N>
+  simd8 prev(simd8 before) const {
+    const __m256i lanes = _mm256_permute2x128_si256(before.value, value, 0x21);
+    return {_mm256_alignr_epi8(value, lanes, 16 - N)};
+  }
+  simd8 saturating_sub(simd8 other) const {
+    return {_mm256_subs_epu8(value, other.value)};
+  }
+  simd8 operator&(simd8 other) const {
+    return {_mm256_and_si256(value, other.value)};
+  }
+  simd8 operator|(simd8 other) const {
+    return {_mm256_or_si256(value, other.value)};
+  }
+  simd8 operator^(simd8 other) const {
+    return {_mm256_xor_si256(value, other.value)};
+  }
+  bool any() const { return !_mm256_testz_si256(value, value); }
+};
+
+// 64 bytes of input held in two avx2 registers
+struct simd8x64 {
+  static constexpr size_t kRegisters = 2;
+  __m256i lo;
+  __m256i hi;
+
+  explicit simd8x64(const uint8_t* ptr)
+      : lo(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr))),
+        hi(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 32))) {}
+
+  static uint64_t to_bitmask(__m256i lo_mask, __m256i hi_mask) {
+    const uint64_t lo_bits =
+        static_cast<uint32_t>(_mm256_movemask_epi8(lo_mask));
+    const uint64_t hi_bits =
+        static_cast<uint32_t>(_mm256_movemask_epi8(hi_mask));
+    return lo_bits | (hi_bits << 32);
+  }
+
+  simd8 reg(size_t i) const { return {i == 0 ? lo : hi}; }
+  bool is_ascii() const {
+    return _mm256_movemask_epi8(_mm256_or_si256(lo, hi)) == 0;
+  }
+
+  void store(uint8_t* dst) const {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), hi);
+  }
+
+  // pack the bytes of the block whose bit is set in `keep` into `out`,
+  // eight bytes at a time with a shuffle from the compress table
+  static size_t compress(const uint8_t* ptr, uint64_t keep, uint8_t* out) {
+    uint8_t* const start = out;
+    for (size_t i = 0; i < 8; i++) {
+      const auto mask = static_cast<uint8_t>(keep >> (8 * i));
+      const __m128i bytes =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr + 8 * i));
+      const __m128i shuffle =
+          _mm_cvtsi64_si128(static_cast<int64_t>(kCompressTable[mask]));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+                       _mm_shuffle_epi8(bytes, shuffle));
+      out += __builtin_popcount(mask);
+    }
+    return out - start;
+  }
+
+  uint64_t eq(uint8_t c) const {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(c));
+    return to_bitmask(_mm256_cmpeq_epi8(lo, mask),
+                      _mm256_cmpeq_epi8(hi, mask));
+  }
+
+  // bytes that are (unsigned) less than or equal to c
+  uint64_t lteq(uint8_t c) const {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(c));
+    return to_bitmask(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, mask), mask),
+                      _mm256_cmpeq_epi8(_mm256_max_epu8(hi, mask), mask));
+  }
+
+  // one shuffle lookup on the low nibble finds the json whitespace, and
+  // another one finds the operators {}[]:, after folding [] onto {}
+  void classify(uint64_t& op, uint64_t& whitespace) const {
+    const __m256i ws_table = _mm256_setr_epi8(
+        ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r',
+        100, 100, ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112,
+        100, '\r', 100, 100);
+    const __m256i op_table = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+    whitespace = to_bitmask(
+        _mm256_cmpeq_epi8(lo, _mm256_shuffle_epi8(ws_table, lo)),
+        _mm256_cmpeq_epi8(hi, _mm256_shuffle_epi8(ws_table, hi)));
+    const __m256i curly = _mm256_set1_epi8(0x20);
+    const __m256i lo_curly = _mm256_or_si256(lo, curly);
+    const __m256i hi_curly = _mm256_or_si256(hi, curly);
+    op = to_bitmask(
+        _mm256_cmpeq_epi8(lo_curly, _mm256_shuffle_epi8(op_table, lo_curly)),
+        _mm256_cmpeq_epi8(hi_curly, _mm256_shuffle_epi8(op_table, hi_curly)));
+  }
+};
+
+// bit i of the result is the xor of bits 0..i, computed with a carry-less
+// multiplication by all ones
+uint64_t prefix_xor(uint64_t bitmask) {
+  const __m128i all_ones = _mm_set1_epi8('\xFF');
+  const __m128i result =
+      _mm_clmulepi64_si128(_mm_set_epi64x(0, bitmask), all_ones, 0);
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(result));
+}
+
+#include "x86_utf8_generic.h"
+#include "x86_stage1_generic.h"
+#include "x86_string_generic.h"
+#include "x86_minify_generic.h"
+}  // namespace
+
+const x86_kernel avx2_kernel{"avx2", kAVX2 | kBMI | kPCLMUL | kPOPCNT, true,
+                             find_structural_bits, parse_string,
+                             escape_string, validate_utf8,
+                             skip_whitespace, minify};
+}  // namespace simdjson
+SIMDJSON_UNTARGET_REGION
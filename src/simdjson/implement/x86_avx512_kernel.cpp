@@ -0,0 +1,123 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <immintrin.h>
+#include <cstring>
+#include "x86_kernel.h"
+#include "x86_target.h"
+
+SIMDJSON_TARGET_REGION(
+    "avx512f,avx512dq,avx512bw,avx512vl,avx512vbmi2,avx2,bmi,bmi2,pclmul,"
+    "popcnt")
+namespace simdjson {
+namespace {
+// one zmm register of bytes, for the utf-8 check
+struct simd8 {
+  static constexpr size_t kSize = 64;
+  __m512i value;
+
+  static simd8 splat(uint8_t c) {
+    return {_mm512_set1_epi8(static_cast<char>(c))};
+  }
+  static simd8 load(const uint8_t* ptr) { return {_mm512_loadu_si512(ptr)}; }
+  // a lookup table of 16 bytes in every lane
+  static simd8 table(const uint8_t (&t)[16]) {
+    return {_mm512_broadcast_i32x4(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)))};
+  }
+
+  simd8 shr4() const {
+    return {_mm512_and_si512(_mm512_srli_epi16(value, 4),
+                             _mm512_set1_epi8(0x0F))};
+  }
+  simd8 lookup(simd8 table) const {
+    return {_mm512_shuffle_epi8(table.value, value)};
+  }
+  // the register shifted by N bytes, the gap filled from the end of
+  // `before`. alignr works per lane, so the lanes are first moved by one
+  template <int N>
+  simd8 prev(simd8 before) const {
+    const __m512i index = _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6);
+    const __m512i lanes =
+        _mm512_permutex2var_epi64(before.value, index, value);
+    return {_mm512_alignr_epi8(value, lanes, 16 - N)};
+  }
+  simd8 saturating_sub(simd8 other) const {
+    return {_mm512_subs_epu8(value, other.value)};
+  }
+  simd8 operator&(simd8 other) const {
+    return {_mm512_and_si512(value, other.value)};
+  }
+  simd8 operator|(simd8 other) const {
+    return {_mm512_or_si512(value, other.value)};
+  }
+  simd8 operator^(simd8 other) const {
+    return {_mm512_xor_si512(value, other.value)};
+  }
+  bool any() const { return _mm512_test_epi8_mask(value, value) != 0; }
+};
+
+// 64 bytes of input in one zmm register, the compares give the bitmask
+// directly
+struct simd8x64 {
+  static constexpr size_t kRegisters = 1;
+  __m512i chunk;
+
+  explicit simd8x64(const uint8_t* ptr) : chunk(_mm512_loadu_si512(ptr)) {}
+
+  simd8 reg(size_t) const { return {chunk}; }
+  bool is_ascii() const { return _mm512_movepi8_mask(chunk) == 0; }
+
+  void store(uint8_t* dst) const { _mm512_storeu_si512(dst, chunk); }
+  // pack the bytes whose bit is set in `keep` into `out` with one compress,
+  // all 64 bytes are written
+  size_t compress(const uint8_t*, uint64_t keep, uint8_t* out) const {
+    _mm512_storeu_si512(out, _mm512_maskz_compress_epi8(keep, chunk));
+    return __builtin_popcountll(keep);
+  }
+
+  uint64_t eq(uint8_t c) const {
+    return _mm512_cmpeq_epi8_mask(chunk,
+                                  _mm512_set1_epi8(static_cast<char>(c)));
+  }
+
+  uint64_t lteq(uint8_t c) const {
+    return _mm512_cmple_epu8_mask(chunk,
+                                  _mm512_set1_epi8(static_cast<char>(c)));
+  }
+
+  // same shuffle lookups as the avx2 kernel, on four 128-bit lanes
+  void classify(uint64_t& op, uint64_t& whitespace) const {
+    const __m512i ws_table = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n',
+                      112, 100, '\r', 100, 100));
+    const __m512i op_table = _mm512_broadcast_i32x4(_mm_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0));
+    whitespace =
+        _mm512_cmpeq_epi8_mask(chunk, _mm512_shuffle_epi8(ws_table, chunk));
+    const __m512i curlified = _mm512_or_si512(chunk, _mm512_set1_epi8(0x20));
+    op = _mm512_cmpeq_epi8_mask(curlified,
+                                _mm512_shuffle_epi8(op_table, curlified));
+  }
+};
+
+uint64_t prefix_xor(uint64_t bitmask) {
+  const __m128i all_ones = _mm_set1_epi8('\xFF');
+  const __m128i result =
+      _mm_clmulepi64_si128(_mm_set_epi64x(0, bitmask), all_ones, 0);
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(result));
+}
+
+#include "x86_utf8_generic.h"
+#include "x86_stage1_generic.h"
+#include "x86_string_generic.h"
+#include "x86_minify_generic.h"
+}  // namespace
+
+const x86_kernel avx512_kernel{"avx512",
+                               kAVX512 | kAVX2 | kBMI | kPCLMUL | kPOPCNT,
+                               true, find_structural_bits, parse_string,
+                               escape_string, validate_utf8,
+                               skip_whitespace, minify};
+}  // namespace simdjson
+SIMDJSON_UNTARGET_REGION
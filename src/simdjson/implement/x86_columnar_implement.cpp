@@ -0,0 +1,476 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "../columnar.h"
+#include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include "x86_stage2.h"
+
+namespace simdjson {
+// the bits past size() are kept clear, so every set bit is a valid row
+size_t JsonColumn::null_count() const {
+  size_t valid = 0;
+  for (const uint8_t byte : _validity) {
+    valid += std::popcount(byte);
+  }
+  return _size - valid;
+}
+
+void JsonColumn::append_null() {
+  if (_size % 8 == 0) {
+    _validity.push_back(0);
+    if (_type == JsonColumnType::BOOL) {
+      _bits.push_back(0);
+    }
+  }
+  switch (_type) {
+    case JsonColumnType::INT64:
+      _int64.push_back(0);
+      break;
+    case JsonColumnType::DOUBLE:
+      _double.push_back(0);
+      break;
+    case JsonColumnType::BOOL:
+      break;
+    case JsonColumnType::STRING:
+      _offsets.push_back(_offsets.back());
+      break;
+  }
+  _size++;
+}
+
+void JsonColumn::set_null() {
+  const size_t row = _size - 1;
+  set_bit(_validity, row, false);
+  switch (_type) {
+    case JsonColumnType::INT64:
+      _int64.back() = 0;
+      break;
+    case JsonColumnType::DOUBLE:
+      _double.back() = 0;
+      break;
+    case JsonColumnType::BOOL:
+      set_bit(_bits, row, false);
+      break;
+    case JsonColumnType::STRING:
+      _data.resize(_offsets[row]);
+      _offsets.back() = _offsets[row];
+      break;
+  }
+}
+
+void JsonColumn::set(int64_t value) {
+  assert(_type == JsonColumnType::INT64);
+  _int64.back() = value;
+  set_bit(_validity, _size - 1, true);
+}
+
+void JsonColumn::set(double value) {
+  assert(_type == JsonColumnType::DOUBLE);
+  _double.back() = value;
+  set_bit(_validity, _size - 1, true);
+}
+
+void JsonColumn::set(bool value) {
+  assert(_type == JsonColumnType::BOOL);
+  set_bit(_bits, _size - 1, value);
+  set_bit(_validity, _size - 1, true);
+}
+
+void JsonColumn::set(std::string_view value) {
+  assert(_type == JsonColumnType::STRING);
+  // a duplicate member replaces the bytes of the first one
+  const size_t row = _size - 1;
+  _data.resize(_offsets[row]);
+  _data.insert(_data.end(), value.begin(), value.end());
+  _offsets.back() = static_cast<int64_t>(_data.size());
+  set_bit(_validity, row, true);
+}
+
+void JsonColumn::truncate(size_t rows) {
+  if (rows >= _size) {
+    return;
+  }
+  _size = rows;
+  const auto trim = [rows](std::vector<uint8_t>& bits) {
+    bits.resize((rows + 7) / 8);
+    if (rows % 8 != 0) {
+      bits.back() &= static_cast<uint8_t>((1 << (rows % 8)) - 1);
+    }
+  };
+  trim(_validity);
+  switch (_type) {
+    case JsonColumnType::INT64:
+      _int64.resize(rows);
+      break;
+    case JsonColumnType::DOUBLE:
+      _double.resize(rows);
+      break;
+    case JsonColumnType::BOOL:
+      trim(_bits);
+      break;
+    case JsonColumnType::STRING:
+      _data.resize(_offsets[rows]);
+      _offsets.resize(rows + 1);
+      break;
+  }
+}
+
+JsonColumns& JsonColumns::add_column(std::string_view name,
+                                     JsonColumnType type) {
+  _columns.emplace_back(name, type);
+  // a column added later is null for the rows so far
+  for (size_t i = 0; i < _rows; i++) {
+    _columns.back().append_null();
+  }
+  return *this;
+}
+
+JsonColumns& JsonColumns::add_column(size_t position, JsonColumnType type) {
+  _columns.emplace_back(position, type);
+  for (size_t i = 0; i < _rows; i++) {
+    _columns.back().append_null();
+  }
+  return *this;
+}
+
+const JsonColumn* JsonColumns::find(std::string_view name) const {
+  const size_t column = member_column(name);
+  return column == _columns.size() ? nullptr : &_columns[column];
+}
+
+void JsonColumns::clear() {
+  for (JsonColumn& column : _columns) {
+    column.truncate(0);
+  }
+  _rows = 0;
+  _error = {};
+}
+
+size_t JsonColumns::member_column(std::string_view name) const {
+  for (size_t i = 0; i < _columns.size(); i++) {
+    if (_columns[i].is_member() && _columns[i].name() == name) {
+      return i;
+    }
+  }
+  return _columns.size();
+}
+
+void JsonColumns::start_row() {
+  for (JsonColumn& column : _columns) {
+    column.append_null();
+  }
+}
+
+void JsonColumns::discard_row() {
+  for (JsonColumn& column : _columns) {
+    column.truncate(_rows);
+  }
+}
+
+namespace {
+// Reads records from the structural index into the columns. Only the top
+// level of a record is walked: the value of a column is decoded straight
+// into its buffers, any other value is skipped by counting brackets, so,
+// like a value iterate never reads, it is only checked for balance.
+class column_reader {
+ public:
+  column_reader(JsonColumns& columns, std::vector<char>& scratch)
+      : _columns(columns), _scratch(scratch) {
+    const size_t none = columns.column_count();
+    for (size_t i = 0; i < columns.column_count(); i++) {
+      if (!columns[i].is_member()) {
+        const size_t position = columns[i].position();
+        if (_elements.size() <= position) {
+          _elements.resize(position + 1, none);
+        }
+        _elements[position] = i;
+      }
+    }
+  }
+
+  // every record of a batch, false with `error` set at an offset relative
+  // to the batch. The rows of the records before the failing one are kept.
+  bool read_batch(std::string_view json, const uint32_t* tokens,
+                  size_t count, JsonError& error) {
+    _json = json;
+    _tokens = tokens;
+    _count = count;
+    _error = &error;
+    for (size_t i = 0; i < count;) {
+      _columns.start_row();
+      if (!read_record(i)) {
+        _columns.discard_row();
+        return false;
+      }
+      _columns.end_row();
+    }
+    return true;
+  }
+
+ private:
+  // the column of the key of each member, by the order of the members in
+  // the previous records, so records of one shape compare each key once
+  struct predicted_key {
+    std::string_view key;
+    size_t column;
+  };
+
+  char at(size_t i) const { return _json[_tokens[i]]; }
+  bool fail(size_t i, error_code code) {
+    *_error = {code, i < _count ? _tokens[i] : _json.size()};
+    return false;
+  }
+
+  bool read_record(size_t& i) {
+    const char open = at(i);
+    if (open != '{' && open != '[') {
+      return fail(i, error_code::UNEXPECTED_TYPE);
+    }
+    const bool is_object = open == '{';
+    const char close = is_object ? '}' : ']';
+    if (++i < _count && at(i) == close) {
+      ++i;
+      return true;
+    }
+    for (size_t n = 0;; n++) {
+      size_t column = _columns.column_count();
+      if (is_object) {
+        if (i >= _count || at(i) != '"') {
+          return fail(i, error_code::EXPECTED_KEY);
+        }
+        if (!member_column(i, n, column)) {
+          return false;
+        }
+        if (++i >= _count || at(i) != ':') {
+          return fail(i, error_code::EXPECTED_COLON);
+        }
+        ++i;
+      } else if (n < _elements.size()) {
+        column = _elements[n];
+      }
+      if (!read_value(i, column)) {
+        return false;
+      }
+      if (i >= _count) {
+        return fail(i, is_object ? error_code::EXPECTED_OBJECT_END
+                                 : error_code::EXPECTED_ARRAY_END);
+      }
+      if (at(i) == close) {
+        ++i;
+        return true;
+      }
+      if (at(i) != ',') {
+        return fail(i, is_object ? error_code::UNEXPECTED_IN_OBJECT
+                                 : error_code::EXPECTED_ARRAY_END);
+      }
+      ++i;
+    }
+  }
+
+  // the column of the key at token `i`, the `n`th member of its record
+  bool member_column(size_t i, size_t n, size_t& column) {
+    std::string_view raw;
+    if (!find_string(_json, _tokens[i], raw)) {
+      return fail(i, error_code::UNCLOSED_STRING);
+    }
+    if (std::memchr(raw.data(), '\\', raw.size()) != nullptr) {
+      // rare, and not worth a place in the prediction
+      std::string_view key;
+      if (!decode(i, raw, key)) {
+        return false;
+      }
+      column = _columns.member_column(key);
+      return true;
+    }
+    if (n < _predicted.size() && _predicted[n].key == raw) {
+      column = _predicted[n].column;
+      return true;
+    }
+    column = _columns.member_column(raw);
+    if (n >= _predicted.size()) {
+      _predicted.resize(n + 1);
+    }
+    // the input outlives the call, so the key is not copied
+    _predicted[n] = {raw, column};
+    return true;
+  }
+
+  bool read_value(size_t& i, size_t column) {
+    if (i >= _count) {
+      return fail(i, error_code::UNEXPECTED_END);
+    }
+    const char c = at(i);
+    if (c == ',' || c == ':' || c == '}' || c == ']') {
+      return fail(i, error_code::UNEXPECTED_CHARACTER);
+    }
+    if (column == _columns.column_count()) {
+      return skip(i);
+    }
+    JsonColumn& out = _columns.column(column);
+    const std::string_view rest = _json.substr(_tokens[i]);
+    switch (c) {
+      case 'n':
+        if (!match_literal(rest, "null")) {
+          return fail(i, error_code::INVALID_NULL);
+        }
+        out.set_null();
+        break;
+      case 't':
+      case 'f': {
+        const bool value = c == 't';
+        if (!match_literal(rest, value ? "true" : "false")) {
+          return fail(i, error_code::INVALID_BOOL);
+        }
+        if (out.type() != JsonColumnType::BOOL) {
+          return fail(i, error_code::UNEXPECTED_TYPE);
+        }
+        out.set(value);
+        break;
+      }
+      case '"': {
+        if (out.type() != JsonColumnType::STRING) {
+          return fail(i, error_code::UNEXPECTED_TYPE);
+        }
+        std::string_view raw;
+        if (!find_string(_json, _tokens[i], raw)) {
+          return fail(i, error_code::UNCLOSED_STRING);
+        }
+        std::string_view value = raw;
+        if (std::memchr(raw.data(), '\\', raw.size()) != nullptr &&
+            !decode(i, raw, value)) {
+          return false;
+        }
+        out.set(value);
+        break;
+      }
+      case '{':
+      case '[':
+        return fail(i, error_code::UNEXPECTED_TYPE);
+      default: {
+        if (out.type() != JsonColumnType::INT64 &&
+            out.type() != JsonColumnType::DOUBLE) {
+          return fail(i, error_code::UNEXPECTED_TYPE);
+        }
+        std::string_view digits = rest;
+        json_number number;
+        error_code code = error_code::SUCCESS;
+        if (!parse_json_number(digits, number, code)) {
+          return fail(i, code);
+        }
+        if (out.type() == JsonColumnType::DOUBLE) {
+          out.set(number.type == number_type::INT64    ? double(number.i)
+                  : number.type == number_type::UINT64 ? double(number.u)
+                                                       : number.d);
+        } else if (number.type == number_type::INT64) {
+          out.set(number.i);
+        } else {
+          // the parser only reports UINT64 above INT64_MAX
+          return fail(i, number.type == number_type::UINT64
+                             ? error_code::NUMBER_OUT_OF_RANGE
+                             : error_code::UNEXPECTED_TYPE);
+        }
+        break;
+      }
+    }
+    ++i;
+    return true;
+  }
+
+  // past the value at token `i`, without decoding it
+  bool skip(size_t& i) {
+    const char c = at(i);
+    if (c != '{' && c != '[') {
+      ++i;
+      return true;
+    }
+    size_t depth = 0;
+    do {
+      const char t = at(i);
+      if (t == '{' || t == '[') {
+        ++depth;
+      } else if (t == '}' || t == ']') {
+        --depth;
+      }
+      ++i;
+    } while (depth > 0 && i < _count);
+    return depth == 0 || fail(i, error_code::UNEXPECTED_END);
+  }
+
+  // `decoded` views the scratch buffer until the next call
+  bool decode(size_t i, std::string_view raw, std::string_view& decoded) {
+    if (_scratch.size() < raw.size()) {
+      _scratch.resize(raw.size());
+    }
+    size_t len;
+    if (!unescape_string(raw, _scratch.data(), len)) {
+      return fail(i, error_code::INVALID_ESCAPE);
+    }
+    decoded = std::string_view(_scratch.data(), len);
+    return true;
+  }
+
+  JsonColumns& _columns;
+  std::vector<char>& _scratch;
+  // the column of each element of array records, column_count() for none
+  std::vector<size_t> _elements;
+  std::vector<predicted_key> _predicted;
+  std::string_view _json;
+  const uint32_t* _tokens = nullptr;
+  size_t _count = 0;
+  JsonError* _error = nullptr;
+};
+}  // namespace
+
+// The input is indexed in batches cut after a newline, like the batches of
+// JsonStream, so the index never grows past the batch size, whatever the
+// size of the input.
+size_t x86_implement::parse_columns_impl(PaddedStringView json,
+                                         JsonColumns& columns) {
+  const std::string_view view = json.view();
+  const size_t rows = columns.row_count();
+  columns.set_error({});
+  column_reader reader(columns, _string_buffer);
+  for (size_t start = 0; start < view.size();) {
+    size_t end = view.size();
+    if (view.size() - start > kDefaultBatchSize) {
+      const size_t newline = view.rfind('\n', start + kDefaultBatchSize - 1);
+      if (newline != std::string_view::npos && newline >= start) {
+        end = newline + 1;
+      } else {
+        const size_t after = view.find('\n', start + kDefaultBatchSize);
+        end = after == std::string_view::npos ? view.size() : after + 1;
+      }
+    }
+    const std::string_view batch = view.substr(start, end - start);
+    if (batch.size() > std::numeric_limits<uint32_t>::max()) {
+      columns.set_error({error_code::TOO_LARGE, start});
+      break;
+    }
+    if (_tokens.size() < batch.size()) {
+      _tokens.resize(batch.size());
+    }
+    if (!active_kernel().find_structural_bits(
+            reinterpret_cast<const uint8_t*>(batch.data()), batch.size(),
+            _tokens.data(), _token_count)) {
+      // the batches before this one were valid, the offset is absolute
+      columns.set_error(first_pass_error(view.substr(0, end)));
+      break;
+    }
+    JsonError error;
+    if (!reader.read_batch(batch, _tokens.data(), _token_count, error)) {
+      columns.set_error({error.code, start + error.offset});
+      break;
+    }
+    start = end;
+  }
+  return columns.row_count() - rows;
+}
+}  // namespace simdjson
@@ -0,0 +1,37 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_COMPRESS_H
+#define X86_COMPRESS_H
+#include <array>
+#include <cstdint>
+
+namespace simdjson {
+// For every mask of eight bits, the pshufb indices that move the bytes whose
+// bit is set to the front of an eight byte group, in order. The kernels
+// without a compress instruction pack a block eight bytes at a time with it.
+constexpr std::array<uint64_t, 256> make_compress_table() {
+  std::array<uint64_t, 256> table{};
+  for (uint32_t mask = 0; mask < 256; mask++) {
+    uint64_t indices = 0;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+      if (mask & (1u << i)) {
+        indices |= static_cast<uint64_t>(i) << (8 * count++);
+      }
+    }
+    // the bytes after the kept ones are zeroed
+    for (; count < 8; count++) {
+      indices |= uint64_t(0x80) << (8 * count);
+    }
+    table[mask] = indices;
+  }
+  return table;
+}
+
+inline constexpr std::array<uint64_t, 256> kCompressTable =
+    make_compress_table();
+}  // namespace simdjson
+
+#endif  // X86_COMPRESS_H
@@ -0,0 +1,218 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include "x86_stage2.h"
+#include "x86_stats.h"
+#include "x86_tape.h"
+
+namespace simdjson {
+namespace {
+uint64_t tape_word(JsonTapeType type, uint64_t payload = 0) {
+  return (static_cast<uint64_t>(type) << 56) | payload;
+}
+
+// writes the values reported by the second pass onto the tape of a
+// JsonDocument, see document.h for the layout. Strings are decoded in
+// `scratch`, which also finds where they end. With a non-null `input`, the
+// strings without escapes are borrowed from it instead of copied. `open`
+// holds the tape index of every open container.
+class tape_builder {
+ public:
+  tape_builder(std::vector<uint64_t>& tape, std::vector<char>& strings,
+               std::vector<char>& scratch, std::vector<size_t>& open,
+               const char* input)
+      : _tape(tape),
+        _strings(strings),
+        _scratch(scratch),
+        _open(open),
+        _input(input) {}
+
+  void start_object() { start_container(); }
+  void start_array() { start_container(); }
+  void end_object() {
+    end_container(JsonTapeType::START_OBJECT, JsonTapeType::END_OBJECT);
+  }
+  void end_array() {
+    end_container(JsonTapeType::START_ARRAY, JsonTapeType::END_ARRAY);
+  }
+  bool key(std::string_view rest, std::string_view& raw, error_code& error) {
+    return append_string(rest, raw, error);
+  }
+  bool string(std::string_view rest, std::string_view& raw,
+              error_code& error) {
+    count_value();
+    return append_string(rest, raw, error);
+  }
+  bool primitive(std::string_view rest, error_code& error) {
+    count_value();
+    switch (rest[0]) {
+      case 't':
+      case 'f':
+        if (match_literal(rest, "true")) {
+          _tape.push_back(tape_word(JsonTapeType::TRUE_VALUE));
+        } else if (match_literal(rest, "false")) {
+          _tape.push_back(tape_word(JsonTapeType::FALSE_VALUE));
+        } else {
+          error = error_code::INVALID_BOOL;
+          return false;
+        }
+        return true;
+      case 'n':
+        if (!match_literal(rest, "null")) {
+          error = error_code::INVALID_NULL;
+          return false;
+        }
+        _tape.push_back(tape_word(JsonTapeType::NULL_VALUE));
+        return true;
+      default:
+        break;
+    }
+    json_number number;
+    if (!parse_json_number(rest, number, error)) {
+      return false;
+    }
+    switch (number.type) {
+      case number_type::INT64:
+        _tape.push_back(tape_word(JsonTapeType::INT64));
+        _tape.push_back(static_cast<uint64_t>(number.i));
+        break;
+      case number_type::UINT64:
+        _tape.push_back(tape_word(JsonTapeType::UINT64));
+        _tape.push_back(number.u);
+        break;
+      case number_type::DOUBLE:
+        _tape.push_back(tape_word(JsonTapeType::DOUBLE));
+        _tape.push_back(std::bit_cast<uint64_t>(number.d));
+        break;
+    }
+    return true;
+  }
+
+ private:
+  // the word of the innermost container counts its values until it closes
+  void count_value() {
+    if (!_open.empty()) {
+      ++_tape[_open.back()];
+    }
+  }
+
+  void start_container() {
+    count_value();
+    _open.push_back(_tape.size());
+    // patched by end_container once the size is known
+    _tape.push_back(0);
+  }
+
+  void end_container(JsonTapeType start, JsonTapeType end) {
+    const size_t index = _open.back();
+    _open.pop_back();
+    const uint64_t count = std::min(_tape[index], kTapeCountMask);
+    _tape[index] = tape_word(start, (count << 32) | (_tape.size() + 1));
+    _tape.push_back(tape_word(end, index));
+  }
+
+  bool append_string(std::string_view rest, std::string_view& raw,
+                     error_code& error) {
+    if (_scratch.size() < rest.size()) {
+      _scratch.resize(rest.size());
+    }
+    std::string_view decoded;
+    if (!scan_string(rest, _scratch.data(), raw, decoded, error)) {
+      return false;
+    }
+    // every escape is longer than what it decodes to
+    if (_input != nullptr && decoded.size() == raw.size()) {
+      _tape.push_back(tape_word(JsonTapeType::STRING,
+                                kTapeBorrowedString | (raw.data() - _input)));
+      _tape.push_back(raw.size());
+      return true;
+    }
+    const size_t offset = _strings.size();
+    const auto len = static_cast<uint32_t>(decoded.size());
+    _strings.resize(offset + sizeof(len) + len + 1);
+    char* str = _strings.data() + offset;
+    std::memcpy(str, &len, sizeof(len));
+    std::memcpy(str + sizeof(len), decoded.data(), len);
+    str[sizeof(len) + len] = '\0';
+    _tape.push_back(tape_word(JsonTapeType::STRING, offset));
+    return true;
+  }
+
+  std::vector<uint64_t>& _tape;
+  std::vector<char>& _strings;
+  std::vector<char>& _scratch;
+  std::vector<size_t>& _open;
+  const char* _input;
+};
+}  // namespace
+
+bool build_tape(std::string_view json, const uint32_t* tokens, size_t count,
+                size_t& index, bool borrow_strings, JsonDocument& document,
+                std::vector<bool>& scopes, std::vector<char>& scratch,
+                std::vector<size_t>& containers, ParseStats* stats,
+                size_t max_depth) {
+  auto& tape = document.tape();
+  tape.push_back(0);
+  JsonError error;
+  const char* input = borrow_strings ? json.data() : nullptr;
+  document.set_input(input);
+  // a failed build may have left containers open
+  containers.clear();
+  tape_builder builder(tape, document.strings(), scratch, containers, input);
+  if (!second_pass(stats, json, tokens, count, index, builder, error, scopes,
+                   max_depth)) {
+    document.clear();
+    document.set_error(error);
+    return false;
+  }
+  tape[0] = tape_word(JsonTapeType::ROOT, tape.size());
+  tape.push_back(tape_word(JsonTapeType::ROOT));
+  return true;
+}
+
+const JsonDocument& x86_implement::parse_document_impl(
+    std::string_view json) {
+  return build_document(json, false);
+}
+
+const JsonDocument& x86_implement::parse_document_impl(
+    PaddedStringView json) {
+  return build_document(json.view(), true);
+}
+
+const JsonDocument& x86_implement::build_document(std::string_view json,
+                                                  bool borrow_strings) {
+  _document.clear();
+  if (json.size() > std::numeric_limits<uint32_t>::max()) {
+    _document.set_error({error_code::TOO_LARGE});
+    return _document;
+  }
+  if (_tokens.size() < json.size()) {
+    _tokens.resize(json.size());
+  }
+  if (!first_pass(_stats, json, _tokens.data(), _token_count)) {
+    _document.set_error(first_pass_error(json));
+    return _document;
+  }
+  // the tape needs at most two words per structural plus the root words
+  _document.tape().reserve(2 * _token_count + 2);
+  size_t index = 0;
+  // the root must be the whole input
+  if (build_tape(json, _tokens.data(), _token_count, index, borrow_strings,
+                 _document, _scopes, _string_buffer, _containers, _stats,
+                 _max_depth) &&
+      index != _token_count) {
+    _document.set_error({error_code::UNEXPECTED_CHARACTER, _tokens[index]});
+  }
+  return _document;
+}
+}  // namespace simdjson
@@ -0,0 +1,107 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <cstring>
+#include "x86_kernel.h"
+#include "x86_utf8.h"
+
+namespace simdjson {
+namespace {
+// portable stand-in for the simd registers, builds every bitmask with plain
+// 64-bit arithmetic so it runs on any x86-64 cpu
+struct simd8x64 {
+  const uint8_t* ptr;
+
+  explicit simd8x64(const uint8_t* p) : ptr(p) {}
+
+  void store(uint8_t* dst) const { std::memcpy(dst, ptr, 64); }
+  size_t compress(const uint8_t* bytes, uint64_t keep, uint8_t* out) const {
+    uint8_t* const start = out;
+    for (; keep != 0; keep &= keep - 1) {
+      *out++ = bytes[__builtin_ctzll(keep)];
+    }
+    return out - start;
+  }
+
+  // the bitmasks are built a word of eight bytes at a time: each byte of
+  // `matches` has its high bit set when it matched, the high bits are then
+  // gathered into eight consecutive bits with one multiplication
+  static uint64_t gather(uint64_t matches) {
+    return ((matches >> 7) * 0x0102040810204080) >> 56;
+  }
+
+  template <typename Match>
+  uint64_t to_bitmask(Match match) const {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 8; i++) {
+      uint64_t word;
+      std::memcpy(&word, ptr + 8 * i, sizeof(word));
+      bits |= gather(match(word)) << (8 * i);
+    }
+    return bits;
+  }
+
+  // the high bit of every byte of `word` equal to c
+  static uint64_t matches(uint64_t word, uint8_t c) {
+    const uint64_t zero = word ^ (0x0101010101010101 * c);
+    return ~(((zero & 0x7F7F7F7F7F7F7F7F) + 0x7F7F7F7F7F7F7F7F) | zero) &
+           0x8080808080808080;
+  }
+
+  uint64_t eq(uint8_t c) const {
+    return to_bitmask([c](uint64_t word) { return matches(word, c); });
+  }
+
+  // only used below 0x80
+  uint64_t lteq(uint8_t c) const {
+    return to_bitmask([c](uint64_t word) {
+      const uint64_t above =
+          ((word & 0x7F7F7F7F7F7F7F7F) + 0x0101010101010101 * (0x7F - c)) |
+          word;
+      return ~above & 0x8080808080808080;
+    });
+  }
+
+  void classify(uint64_t& op, uint64_t& whitespace) const {
+    op = to_bitmask([](uint64_t word) {
+      return matches(word, '{') | matches(word, '}') | matches(word, '[') |
+             matches(word, ']') | matches(word, ':') | matches(word, ',');
+    });
+    whitespace = to_bitmask([](uint64_t word) {
+      return matches(word, ' ') | matches(word, '\t') |
+             matches(word, '\n') | matches(word, '\r');
+    });
+  }
+};
+
+// the utf-8 automaton carried from one block to the next
+struct utf8_checker {
+  utf8_scalar_state state;
+  bool error = false;
+
+  void check_block(const uint8_t* ptr, const simd8x64&) {
+    error = error || !state.next(ptr, 64);
+  }
+  void check_eof() { error = error || state.remaining != 0; }
+  bool has_error() const { return error; }
+};
+
+uint64_t prefix_xor(uint64_t bitmask) {
+  bitmask ^= bitmask << 1;
+  bitmask ^= bitmask << 2;
+  bitmask ^= bitmask << 4;
+  bitmask ^= bitmask << 8;
+  bitmask ^= bitmask << 16;
+  bitmask ^= bitmask << 32;
+  return bitmask;
+}
+
+#include "x86_stage1_generic.h"
+#include "x86_string_generic.h"
+#include "x86_minify_generic.h"
+}  // namespace
+
+const x86_kernel fallback_kernel{"fallback", 0, false, find_structural_bits,
+                                 parse_string, escape_string, validate_utf8,
+                                 skip_whitespace, minify};
+}  // namespace simdjson
@@ -0,0 +1,120 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <string_view>
+#include "../padded_string.h"
+#include "x86_implement.h"
+
+namespace simdjson {
+namespace {
+constexpr size_t kHugePageSize = 2 << 20;
+
+size_t round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// read the whole file at once, read() may return less than asked
+bool read_all(int fd, char* out, size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::read(fd, out, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n == 0) {
+        errno = EIO;
+      }
+      return false;
+    }
+    out += n;
+    size -= n;
+  }
+  return true;
+}
+
+// an anonymous private mapping, nullptr on failure
+char* map_anonymous(size_t size) {
+  void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return data == MAP_FAILED ? nullptr : static_cast<char*>(data);
+}
+}  // namespace
+
+void PaddedString::release::operator()(char* data) const {
+  if (mapped != 0) {
+    ::munmap(data, mapped);
+  } else {
+    delete[] data;
+  }
+}
+
+bool PaddedString::load(const std::string& path, FileLoad mode) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const int saved = errno;
+    ::close(fd);
+    errno = saved;
+    return false;
+  }
+  const auto size = static_cast<size_t>(st.st_size);
+  bool ok = true;
+  if (mode == FileLoad::READ || size == 0) {
+    PaddedString buffer(size);
+    ok = read_all(fd, buffer.data(), size);
+    if (ok) {
+      *this = std::move(buffer);
+    }
+  } else {
+    // the padding must be mapped too: reserve it with an anonymous mapping
+    // and map the file over its beginning, or read the file into it
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t mapped =
+        round_up(size + kJsonPadding,
+                 mode == FileLoad::HUGE_PAGE_READ ? kHugePageSize : page);
+    char* data = map_anonymous(mapped);
+    ok = data != nullptr;
+    if (ok && mode == FileLoad::MMAP) {
+      ok = ::mmap(data, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                  fd, 0) != MAP_FAILED;
+      if (ok) {
+        ::madvise(data, size, MADV_SEQUENTIAL);
+      }
+    } else if (ok) {
+#ifdef MADV_HUGEPAGE
+      ::madvise(data, mapped, MADV_HUGEPAGE);
+#endif
+      ok = read_all(fd, data, size);
+    }
+    if (ok) {
+      _data = std::unique_ptr<char[], release>(data, release(mapped));
+      _size = size;
+    } else if (data != nullptr) {
+      const int saved = errno;
+      ::munmap(data, mapped);
+      errno = saved;
+    }
+  }
+  const int saved = errno;
+  ::close(fd);
+  errno = saved;
+  return ok;
+}
+
+Json x86_implement::parse_file_impl(const std::string& path) {
+  PaddedString json;
+  if (!json.load(path)) {
+    return Json(JsonError{error_code::IO_ERROR});
+  }
+  // the tree owns copies of its strings, the mapping can go away
+  return parse_impl(json.view());
+}
+}  // namespace simdjson
@@ -4,27 +4,135 @@
 
 #ifndef X86_IMPLEMENT_H
 #define X86_IMPLEMENT_H
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include "../arena.h"
+#include "../columnar.h"
+#include "../document.h"
 #include "../internal.h"
+#include "../node.h"
+#include "../ondemand.h"
+#include "../padded_string.h"
 #include "../result.h"
-
-constexpr bool enable_simd = false;
+#include "../stats.h"
+#include "../stream.h"
+#include "x86_kernel.h"
+#include "x86_shape.h"
 
 namespace simdjson {
+// The open containers of the tree builders: their values, and the keys of
+// the objects, wait on flat stacks until the container closes, so every
+// container is built once at its final size and each value is moved exactly
+// once, into its parent.
+struct tree_stack {
+  struct scope {
+    size_t values;
+    size_t keys;
+    bool is_object;
+  };
+
+  // the innermost container, built from the values and keys on top of the
+  // stack, which are popped
+  Json build_container(std::pmr::memory_resource* resource);
+  void clear() {
+    scopes.clear();
+    values.clear();
+    keys.clear();
+  }
+
+  std::vector<scope> scopes;
+  std::vector<Json> values;
+  std::vector<JsonString> keys;
+};
+
+// The buffers of the compact builder, kept by the parser so their capacity
+// is reused by the next parse_node. Empty between calls.
+struct node_stack {
+  struct scope {
+    size_t start;
+    // the shape of the keys so far, nullptr for arrays
+    JsonShape* shape;
+    // no key was pushed on the stack yet
+    bool by_shape;
+  };
+
+  void clear() {
+    values.clear();
+    scopes.clear();
+  }
+
+  std::vector<JsonNode> values;
+  std::vector<scope> scopes;
+  // keys and strings, decoded before they are copied into their nodes
+  std::vector<char> scratch;
+};
+
 class x86_implement final : public JsonParserBase<x86_implement> {
  public:
-  Json parse_impl(const std::string& json) {
-    if constexpr (!enable_simd) {
-      return parse_normal_impl(json);
+  Json parse_impl(std::string_view json) {
+    // the kernel is picked once at runtime, see x86_kernel.h
+    if (active_kernel().vectorized) {
+      return parse_simd_impl(json);
     }
-    return parse_simd_impl(json);
+    return parse_normal_impl(json);
   }
-  Json parse_simd_impl(const std::string& json);
-  Json parse_normal_impl(const std::string& json);
+  Json parse_simd_impl(std::string_view json,
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource());
+  Json parse_normal_impl(std::string_view json,
+                         std::pmr::memory_resource* resource =
+                             std::pmr::get_default_resource());
+  Json parse_file_impl(const std::string& path);
+  // the tree is built in _arena and owned by the parser
+  Json& parse_in_arena_impl(std::string_view json);
+  const JsonArena& arena() const { return _arena; }
+  JsonNode parse_node_impl(std::string_view json, JsonError& error);
+  // the tape document is owned by the parser and reused by the next call
+  const JsonDocument& parse_document_impl(std::string_view json);
+  const JsonDocument& parse_document_impl(PaddedStringView json);
+  // the lazy document is owned by the parser and reused by the next call
+  OnDemandDocument& iterate_impl(PaddedStringView json);
+  JsonStream parse_many_impl(PaddedStringView json, size_t batch_size);
+  size_t parse_many_impl(PaddedStringView json,
+                         std::vector<JsonDocument>& documents);
+  size_t parse_columns_impl(PaddedStringView json, JsonColumns& columns);
+  void set_stats_impl(ParseStats* stats) { _stats = stats; }
+  void set_max_depth_impl(size_t max_depth) { _max_depth = max_depth; }
   virtual ~x86_implement() = default;
 
  private:
-  using JsonToken = std::string_view;
+  const JsonDocument& build_document(std::string_view json,
+                                     bool borrow_strings);
+
+  // byte offset of every structural character and of the first byte of
+  // every scalar value, filled by the first pass of the active kernel
+  using JsonToken = uint32_t;
   std::vector<JsonToken> _tokens;
+  size_t _token_count = 0;
+  // scope stack of the second pass, kept to reuse its capacity
+  std::vector<bool> _scopes;
+  // decoded strings before they are copied into the tree or a column, as
+  // large as the input for the normal implement
+  std::vector<char> _string_buffer;
+  // empty between calls, kept to reuse its capacity
+  tree_stack _tree_stack;
+  JsonDocument _document;
+  // tape index of every open container, while a tape is built
+  std::vector<size_t> _containers;
+  // closing bracket of every opening bracket of the index, for iterate
+  std::vector<uint32_t> _matching;
+  std::vector<uint32_t> _brackets;
+  OnDemandDocument _ondemand;
+  JsonArena _arena;
+  std::optional<Json> _arena_root;
+  // shapes of the objects of parse_node, shared across calls
+  shape_table _shapes;
+  node_stack _node_stack;
+  // not owned, nullptr while no statistics are collected
+  ParseStats* _stats = nullptr;
+  size_t _max_depth = kDefaultMaxDepth;
 };
 }  // namespace simdjson
 
@@ -0,0 +1,164 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include "x86_kernel.h"
+#include <cpuid.h>
+#include <atomic>
+#include <cstdlib>
+#include "../minify.h"
+#include "../utf8.h"
+#include "x86_utf8.h"
+
+namespace simdjson {
+namespace {
+uint64_t xgetbv() {
+  uint32_t eax;
+  uint32_t edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+uint32_t read_cpu_features() {
+  uint32_t eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+  uint32_t features = 0;
+  if (ecx & bit_SSE4_2) {
+    features |= kSSE42;
+  }
+  if (ecx & bit_PCLMUL) {
+    features |= kPCLMUL;
+  }
+  if (ecx & bit_POPCNT) {
+    features |= kPOPCNT;
+  }
+  // the avx state has to be enabled by the os as well
+  if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+    return features;
+  }
+  const uint64_t xcr0 = xgetbv();
+  if ((xcr0 & 0x6) != 0x6 || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return features;
+  }
+  if (ebx & bit_AVX2) {
+    features |= kAVX2;
+  }
+  if ((ebx & bit_BMI) && (ebx & bit_BMI2)) {
+    features |= kBMI;
+  }
+  constexpr uint32_t avx512_ebx =
+      bit_AVX512F | bit_AVX512DQ | bit_AVX512BW | bit_AVX512VL;
+  if ((xcr0 & 0xE6) == 0xE6 && (ebx & avx512_ebx) == avx512_ebx &&
+      (ecx & bit_AVX512VBMI2)) {
+    features |= kAVX512;
+  }
+  return features;
+}
+
+constexpr const x86_kernel* kKernels[] = {&avx512_kernel, &avx2_kernel,
+                                          &sse42_kernel, &fallback_kernel};
+
+const x86_kernel* find_kernel(std::string_view name) {
+  for (const x86_kernel* kernel : kKernels) {
+    if (kernel->name == name && kernel->supported()) {
+      return kernel;
+    }
+  }
+  return nullptr;
+}
+
+const x86_kernel* detect_best_kernel() {
+  if (const char* forced = std::getenv("SIMDJSON_FORCE_KERNEL")) {
+    if (const x86_kernel* kernel = find_kernel(forced)) {
+      return kernel;
+    }
+  }
+  for (const x86_kernel* kernel : kKernels) {
+    if (kernel->supported()) {
+      return kernel;
+    }
+  }
+  return &fallback_kernel;
+}
+
+std::atomic<const x86_kernel*>& kernel_slot() {
+  static std::atomic<const x86_kernel*> slot{detect_best_kernel()};
+  return slot;
+}
+}  // namespace
+
+uint32_t detect_cpu_features() {
+  static const uint32_t features = read_cpu_features();
+  return features;
+}
+
+std::span<const x86_kernel* const> available_kernels() { return kKernels; }
+
+const x86_kernel& active_kernel() {
+  return *kernel_slot().load(std::memory_order_relaxed);
+}
+
+bool force_kernel(std::string_view name) {
+  const x86_kernel* kernel = find_kernel(name);
+  if (kernel == nullptr) {
+    return false;
+  }
+  kernel_slot().store(kernel, std::memory_order_relaxed);
+  return true;
+}
+
+bool validate_utf8(std::span<const char> input) {
+  return active_kernel().validate_utf8(
+      reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+bool validate_utf8(std::span<const char> input, size_t& error_offset) {
+  if (validate_utf8(input)) {
+    return true;
+  }
+  // only failures pay for the scalar pass that locates the error
+  error_offset = find_utf8_error(
+      reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  return false;
+}
+
+size_t minify(std::string_view input, char* output) {
+  return active_kernel().minify(
+      reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+      reinterpret_cast<uint8_t*>(output));
+}
+
+std::string minify(std::string_view input) {
+  std::string output(input.size(), '\0');
+  output.resize(minify(input, output.data()));
+  return output;
+}
+
+JsonError first_pass_error(std::string_view json) {
+  size_t offset;
+  if (!validate_utf8(json, offset)) {
+    return {error_code::INVALID_UTF8, offset};
+  }
+  // otherwise a string failed, found again with a plain scan since only a
+  // failed parse pays for it
+  bool in_string = false;
+  size_t quote = 0;
+  for (size_t i = 0; i < json.size(); i++) {
+    const char c = json[i];
+    if (!in_string) {
+      if (c == '"') {
+        in_string = true;
+        quote = i;
+      }
+    } else if (c == '\\') {
+      i++;
+    } else if (c == '"') {
+      in_string = false;
+    } else if (static_cast<uint8_t>(c) < 0x20) {
+      return {error_code::CONTROL_CHARACTER, i};
+    }
+  }
+  return {error_code::UNCLOSED_STRING, quote};
+}
+}  // namespace simdjson
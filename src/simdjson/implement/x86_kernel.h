@@ -0,0 +1,84 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_KERNEL_H
+#define X86_KERNEL_H
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include "../result.h"
+
+namespace simdjson {
+enum x86_cpu_feature : uint32_t {
+  kSSE42 = 1 << 0,
+  kPCLMUL = 1 << 1,
+  kAVX2 = 1 << 2,
+  kBMI = 1 << 3,
+  // avx512 f/bw/vl/dq/vbmi2 with the os saving the zmm registers
+  kAVX512 = 1 << 4,
+  kPOPCNT = 1 << 5,
+};
+
+// features of the running cpu, read with cpuid on the first call
+uint32_t detect_cpu_features();
+
+// the simd routines for one instruction set, each kernel lives in its own
+// translation unit and only that unit is compiled for the instruction set
+struct x86_kernel {
+  // name accepted by force_kernel and by SIMDJSON_FORCE_KERNEL
+  std::string_view name;
+  // x86_cpu_feature bits the kernel needs
+  uint32_t required_features;
+  // false for the portable kernel, the parser then takes the normal implement
+  bool vectorized;
+  // the first pass: fill `tokens` (room for `len` entries) with the offsets
+  // of the structural characters, return false on an unclosed string or a
+  // control character inside a string, or on invalid utf-8
+  bool (*find_structural_bits)(const uint8_t* buf, size_t len,
+                               uint32_t* tokens, size_t& count);
+  // decode the string at `src`, just past its opening quote, into `dst`
+  // until the closing quote or until `len` bytes are consumed. `dst` needs
+  // room for `len` bytes. `consumed` is the offset where the scan stopped,
+  // the closing quote if src[consumed] is one, and `written` the decoded
+  // size. Returns false on an invalid escape or a control character.
+  bool (*parse_string)(const uint8_t* src, size_t len, uint8_t* dst,
+                       size_t& consumed, size_t& written);
+  // write the `len` bytes at `src` with the quote, the backslash and the
+  // control characters escaped, without the surrounding quotes, and return
+  // the size written. `dst` needs room for 6 * `len` bytes.
+  size_t (*escape_string)(const uint8_t* src, size_t len, uint8_t* dst);
+  // the utf-8 check of the first pass on its own
+  bool (*validate_utf8)(const uint8_t* buf, size_t len);
+  // the length of the whitespace run at the front of `buf`
+  size_t (*skip_whitespace)(const uint8_t* buf, size_t len);
+  // copy `buf` to `out` without the whitespace outside of strings, return
+  // the size written. `out` needs room for `len` bytes.
+  size_t (*minify)(const uint8_t* buf, size_t len, uint8_t* out);
+
+  bool supported() const {
+    return (detect_cpu_features() & required_features) == required_features;
+  }
+};
+
+extern const x86_kernel fallback_kernel;
+extern const x86_kernel sse42_kernel;
+extern const x86_kernel avx2_kernel;
+extern const x86_kernel avx512_kernel;
+
+// every kernel compiled in, best first
+std::span<const x86_kernel* const> available_kernels();
+// the kernel the parser dispatches to: the best one the cpu supports, or the
+// one named by the SIMDJSON_FORCE_KERNEL environment variable
+const x86_kernel& active_kernel();
+// switch the active kernel by name, return false if the name is unknown or
+// the cpu lacks the instruction set
+bool force_kernel(std::string_view name);
+// the error of a failed first pass over `json`, which tells invalid utf-8
+// apart from the string errors
+JsonError first_pass_error(std::string_view json);
+}  // namespace simdjson
+
+#endif  // X86_KERNEL_H
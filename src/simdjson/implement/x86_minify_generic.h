@@ -0,0 +1,68 @@
+//
+// Created by zzy on 12/17/23.
+//
+// Whitespace skipping and minification shared by every kernel. Like
+// x86_stage1_generic.h it has no include guard: each kernel includes it
+// inside its own anonymous namespace after x86_stage1_generic.h, with
+// simd8x64 providing compress for its instruction set.
+
+// the number of whitespace bytes at the front of `buf`
+size_t skip_whitespace(const uint8_t* buf, size_t len) {
+  size_t idx = 0;
+  while (true) {
+    uint64_t op;
+    uint64_t whitespace;
+    if (len - idx >= kBlockSize) {
+      simd8x64(buf + idx).classify(op, whitespace);
+    } else {
+      // anything but whitespace ends the run at the end of the input
+      uint8_t tail[kBlockSize];
+      std::memset(tail, '0', kBlockSize);
+      std::memcpy(tail, buf + idx, len - idx);
+      simd8x64(tail).classify(op, whitespace);
+    }
+    if (~whitespace != 0) {
+      return idx + __builtin_ctzll(~whitespace);
+    }
+    idx += kBlockSize;
+  }
+}
+
+// Copy `buf` to `out` without the whitespace outside of strings. The
+// strings are tracked like in the first pass, nothing is validated. `out`
+// needs room for `len` bytes.
+size_t minify(const uint8_t* buf, size_t len, uint8_t* out) {
+  uint64_t prev_escaped = 0;
+  uint64_t prev_in_string = 0;
+  auto keep_mask = [&](const simd8x64& in) {
+    const uint64_t escaped = find_escaped(in.eq('\\'), prev_escaped);
+    const uint64_t quote = in.eq('"') & ~escaped;
+    const uint64_t in_string = prefix_xor(quote) ^ prev_in_string;
+    prev_in_string =
+        static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    uint64_t op;
+    uint64_t whitespace;
+    in.classify(op, whitespace);
+    return ~(whitespace & ~in_string);
+  };
+  uint8_t* const start = out;
+  size_t idx = 0;
+  for (; idx + kBlockSize <= len; idx += kBlockSize) {
+    const simd8x64 in(buf + idx);
+    out += in.compress(buf + idx, keep_mask(in), out);
+  }
+  if (idx < len) {
+    // the padding may fall inside an unclosed string, only the bits of the
+    // input are kept, and the packed block is copied out of a local buffer
+    uint8_t tail[kBlockSize];
+    uint8_t packed[kBlockSize];
+    std::memset(tail, ' ', kBlockSize);
+    std::memcpy(tail, buf + idx, len - idx);
+    const simd8x64 in(tail);
+    const uint64_t keep = keep_mask(in) & ((uint64_t(1) << (len - idx)) - 1);
+    const size_t count = in.compress(tail, keep, packed);
+    std::memcpy(out, packed, count);
+    out += count;
+  }
+  return out - start;
+}
@@ -0,0 +1,416 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include "../node.h"
+
+namespace simdjson {
+namespace {
+size_t hash_key(std::string_view key) {
+  return std::hash<std::string_view>{}(key);
+}
+
+// moves `count` values into the uninitialized `to` and ends the sources,
+// a node moves by copying its 16 bytes and resetting the source to null
+template <typename T>
+void relocate(T* from, size_t count, T* to) {
+  std::uninitialized_move_n(from, count, to);
+  std::destroy_n(from, count);
+}
+}  // namespace
+
+JsonShape::~JsonShape() {
+  for (JsonShape* next : _next) {
+    next->release();
+  }
+}
+
+size_t JsonShape::find(std::string_view key) const {
+  if (_index.empty()) {
+    for (size_t i = 0; i < _keys.size(); i++) {
+      if (_keys[i] == key) {
+        return i;
+      }
+    }
+    return _keys.size();
+  }
+  const size_t mask = _index.size() - 1;
+  size_t slot = hash_key(key) & mask;
+  while (_index[slot] != 0) {
+    const uint32_t i = _index[slot] - 1;
+    if (_keys[i] == key) {
+      return i;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return _keys.size();
+}
+
+void JsonShape::build_index() {
+  if (_keys.size() <= JsonNode::kIndexThreshold) {
+    return;
+  }
+  _index.assign(std::bit_ceil(2 * _keys.size()), 0);
+  const size_t mask = _index.size() - 1;
+  for (size_t i = 0; i < _keys.size(); i++) {
+    size_t slot = hash_key(_keys[i]) & mask;
+    while (_index[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    _index[slot] = static_cast<uint32_t>(i + 1);
+  }
+}
+
+JsonNode::JsonNode(std::string_view value)
+    : _type(JsonNodeType::STRING),
+      _flags(0),
+      _size(static_cast<uint32_t>(value.size())) {
+  assert(value.size() <= std::numeric_limits<uint32_t>::max());
+  _payload.u = 0;
+  if (_size <= kInlineString) {
+    std::memcpy(_payload.chars, value.data(), value.size());
+  } else {
+    _payload.str = new char[_size];
+    std::memcpy(_payload.str, value.data(), _size);
+  }
+}
+
+JsonNode JsonNode::array(size_t capacity) {
+  JsonNode node;
+  node._type = JsonNodeType::ARRAY;
+  if (capacity != 0) {
+    void* block = ::operator new(sizeof(array_block) +
+                                 capacity * sizeof(JsonNode));
+    node._payload.array = new (block) array_block{capacity};
+  }
+  return node;
+}
+
+JsonNode JsonNode::object(size_t capacity) {
+  JsonNode node;
+  node._type = JsonNodeType::OBJECT;
+  if (capacity != 0) {
+    node.reserve_members(static_cast<uint32_t>(capacity));
+  }
+  return node;
+}
+
+JsonNode JsonNode::borrowed_key(std::string_view key) {
+  if (key.size() <= kInlineString) {
+    return JsonNode(key);
+  }
+  JsonNode node;
+  node._type = JsonNodeType::STRING;
+  node._flags = kBorrowedKey;
+  node._size = static_cast<uint32_t>(key.size());
+  node._payload.str = const_cast<char*>(key.data());
+  return node;
+}
+
+JsonNode JsonNode::object_from_shape(JsonShape* shape, JsonNode* values,
+                                     size_t extra) {
+  const auto size = static_cast<uint32_t>(shape->size());
+  const auto capacity = static_cast<uint32_t>(size + extra);
+  JsonNode node;
+  node._type = JsonNodeType::OBJECT;
+  void* memory =
+      ::operator new(sizeof(object_block) + capacity * sizeof(JsonMember));
+  auto* block =
+      new (memory) object_block{capacity, 0, nullptr, shape, true};
+  shape->retain();
+  for (uint32_t i = 0; i < size; i++) {
+    new (block->members() + i)
+        JsonMember(borrowed_key(shape->key(i)), std::move(values[i]));
+  }
+  node._payload.object = block;
+  node._size = size;
+  // the shape indexes its own keys, only the members to come need one
+  if (extra != 0) {
+    node.rebuild_index();
+  }
+  return node;
+}
+
+JsonNode::JsonNode(const JsonNode& other) : JsonNode() { copy_from(other); }
+
+JsonNode& JsonNode::operator=(const JsonNode& other) {
+  if (this != &other) {
+    // `other` may live inside this node
+    JsonNode copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+JsonNode& JsonNode::operator=(JsonNode&& other) noexcept {
+  if (this != &other) {
+    // `other` may live inside this node, take it before releasing
+    JsonNode taken(std::move(other));
+    release();
+    take_bits(taken);
+    taken.reset_to_null();
+  }
+  return *this;
+}
+
+void JsonNode::release() noexcept {
+  switch (_type) {
+    case JsonNodeType::STRING:
+      if (_size > kInlineString && (_flags & kBorrowedKey) == 0) {
+        delete[] _payload.str;
+      }
+      break;
+    case JsonNodeType::ARRAY:
+      if (_payload.array != nullptr) {
+        std::destroy_n(_payload.array->elements(), _size);
+        ::operator delete(_payload.array);
+      }
+      break;
+    case JsonNodeType::OBJECT:
+      if (_payload.object != nullptr) {
+        std::destroy_n(_payload.object->members(), _size);
+        delete[] _payload.object->index;
+        if (_payload.object->shape != nullptr) {
+          _payload.object->shape->release();
+        }
+        ::operator delete(_payload.object);
+      }
+      break;
+    default:
+      break;
+  }
+  reset_to_null();
+}
+
+void JsonNode::copy_from(const JsonNode& other) {
+  switch (other._type) {
+    case JsonNodeType::STRING:
+      *this = JsonNode(other.get_value<std::string_view>());
+      break;
+    case JsonNodeType::ARRAY: {
+      JsonNode copy = array(other._size);
+      for (const JsonNode& element : other.elements()) {
+        copy.append(element);
+      }
+      *this = std::move(copy);
+      break;
+    }
+    case JsonNodeType::OBJECT: {
+      JsonNode copy = object(other._size);
+      for (const JsonMember& member : other.members()) {
+        // a borrowed key stays borrowed from the shared shape
+        JsonNode key = member._key._flags & kBorrowedKey
+                           ? borrowed_key(member.key())
+                           : JsonNode(member._key);
+        copy.emplace_member(std::move(key), JsonNode(member._value));
+      }
+      JsonShape* shape =
+          other._size == 0 ? nullptr : other._payload.object->shape;
+      if (shape != nullptr) {
+        // the copy shares the shape and borrows the same keys
+        shape->retain();
+        copy._payload.object->shape = shape;
+        copy._payload.object->by_shape = other._payload.object->by_shape;
+      }
+      *this = std::move(copy);
+      break;
+    }
+    default:
+      // scalars are plain bits
+      release();
+      take_bits(other);
+      break;
+  }
+}
+
+void JsonNode::append(JsonNode value) {
+  assert(is_array());
+  const size_t capacity =
+      _payload.array == nullptr ? 0 : _payload.array->capacity;
+  if (_size == capacity) {
+    const size_t grown = std::max<size_t>(4, 2 * capacity);
+    JsonNode bigger = array(grown);
+    if (_size != 0) {
+      relocate(_payload.array->elements(), _size,
+               bigger._payload.array->elements());
+    }
+    // the elements were relocated, only the block is freed
+    ::operator delete(_payload.array);
+    _payload.array = bigger._payload.array;
+    bigger._payload.array = nullptr;
+  }
+  new (_payload.array->elements() + _size) JsonNode(std::move(value));
+  _size++;
+}
+
+bool JsonNode::remove(size_t index) {
+  assert(is_array());
+  if (index >= _size) {
+    return false;
+  }
+  JsonNode* elements = _payload.array->elements();
+  std::move(elements + index + 1, elements + _size, elements + index);
+  std::destroy_at(elements + _size - 1);
+  _size--;
+  return true;
+}
+
+void JsonNode::reserve_members(uint32_t capacity) {
+  object_block* old = _payload.object;
+  if (old != nullptr && old->capacity >= capacity) {
+    return;
+  }
+  void* memory =
+      ::operator new(sizeof(object_block) + capacity * sizeof(JsonMember));
+  auto* block =
+      new (memory) object_block{capacity, 0, nullptr, nullptr, false};
+  if (old != nullptr) {
+    block->shape = old->shape;
+    block->by_shape = old->by_shape;
+    relocate(old->members(), _size, block->members());
+    delete[] old->index;
+    ::operator delete(old);
+  }
+  _payload.object = block;
+  rebuild_index();
+}
+
+void JsonNode::rebuild_index() {
+  object_block* block = _payload.object;
+  if (block->capacity <= kIndexThreshold) {
+    return;
+  }
+  // at most half full, so probing stays short
+  const uint32_t buckets = std::bit_ceil(2 * block->capacity);
+  if (block->buckets != buckets) {
+    delete[] block->index;
+    block->index = new uint32_t[buckets];
+    block->buckets = buckets;
+  }
+  std::fill_n(block->index, buckets, 0);
+  for (uint32_t i = 0; i < _size; i++) {
+    size_t slot = hash_key(block->members()[i].key()) & (buckets - 1);
+    while (block->index[slot] != 0) {
+      slot = (slot + 1) & (buckets - 1);
+    }
+    block->index[slot] = i + 1;
+  }
+}
+
+uint32_t JsonNode::find_member(std::string_view key) const {
+  if (_size == 0) {
+    return kNotFound;
+  }
+  object_block* block = _payload.object;
+  JsonMember* members = block->members();
+  if (block->buckets == 0) {
+    uint32_t i = 0;
+    if (block->by_shape) {
+      const size_t found = block->shape->find(key);
+      if (found != block->shape->size()) {
+        return static_cast<uint32_t>(found);
+      }
+      // members inserted after the parse follow the keys of the shape
+      i = static_cast<uint32_t>(block->shape->size());
+    }
+    for (; i < _size; i++) {
+      if (members[i].key() == key) {
+        return i;
+      }
+    }
+    return kNotFound;
+  }
+  size_t slot = hash_key(key) & (block->buckets - 1);
+  while (block->index[slot] != 0) {
+    const uint32_t i = block->index[slot] - 1;
+    if (members[i].key() == key) {
+      return i;
+    }
+    slot = (slot + 1) & (block->buckets - 1);
+  }
+  return kNotFound;
+}
+
+void JsonNode::emplace_member(JsonNode&& key, JsonNode&& value) {
+  assert(is_object() && key.is_string());
+  const uint32_t found = find_member(key.get_value<std::string_view>());
+  if (found != kNotFound) {
+    _payload.object->members()[found]._value = std::move(value);
+    return;
+  }
+  const uint32_t capacity =
+      _payload.object == nullptr ? 0 : _payload.object->capacity;
+  if (_size == capacity) {
+    reserve_members(std::max<uint32_t>(4, 2 * capacity));
+  }
+  object_block* block = _payload.object;
+  new (block->members() + _size) JsonMember(std::move(key), std::move(value));
+  if (block->buckets != 0) {
+    size_t slot = hash_key(block->members()[_size].key()) &
+                  (block->buckets - 1);
+    while (block->index[slot] != 0) {
+      slot = (slot + 1) & (block->buckets - 1);
+    }
+    block->index[slot] = _size + 1;
+  }
+  _size++;
+}
+
+JsonNode* JsonNode::find(std::string_view key) {
+  assert(is_object());
+  const uint32_t i = find_member(key);
+  return i == kNotFound ? nullptr : &_payload.object->members()[i]._value;
+}
+
+const JsonNode* JsonNode::find(std::string_view key) const {
+  return const_cast<JsonNode*>(this)->find(key);
+}
+
+JsonNode& JsonNode::operator[](std::string_view key) {
+  if (JsonNode* value = find(key)) {
+    return *value;
+  }
+  emplace_member(JsonNode(key), JsonNode());
+  return _payload.object->members()[_size - 1]._value;
+}
+
+JsonNode& JsonNode::insert_or_assign(std::string_view key, JsonNode value) {
+  if (JsonNode* found = find(key)) {
+    *found = std::move(value);
+    return *found;
+  }
+  emplace_member(JsonNode(key), std::move(value));
+  return _payload.object->members()[_size - 1]._value;
+}
+
+bool JsonNode::remove(std::string_view key) {
+  assert(is_object());
+  const uint32_t i = find_member(key);
+  if (i == kNotFound) {
+    return false;
+  }
+  JsonMember* members = _payload.object->members();
+  std::move(members + i + 1, members + _size, members + i);
+  std::destroy_at(members + _size - 1);
+  _size--;
+  // the members after `i` moved down, the positions of the shape are gone
+  _payload.object->by_shape = false;
+  rebuild_index();
+  return true;
+}
+
+const JsonShape* JsonNode::shape() const {
+  assert(is_object());
+  if (_size == 0) {
+    return nullptr;
+  }
+  const object_block* block = _payload.object;
+  return block->by_shape && block->shape->size() == _size ? block->shape
+                                                          : nullptr;
+}
+}  // namespace simdjson
@@ -0,0 +1,208 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "../node.h"
+#include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include "x86_shape.h"
+#include "x86_stage2.h"
+#include "x86_stats.h"
+
+namespace simdjson {
+shape_table::shape_table() : _root(new JsonShape) {}
+
+shape_table::~shape_table() { _root->release(); }
+
+JsonShape* shape_table::next(JsonShape* shape, std::string_view key) {
+  std::vector<JsonShape*>& next = shape->_next;
+  if (!next.empty()) {
+    if (next[shape->_predicted]->_keys.back() == key) {
+      return next[shape->_predicted];
+    }
+    for (size_t i = 0; i < next.size(); i++) {
+      if (next[i]->_keys.back() == key) {
+        shape->_predicted = i;
+        return next[i];
+      }
+    }
+  }
+  if (_count >= kMaxShapes || shape->size() >= kMaxKeys ||
+      shape->find(key) != shape->size()) {
+    return nullptr;
+  }
+  auto* child = new JsonShape;
+  child->_keys.reserve(shape->size() + 1);
+  child->_keys.assign(shape->_keys.begin(), shape->_keys.end());
+  child->_keys.emplace_back(key);
+  child->build_index();
+  next.push_back(child);
+  shape->_predicted = next.size() - 1;
+  _count++;
+  return child;
+}
+
+// Builds the JsonNode tree from the values reported by the second pass. The
+// values of the open containers wait on one flat stack, so every container
+// is allocated once at its final size when it closes. An object follows the
+// shapes of the table key by key and only pushes its values; once a key
+// leaves the table, it and the following keys are pushed before their
+// values.
+class node_builder {
+ public:
+  node_builder(shape_table& shapes, node_stack& stack)
+      : _shapes(shapes),
+        _values(stack.values),
+        _scopes(stack.scopes),
+        _scratch(stack.scratch) {}
+
+  JsonNode& root() { return _values.front(); }
+
+  void start_object() {
+    _scopes.push_back({_values.size(), _shapes.root(), true});
+  }
+  void start_array() { _scopes.push_back({_values.size(), nullptr, false}); }
+  void end_object() {
+    const scope top = close_scope();
+    const size_t shaped = top.shape->size();
+    const size_t rest = (_values.size() - top.start - shaped) / 2;
+    JsonNode object =
+        shaped == 0 ? JsonNode::object(rest)
+                    : JsonNode::object_from_shape(
+                          top.shape, &_values[top.start], rest);
+    for (size_t i = top.start + shaped; i < _values.size(); i += 2) {
+      object.emplace_member(std::move(_values[i]), std::move(_values[i + 1]));
+    }
+    _values.resize(top.start);
+    _values.push_back(std::move(object));
+  }
+  void end_array() {
+    const size_t start = close_scope().start;
+    JsonNode array = JsonNode::array(_values.size() - start);
+    for (size_t i = start; i < _values.size(); i++) {
+      array.append(std::move(_values[i]));
+    }
+    _values.resize(start);
+    _values.push_back(std::move(array));
+  }
+  bool key(std::string_view rest, std::string_view& raw, error_code& error) {
+    std::string_view key;
+    if (!decode(rest, raw, key, error)) {
+      return false;
+    }
+    scope& top = _scopes.back();
+    if (top.by_shape) {
+      if (JsonShape* next = _shapes.next(top.shape, key)) {
+        top.shape = next;
+        return true;
+      }
+      // a duplicate key or a full table, the keys so far keep the shape
+      top.by_shape = false;
+    }
+    _values.emplace_back(key);
+    return true;
+  }
+  bool string(std::string_view rest, std::string_view& raw,
+              error_code& error) {
+    std::string_view value;
+    if (!decode(rest, raw, value, error)) {
+      return false;
+    }
+    _values.emplace_back(value);
+    return true;
+  }
+  bool primitive(std::string_view rest, error_code& error) {
+    switch (rest[0]) {
+      case 't':
+      case 'f':
+        if (match_literal(rest, "true")) {
+          _values.emplace_back(true);
+        } else if (match_literal(rest, "false")) {
+          _values.emplace_back(false);
+        } else {
+          error = error_code::INVALID_BOOL;
+          return false;
+        }
+        return true;
+      case 'n':
+        if (!match_literal(rest, "null")) {
+          error = error_code::INVALID_NULL;
+          return false;
+        }
+        _values.emplace_back();
+        return true;
+      default: {
+        json_number number;
+        if (!parse_json_number(rest, number, error)) {
+          return false;
+        }
+        switch (number.type) {
+          case number_type::INT64:
+            _values.emplace_back(number.i);
+            break;
+          case number_type::UINT64:
+            _values.emplace_back(number.u);
+            break;
+          case number_type::DOUBLE:
+            _values.emplace_back(number.d);
+            break;
+        }
+        return true;
+      }
+    }
+  }
+
+ private:
+  using scope = node_stack::scope;
+
+  scope close_scope() {
+    const scope top = _scopes.back();
+    _scopes.pop_back();
+    return top;
+  }
+  // `decoded` views the scratch buffer until the next call
+  bool decode(std::string_view rest, std::string_view& raw,
+              std::string_view& decoded, error_code& error) {
+    if (_scratch.size() < rest.size()) {
+      _scratch.resize(rest.size());
+    }
+    return scan_string(rest, _scratch.data(), raw, decoded, error);
+  }
+
+  shape_table& _shapes;
+  std::vector<JsonNode>& _values;
+  std::vector<scope>& _scopes;
+  std::vector<char>& _scratch;
+};
+
+JsonNode x86_implement::parse_node_impl(std::string_view json,
+                                        JsonError& error) {
+  error = {};
+  if (json.size() > std::numeric_limits<uint32_t>::max()) {
+    error = {error_code::TOO_LARGE};
+    return JsonNode();
+  }
+  if (_tokens.size() < json.size()) {
+    _tokens.resize(json.size());
+  }
+  if (!first_pass(_stats, json, _tokens.data(), _token_count)) {
+    error = first_pass_error(json);
+    return JsonNode();
+  }
+  node_builder builder(_shapes, _node_stack);
+  size_t index = 0;
+  const bool parsed = second_pass(_stats, json, _tokens.data(), _token_count,
+                                  index, builder, error, _scopes, _max_depth);
+  // the root must be the whole input
+  if (parsed && index != _token_count) {
+    error = {error_code::UNEXPECTED_CHARACTER, _tokens[index]};
+  }
+  JsonNode root = error ? JsonNode() : std::move(builder.root());
+  _node_stack.clear();
+  return root;
+}
+}  // namespace simdjson
@@ -1,214 +1,369 @@
 //
 // Created by ziyang on 12/17/23.
 //
-#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
 #include <string_view>
 #include "x86_implement.h"
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include "x86_stats.h"
 
 namespace simdjson {
-static inline Json parse_object(std::string_view& json, JsonParseError& error);
-static inline Json parse_array(std::string_view& json, JsonParseError& error);
-static inline Json parse_number(std::string_view&, JsonParseError& error);
-static inline Json parse_string(std::string_view&, JsonParseError& error);
-static inline Json parse_bool(std::string_view&, JsonParseError& error);
-static inline Json parse_null(std::string_view&, JsonParseError& error);
-static inline Json parse_normal_impl(std::string_view&, JsonParseError&);
+static inline Json parse_string(std::string_view&, error_code& error,
+                                char* scratch,
+                                std::pmr::memory_resource* resource);
+static inline bool decode_string(std::string_view& json, error_code& error,
+                                 char* scratch, std::string_view& str);
 static inline std::string_view skip_whitespace(std::string_view& json);
 
+// The normal implement reads the text left to right in one loop, without a
+// structural index. Like walk_structurals, the grammar is a state machine
+// of labels and the open containers are kept on `stack` instead of
+// recursion, so the nesting only costs stack entries, up to `max_depth`.
+// On failure `json` is left at the offending byte. `Stats` is no_stats or
+// stats_hooks, see x86_stats.h.
+template <typename Stats>
 static inline Json parse_normal_impl(std::string_view& json,
-                                     JsonParseError& error) {
+                                     error_code& error, char* scratch,
+                                     std::pmr::memory_resource* resource,
+                                     Stats& stats, tree_stack& stack,
+                                     size_t max_depth) {
   json = skip_whitespace(json);
   if (json.empty()) {
-    error = "Empty json";
-    return Json(error);
+    error = error_code::EMPTY;
+    return Json(JsonError{error});
+  }
+
+parse_value:
+  json = skip_whitespace(json);
+  if (json.empty()) {
+    error = error_code::UNEXPECTED_END;
+    return Json(JsonError{error});
   }
   switch (json[0]) {
-    case '{': {
-      json.remove_prefix(1);
-      return parse_object(json, error);
-    }
+    case '{':
     case '[': {
+      if (stack.scopes.size() >= max_depth) {
+        error = error_code::DEPTH_EXCEEDED;
+        return Json(JsonError{error});
+      }
+      const bool is_object = json[0] == '{';
       json.remove_prefix(1);
-      return parse_array(json, error);
+      stats.start_container(is_object);
+      stack.scopes.push_back(
+          {stack.values.size(), stack.keys.size(), is_object});
+      json = skip_whitespace(json);
+      if (!json.empty() && json[0] == (is_object ? '}' : ']')) {
+        json.remove_prefix(1);
+        goto close_scope;
+      }
+      if (is_object) {
+        goto object_key;
+      }
+      goto parse_value;
     }
     case '\"': {
-      json.remove_prefix(1);
-      return parse_string(json, error);
+      const size_t size = json.size();
+      Json str = stats.string(
+          false, [&] { return parse_string(json, error, scratch, resource); });
+      if (error != error_code::SUCCESS) {
+        return Json(JsonError{error});
+      }
+      // the bytes between the quotes
+      stats.string_bytes(size - json.size() - 2);
+      stack.values.push_back(std::move(str));
+      break;
     }
     case 't':
     case 'f':
-      return parse_bool(json, error);
+      stack.values.push_back(stats.primitive(
+          json[0], [&] { return parse_bool(json, error, resource); }));
+      break;
     case 'n':
-      return parse_null(json, error);
+      stack.values.push_back(stats.primitive(
+          json[0], [&] { return parse_null(json, error, resource); }));
+      break;
     default:
-      return parse_number(json, error);
+      stack.values.push_back(stats.primitive(
+          json[0], [&] { return parse_number(json, error, resource); }));
+      break;
   }
-}
-
-static inline std::string_view skip_whitespace(std::string_view& json) {
-  while (!json.empty() && (json[0] == ' ' || json[0] == '\n' ||
-                           json[0] == '\r' || json[0] == '\t')) {
-    json.remove_prefix(1);
+  if (error != error_code::SUCCESS) {
+    return Json(JsonError{error});
   }
-  return json;
-}
+  goto value_done;
 
-static inline Json parse_object(std::string_view& json, JsonParseError& error) {
-  JsonObject obj;
-  std::string_view key{};
-  Json value{};
-  json = skip_whitespace(json);
-  while (json.size() > 0) {
-    if (json[0] == '}') {
-      json.remove_prefix(1);
-      return Json(obj);
-    }
-    if (json[0] != '\"') {
-      error = "Expected '\"' in object";
-      return Json(error);
-    }
-    json.remove_prefix(1);
-    key = json.substr(0, json.find_first_of('\"'));
-    json.remove_prefix(key.size() + 1);
+close_scope:
+  stats.end_container();
+  stack.values.push_back(stack.build_container(resource));
+
+value_done: {
+  if (stack.scopes.empty()) {
+    // the root must be the whole input
     json = skip_whitespace(json);
-    if (json[0] != ':') {
-      error = "Expected ':' in object";
-      return Json(error);
+    if (!json.empty()) {
+      error = error_code::UNEXPECTED_CHARACTER;
+      return Json(JsonError{error});
     }
+    Json root = std::move(stack.values.back());
+    stack.values.pop_back();
+    return root;
+  }
+  const bool is_object = stack.scopes.back().is_object;
+  json = skip_whitespace(json);
+  if (json.empty()) {
+    error = is_object ? error_code::EXPECTED_OBJECT_END
+                      : error_code::EXPECTED_ARRAY_END;
+    return Json(JsonError{error});
+  }
+  const char c = json[0];
+  if (c == ',') {
     json.remove_prefix(1);
-    json = skip_whitespace(json);
-    value = parse_normal_impl(json, error);
-    if (value.is_error()) {
-      return Json(error);
-    }
-    obj[std::string(key)] = value;
-    json = skip_whitespace(json);
-    if (json[0] == ',') {
-      json.remove_prefix(1);
-      json = skip_whitespace(json);
-    } else if (json[0] == '}') {
-      json.remove_prefix(1);
-      return Json(obj);
-    } else {
-      error = "Unexpected charater squence in object";
-      return Json(error);
+    if (is_object) {
+      goto object_key;
     }
+    goto parse_value;
   }
-  // never use
-  return {};
+  if (c == (is_object ? '}' : ']')) {
+    json.remove_prefix(1);
+    goto close_scope;
+  }
+  error = is_object ? error_code::UNEXPECTED_IN_OBJECT
+                    : error_code::EXPECTED_ARRAY_END;
+  return Json(JsonError{error});
 }
 
-static inline Json parse_array(std::string_view& json, JsonParseError& error) {
-  JsonArray arr;
-  Json value{};
+object_key: {
   json = skip_whitespace(json);
-  while (!json.empty()) {
-    if (json[0] == ']') {
-      json.remove_prefix(1);
-      return Json(arr);
-    }
-    value = parse_normal_impl(json, error);
-    if (value.is_error()) {
-      return Json(error);
-    }
-    arr.push_back(value);
-    json = skip_whitespace(json);
-    if (json[0] == ',') {
-      json.remove_prefix(1);
-      json = skip_whitespace(json);
+  if (json.empty() || json[0] != '\"') {
+    error = error_code::EXPECTED_KEY;
+    return Json(JsonError{error});
+  }
+  const size_t size = json.size();
+  const bool decoded = stats.string(true, [&] {
+    std::string_view raw_key;
+    if (!decode_string(json, error, scratch, raw_key)) {
+      return false;
     }
+    // the value reuses the scratch buffer
+    stack.keys.emplace_back(raw_key, resource);
+    return true;
+  });
+  if (!decoded) {
+    return Json(JsonError{error});
+  }
+  stats.string_bytes(size - json.size() - 2);
+  json = skip_whitespace(json);
+  if (json.empty() || json[0] != ':') {
+    error = error_code::EXPECTED_COLON;
+    return Json(JsonError{error});
+  }
+  json.remove_prefix(1);
+  goto parse_value;
+}
+}
+
+static inline bool is_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline std::string_view skip_whitespace(std::string_view& json) {
+  // compact input has at most one space between tokens, only a longer run,
+  // such as indentation, is handed to the kernel
+  size_t skip = 0;
+  while (skip < 2 && skip < json.size() && is_whitespace(json[skip])) {
+    ++skip;
+  }
+  if (skip == 2) {
+    skip += active_kernel().skip_whitespace(
+        reinterpret_cast<const uint8_t*>(json.data()) + skip,
+        json.size() - skip);
   }
-  return Json(JsonParseError("Expected ']' in array"));
+  json.remove_prefix(skip);
+  return json;
 }
 
-static inline Json parse_null(std::string_view& json, JsonParseError& error) {
-  if (json.size() < 4) {
-    error = "Expected 'null'";
-    return Json(error);
+Json tree_stack::build_container(std::pmr::memory_resource* resource) {
+  const scope top = scopes.back();
+  scopes.pop_back();
+  const auto first = values.begin() + top.values;
+  if (!top.is_object) {
+    Json array(std::in_place_type<JsonArray>, resource,
+               std::make_move_iterator(first),
+               std::make_move_iterator(values.end()), resource);
+    values.erase(first, values.end());
+    return array;
   }
-  if (json[0] == 'n' && json[1] == 'u' && json[2] == 'l' && json[3] == 'l') {
-    json.remove_prefix(sizeof("null") - 1);
-    return Json(NULL_T{});
+  JsonObject object(resource);
+  object.reserve(values.size() - top.values);
+  auto key = keys.begin() + top.keys;
+  for (auto value = first; value != values.end(); ++value, ++key) {
+    // the last of duplicate keys wins
+    object.insert_or_assign(std::move(*key), std::move(*value));
   }
-  error = "Expected 'null'";
-  return Json(error);
+  values.erase(first, values.end());
+  keys.erase(keys.begin() + top.keys, keys.end());
+  return Json(JsonValue(std::move(object)), resource);
 }
 
-static inline Json parse_bool(std::string_view& json, JsonParseError& error) {
-  if (json.size() < 4) {
-    error = "Expected \'true\' or \'false\'";
-    return Json(error);
+Json parse_null(std::string_view& json, error_code& error,
+                std::pmr::memory_resource* resource) {
+  if (!match_literal(json, "null")) {
+    error = error_code::INVALID_NULL;
+    return Json(JsonError{error});
   }
-  if (json[0] == 't' && json[1] == 'r' && json[2] == 'u' && json[3] == 'e') {
+  json.remove_prefix(sizeof("null") - 1);
+  return Json(JsonValue(NULL_T{}), resource);
+}
+
+Json parse_bool(std::string_view& json, error_code& error,
+                std::pmr::memory_resource* resource) {
+  if (match_literal(json, "true")) {
     json.remove_prefix(sizeof("true") - 1);
-    return Json(JsonValue(true));
+    return Json(JsonValue(true), resource);
   }
-  if (json.size() >= 5 && json[0] == 'f' && json[1] == 'a' && json[2] == 'l' &&
-      json[3] == 's' && json[4] == 'e') {
+  if (match_literal(json, "false")) {
     json.remove_prefix(sizeof("false") - 1);
-    return Json(JsonValue(false));
+    return Json(JsonValue(false), resource);
   }
-  error = "Expected 'true' or 'false'";
-  return Json(error);
+  error = error_code::INVALID_BOOL;
+  return Json(JsonError{error});
 }
 
-static inline Json parse_string(std::string_view& json, JsonParseError& error) {
-  if (json.empty()) {
-    error = "Expected '\"' in string";
-    return Json(error);
+// the string at an opening quote, decoded into `scratch` which has room for
+// the rest of the input. On failure `json` is left at the quote, or at the
+// control character.
+static inline bool decode_string(std::string_view& json, error_code& error,
+                                 char* scratch, std::string_view& str) {
+  const std::string_view rest = json.substr(1);
+  size_t consumed;
+  size_t written;
+  if (!active_kernel().parse_string(
+          reinterpret_cast<const uint8_t*>(rest.data()), rest.size(),
+          reinterpret_cast<uint8_t*>(scratch), consumed, written)) {
+    // only a failure pays for telling the two causes apart
+    for (size_t i = 0; i < rest.size() && rest[i] != '"'; i++) {
+      if (rest[i] == '\\') {
+        i++;
+      } else if (static_cast<uint8_t>(rest[i]) < 0x20) {
+        json.remove_prefix(i + 1);
+        error = error_code::CONTROL_CHARACTER;
+        return false;
+      }
+    }
+    error = error_code::INVALID_ESCAPE;
+    return false;
   }
-  const auto end = json.find_first_of('\"');
-  if (end == std::string_view::npos) {
-    error = "Expected '\"' in string";
-    return Json(error);
+  if (consumed == rest.size()) {
+    error = error_code::UNCLOSED_STRING;
+    return false;
   }
-  const auto str = json.substr(0, end);
-  json.remove_prefix(end + 1);
-  return Json(JsonValue(std::string(str)));
+  json.remove_prefix(consumed + 2);
+  str = std::string_view(scratch, written);
+  return true;
 }
 
-static inline Json parse_number(std::string_view& json, JsonParseError& error) {
-  if (json.empty()) {
-    error = "Expected number";
-    return Json(error);
-  }
+static inline Json parse_string(std::string_view& json, error_code& error,
+                                char* scratch,
+                                std::pmr::memory_resource* resource) {
   std::string_view str;
-  const auto end = json.find_first_not_of(
-      "0123456789+-.eE");  // TODO: check if this is the correct way to parse
-  if (end == std::string_view::npos) {
-    str = json;
-    json.remove_prefix(json.size());
-  } else {
-    str = json.substr(0, end);
-    json.remove_prefix(end);
-  }
-  if (str.find_first_not_of("0123456789+-.eE") != std::string_view::npos) {
-    error = "Expected number";
-    return Json(error);
-  }
-  const auto current_ending = str.find_first_of(".eE");
-  if (current_ending != std::string_view::npos) {
-    try {
-      return Json(std::stod(std::string(str)));
-    } catch ([[maybe_unused]] std::exception& e) {
-      error = "Expected number";
-      return Json(error);
-    }
+  if (!decode_string(json, error, scratch, str)) {
+    return Json(JsonError{error});
+  }
+  return Json(std::in_place_type<JsonString>, resource, str, resource);
+}
+
+bool unescape_string(std::string_view raw, char* out, size_t& len) {
+  size_t consumed;
+  return active_kernel().parse_string(
+             reinterpret_cast<const uint8_t*>(raw.data()), raw.size(),
+             reinterpret_cast<uint8_t*>(out), consumed, len) &&
+         consumed == raw.size();
+}
+
+bool scan_string(std::string_view rest, char* out, std::string_view& raw,
+                 std::string_view& decoded, error_code& error) {
+  size_t consumed;
+  size_t len;
+  // the first pass rejected control characters, only escapes can fail
+  if (!active_kernel().parse_string(
+          reinterpret_cast<const uint8_t*>(rest.data()), rest.size(),
+          reinterpret_cast<uint8_t*>(out), consumed, len)) {
+    error = error_code::INVALID_ESCAPE;
+    return false;
+  }
+  if (consumed == rest.size()) {
+    error = error_code::UNCLOSED_STRING;
+    return false;
+  }
+  raw = rest.substr(0, consumed);
+  decoded = std::string_view(out, len);
+  return true;
+}
+
+Json parse_number(std::string_view& json, error_code& error,
+                  std::pmr::memory_resource* resource) {
+  json_number number;
+  if (!parse_json_number(json, number, error)) {
+    return Json(JsonError{error});
   }
-  try {
-    return Json(std::stoll(std::string(str)));
-  } catch ([[maybe_unused]] std::out_of_range& e) {
-    return Json(std::stod(std::string(str)));
-  } catch ([[maybe_unused]] std::exception& e) {
-    error = "Expected number";
-    return Json(error);
-    // _mm_set1_pi16(short w)
+  switch (number.type) {
+    case number_type::INT64:
+      return Json(JsonValue(number.i), resource);
+    case number_type::UINT64:
+      return Json(JsonValue(number.u), resource);
+    default:
+      return Json(JsonValue(number.d), resource);
   }
 }
 
-Json x86_implement::parse_normal_impl(const std::string& json) {
-  JsonParseError error;
+Json x86_implement::parse_normal_impl(std::string_view json,
+                                      std::pmr::memory_resource* resource) {
+  // the normal implement has no first pass to check the encoding in
+  std::optional<stage_timer> timer;
+  if (_stats != nullptr) {
+    _stats->parses++;
+    _stats->bytes += json.size();
+    timer.emplace();
+  }
+  if (!active_kernel().validate_utf8(
+          reinterpret_cast<const uint8_t*>(json.data()), json.size())) {
+    return Json(first_pass_error(json));
+  }
+  error_code error = error_code::SUCCESS;
   std::string_view json_view(json);
-  return ::simdjson::parse_normal_impl(json_view, error);
+  // decoding never grows a string, so no string needs more than the input
+  if (_string_buffer.size() < json.size()) {
+    _string_buffer.resize(json.size());
+  }
+  // the values left by a failure are cleared at once, they may come from an
+  // arena that is rewound before the next call
+  if (_stats == nullptr) {
+    no_stats stats;
+    Json result = ::simdjson::parse_normal_impl(
+        json_view, error, _string_buffer.data(), resource, stats,
+        _tree_stack, _max_depth);
+    _tree_stack.clear();
+    if (error != error_code::SUCCESS) {
+      return Json(JsonError{error, json.size() - json_view.size()});
+    }
+    return result;
+  }
+  timer->stop(_stats->first_pass);
+  timer.emplace();
+  stats_hooks stats(*_stats);
+  Json result = ::simdjson::parse_normal_impl(json_view, error,
+                                              _string_buffer.data(), resource,
+                                              stats, _tree_stack, _max_depth);
+  _tree_stack.clear();
+  timer->stop(_stats->second_pass);
+  if (error != error_code::SUCCESS) {
+    return Json(JsonError{error, json.size() - json_view.size()});
+  }
+  allocation_counter::count(result, *_stats);
+  return result;
 }
 }  // namespace simdjson
\ No newline at end of file
@@ -0,0 +1,169 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace simdjson {
+namespace {
+constexpr double kPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// all eight bytes of `chunk` are '0'..'9'
+bool is_eight_digits(uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// the value of eight ascii digits loaded little endian, combined pairwise in
+// three multiplications instead of eight
+uint32_t parse_eight_digits(uint64_t chunk) {
+  constexpr uint64_t mask = 0x000000FF000000FF;
+  constexpr uint64_t mul1 = 100 + (1000000ULL << 32);
+  constexpr uint64_t mul2 = 1 + (10000ULL << 32);
+  chunk -= 0x3030303030303030;
+  chunk = (chunk * 10) + (chunk >> 8);
+  chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+  return static_cast<uint32_t>(chunk);
+}
+
+// accumulate a run of digits into `value`, 19 digits always fit in 64 bits
+// so only the digits after those are checked for overflow
+const char* parse_digits(const char* p, const char* end, uint64_t& value,
+                         size_t& digits, bool& overflow) {
+  while (end - p >= 8 && digits + 8 <= 19) {
+    uint64_t chunk;
+    std::memcpy(&chunk, p, sizeof(chunk));
+    if (!is_eight_digits(chunk)) {
+      break;
+    }
+    value = value * 100000000 + parse_eight_digits(chunk);
+    digits += 8;
+    p += 8;
+  }
+  for (; p < end && is_digit(*p); p++, digits++) {
+    const uint64_t digit = *p - '0';
+    if (digits < 19) {
+      value = value * 10 + digit;
+    } else if (__builtin_mul_overflow(value, 10, &value) ||
+               __builtin_add_overflow(value, digit, &value)) {
+      overflow = true;
+    }
+  }
+  return p;
+}
+
+}  // namespace
+
+bool parse_json_number(std::string_view& json, json_number& out,
+                       error_code& error) {
+  const char* const start = json.data();
+  const char* const end = start + json.size();
+  const char* p = start;
+  const bool negative = p < end && *p == '-';
+  p += negative;
+
+  // int: '0' or a non-zero digit followed by digits
+  uint64_t value = 0;
+  size_t digits = 0;
+  bool overflow = false;
+  if (p < end && *p == '0') {
+    ++p;
+    digits = 1;
+  } else if (p < end && is_digit(*p)) {
+    p = parse_digits(p, end, value, digits, overflow);
+  } else {
+    error = error_code::INVALID_NUMBER;
+    return false;
+  }
+  bool is_double = false;
+  int64_t exponent = 0;
+  // frac: '.' followed by at least one digit, they extend the mantissa
+  if (p < end && *p == '.') {
+    ++p;
+    const char* first = p;
+    size_t mantissa_digits = digits;
+    p = parse_digits(p, end, value, mantissa_digits, overflow);
+    if (p == first) {
+      error = error_code::INVALID_NUMBER;
+      return false;
+    }
+    exponent -= p - first;
+    is_double = true;
+  }
+  // exp: 'e' or 'E', an optional sign and at least one digit
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    const bool negative_exponent = p < end && *p == '-';
+    p += p < end && (*p == '-' || *p == '+');
+    if (p == end || !is_digit(*p)) {
+      error = error_code::INVALID_NUMBER;
+      return false;
+    }
+    int64_t exp = 0;
+    for (; p < end && is_digit(*p); p++) {
+      // large enough to make any mantissa overflow or underflow
+      if (exp < 100000) {
+        exp = exp * 10 + (*p - '0');
+      }
+    }
+    exponent += negative_exponent ? -exp : exp;
+    is_double = true;
+  }
+  if (!is_value_end(std::string_view(p, end - p))) {
+    error = error_code::INVALID_NUMBER;
+    return false;
+  }
+  json.remove_prefix(p - start);
+
+  if (!is_double && !overflow) {
+    if (!negative && value <= uint64_t(std::numeric_limits<int64_t>::max())) {
+      out.type = number_type::INT64;
+      out.i = static_cast<int64_t>(value);
+      return true;
+    }
+    if (!negative) {
+      out.type = number_type::UINT64;
+      out.u = value;
+      return true;
+    }
+    if (value <= uint64_t(std::numeric_limits<int64_t>::max()) + 1) {
+      out.type = number_type::INT64;
+      out.i = static_cast<int64_t>(0 - value);
+      return true;
+    }
+  }
+  out.type = number_type::DOUBLE;
+  // Clinger's fast path: the mantissa and the power of ten are both exact
+  // doubles, so one rounding gives the correctly rounded result
+  if (!overflow && value <= (uint64_t(1) << 53) && exponent >= -22 &&
+      exponent <= 22) {
+    double d = static_cast<double>(value);
+    d = exponent < 0 ? d / kPowersOfTen[-exponent] : d * kPowersOfTen[exponent];
+    out.d = negative ? -d : d;
+    return true;
+  }
+  // everything else goes through from_chars, which libstdc++ implements
+  // with the Eisel-Lemire algorithm and falls back to exact big decimals
+  const auto result = std::from_chars(start, p, out.d);
+  if (result.ec == std::errc::result_out_of_range && exponent < 0) {
+    // underflow rounds to zero
+    out.d = negative ? -0.0 : 0.0;
+    return true;
+  }
+  if (result.ec != std::errc() || result.ptr != p) {
+    // like every other failure, `json` is left at the start of the number
+    json = std::string_view(start, end - start);
+    error = error_code::NUMBER_OUT_OF_RANGE;
+    return false;
+  }
+  return true;
+}
+}  // namespace simdjson
@@ -0,0 +1,32 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_NUMBER_H
+#define X86_NUMBER_H
+#include <cstdint>
+#include <string_view>
+#include "../result.h"
+
+namespace simdjson {
+enum class number_type : uint8_t { INT64, UINT64, DOUBLE };
+
+struct json_number {
+  number_type type;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+  };
+};
+
+// Parse the number at the front of `json` following the JSON grammar
+// exactly, `json` is advanced past it. The number must be followed by
+// whitespace, ',', ']', '}' or the end of the input. Integers are INT64,
+// or UINT64 above INT64_MAX, and fall back to DOUBLE beyond that. Nothing
+// is allocated and no exception is thrown.
+bool parse_json_number(std::string_view& json, json_number& out,
+                       error_code& error);
+}  // namespace simdjson
+
+#endif  // X86_NUMBER_H
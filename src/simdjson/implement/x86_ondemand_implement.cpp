@@ -0,0 +1,252 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include "../ondemand.h"
+#include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_number.h"
+#include "x86_scalar.h"
+#include "x86_stage2.h"
+
+namespace simdjson {
+namespace {
+// pair every bracket of the structural index with its match, so skipping a
+// container is a single jump
+bool match_brackets(std::string_view json, const uint32_t* tokens,
+                    size_t count, uint32_t* matching,
+                    std::vector<uint32_t>& open, JsonError& error) {
+  open.clear();
+  for (size_t i = 0; i < count; i++) {
+    const char c = json[tokens[i]];
+    if (c == '{' || c == '[') {
+      open.push_back(static_cast<uint32_t>(i));
+    } else if (c == '}' || c == ']') {
+      const char expected = c == '}' ? '{' : '[';
+      if (open.empty() || json[tokens[open.back()]] != expected) {
+        error = {c == '}' ? error_code::EXPECTED_OBJECT_END
+                          : error_code::EXPECTED_ARRAY_END,
+                 tokens[i]};
+        return false;
+      }
+      matching[open.back()] = static_cast<uint32_t>(i);
+      open.pop_back();
+    }
+  }
+  if (!open.empty()) {
+    error = {error_code::UNEXPECTED_END, json.size()};
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+size_t OnDemandDocument::next_element(size_t next, size_t close) {
+  if (next == close) {
+    return close;
+  }
+  if (next < close && at(next) == ',' && next + 1 < close) {
+    return next + 1;
+  }
+  set_error({at(close) == '}' ? error_code::UNEXPECTED_IN_OBJECT
+                              : error_code::EXPECTED_ARRAY_END,
+             offset(next)});
+  return close;
+}
+
+size_t OnDemandDocument::field_value(size_t key, size_t close) {
+  if (at(key) != '"') {
+    set_error({error_code::EXPECTED_KEY, offset(key)});
+    return close;
+  }
+  if (key + 2 >= close || at(key + 1) != ':') {
+    set_error({error_code::EXPECTED_COLON, offset(key + 1)});
+    return close;
+  }
+  return key + 2;
+}
+
+std::optional<std::string_view> OnDemandDocument::string_at(size_t token) {
+  std::string_view raw;
+  if (!find_string(_json, _tokens[token], raw)) {
+    set_error({error_code::UNCLOSED_STRING, offset(token)});
+    return std::nullopt;
+  }
+  if (raw.find('\\') == std::string_view::npos) {
+    return raw;
+  }
+  // decoding never grows a string
+  auto* out = static_cast<char*>(_strings.allocate(raw.size(), 1));
+  size_t len;
+  if (!unescape_string(raw, out, len)) {
+    set_error({error_code::INVALID_ESCAPE, offset(token)});
+    return std::nullopt;
+  }
+  return std::string_view(out, len);
+}
+
+std::optional<std::string_view> OnDemandValue::get_string() const {
+  if (!is_string()) {
+    return std::nullopt;
+  }
+  return _doc->string_at(_token);
+}
+
+std::optional<json_number> OnDemandValue::get_number() const {
+  if (!is_number()) {
+    return std::nullopt;
+  }
+  json_number number;
+  error_code error;
+  std::string_view rest = _doc->_json.substr(_doc->_tokens[_token]);
+  if (!parse_json_number(rest, number, error)) {
+    _doc->set_error({error, _doc->offset(_token)});
+    return std::nullopt;
+  }
+  return number;
+}
+
+std::optional<int64_t> OnDemandValue::get_int64() const {
+  const auto number = get_number();
+  if (!number || number->type != number_type::INT64) {
+    return std::nullopt;
+  }
+  return number->i;
+}
+
+std::optional<uint64_t> OnDemandValue::get_uint64() const {
+  const auto number = get_number();
+  if (!number) {
+    return std::nullopt;
+  }
+  // the parser only reports UINT64 above INT64_MAX
+  if (number->type == number_type::INT64 && number->i >= 0) {
+    return static_cast<uint64_t>(number->i);
+  }
+  if (number->type != number_type::UINT64) {
+    return std::nullopt;
+  }
+  return number->u;
+}
+
+// integers widen to double, like a DOUBLE column
+std::optional<double> OnDemandValue::get_double() const {
+  const auto number = get_number();
+  if (!number) {
+    return std::nullopt;
+  }
+  switch (number->type) {
+    case number_type::INT64:
+      return static_cast<double>(number->i);
+    case number_type::UINT64:
+      return static_cast<double>(number->u);
+    case number_type::DOUBLE:
+      return number->d;
+  }
+  return std::nullopt;
+}
+
+std::optional<bool> OnDemandValue::get_bool() const {
+  if (!is_bool()) {
+    return std::nullopt;
+  }
+  // bounded like the numbers, so truex is not true
+  const std::string_view rest = _doc->_json.substr(_doc->_tokens[_token]);
+  if (match_literal(rest, "true")) {
+    return true;
+  }
+  if (match_literal(rest, "false")) {
+    return false;
+  }
+  _doc->set_error({error_code::INVALID_BOOL, _doc->offset(_token)});
+  return std::nullopt;
+}
+
+OnDemandField OnDemandObject::iterator::operator*() const {
+  const size_t value = _doc->field_value(_token, _close);
+  if (value == _close) {
+    return {};
+  }
+  return {_doc->string_at(_token).value_or(std::string_view()),
+          OnDemandValue(_doc, value)};
+}
+
+OnDemandObject::iterator& OnDemandObject::iterator::operator++() {
+  const size_t value = _doc->field_value(_token, _close);
+  _token = value == _close
+               ? _close
+               : _doc->next_element(_doc->skip(value), _close);
+  return *this;
+}
+
+OnDemandValue OnDemandObject::scan(size_t from, size_t to,
+                                   std::string_view key) {
+  _cursor = from;
+  while (_cursor < to) {
+    const size_t value = _doc->field_value(_cursor, _close);
+    if (value == _close) {
+      _cursor = _close;
+      break;
+    }
+    const auto name = _doc->string_at(_cursor);
+    _cursor = _doc->next_element(_doc->skip(value), _close);
+    if (name == key) {
+      return OnDemandValue(_doc, value);
+    }
+  }
+  return OnDemandValue();
+}
+
+OnDemandValue OnDemandObject::find_field(std::string_view key) {
+  return scan(_cursor, _close, key);
+}
+
+OnDemandValue OnDemandObject::find_field_unordered(std::string_view key) {
+  const size_t start = _cursor;
+  OnDemandValue value = scan(start, _close, key);
+  if (!value.exists() && start != _first) {
+    value = scan(_first, start, key);
+  }
+  return value;
+}
+
+OnDemandValue OnDemandArray::at(size_t index) const {
+  auto it = begin();
+  for (; index > 0 && it != end(); --index) {
+    ++it;
+  }
+  return it == end() ? OnDemandValue() : *it;
+}
+
+OnDemandDocument& x86_implement::iterate_impl(PaddedStringView json) {
+  const std::string_view view = json.view();
+  _ondemand.reset(view, nullptr, 0, nullptr);
+  if (view.size() > std::numeric_limits<uint32_t>::max()) {
+    _ondemand.set_error({error_code::TOO_LARGE});
+    return _ondemand;
+  }
+  if (_tokens.size() < view.size()) {
+    _tokens.resize(view.size());
+  }
+  if (_matching.size() < view.size()) {
+    _matching.resize(view.size());
+  }
+  if (!active_kernel().find_structural_bits(
+          reinterpret_cast<const uint8_t*>(view.data()), view.size(),
+          _tokens.data(), _token_count)) {
+    _ondemand.set_error(first_pass_error(view));
+    return _ondemand;
+  }
+  _ondemand.reset(view, _tokens.data(), _token_count, _matching.data());
+  JsonError error;
+  if (_token_count == 0) {
+    _ondemand.set_error({error_code::EMPTY});
+  } else if (!match_brackets(view, _tokens.data(), _token_count,
+                             _matching.data(), _brackets, error)) {
+    _ondemand.set_error(error);
+  }
+  return _ondemand;
+}
+}  // namespace simdjson
@@ -0,0 +1,150 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <string_view>
+#include "../parallel.h"
+
+namespace simdjson {
+
+JsonParallelReader::JsonParallelReader(PaddedStringView input,
+                                       const ParallelOptions& options)
+    : JsonParallelReader(input, options, nullptr) {}
+
+JsonParallelReader::JsonParallelReader(PaddedStringView input,
+                                       const ParallelOptions& options,
+                                       const Callback* callback)
+    : _input(input), _callback(callback) {
+  const std::string_view json = input.view();
+  const size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+  _bounds.push_back(0);
+  while (_bounds.back() < json.size()) {
+    const size_t start = _bounds.back();
+    size_t end = json.size();
+    if (json.size() - start > chunk_size) {
+      const size_t newline = json.find('\n', start + chunk_size - 1);
+      end = newline == std::string_view::npos ? json.size() : newline + 1;
+    }
+    _bounds.push_back(end);
+  }
+
+  _worker_count = options.threads != 0
+                      ? options.threads
+                      : std::max(1u, std::thread::hardware_concurrency());
+  _worker_count = std::max<size_t>(1, std::min(_worker_count, chunk_count()));
+  _workers = std::make_unique<worker[]>(_worker_count);
+  for (size_t i = 0; i < chunk_count(); i++) {
+    _workers[i % _worker_count].chunks.push_back(i);
+  }
+  if (_callback == nullptr) {
+    const size_t depth =
+        options.queue_depth != 0 ? options.queue_depth : 2 * _worker_count;
+    _slots.resize(depth);
+    _ready.resize(depth, 0);
+  }
+  for (size_t i = 0; i < _worker_count; i++) {
+    _threads.emplace_back(&JsonParallelReader::run_worker, this, i);
+  }
+}
+
+JsonParallelReader::~JsonParallelReader() {
+  {
+    std::lock_guard lock(_mutex);
+    _stop = true;
+  }
+  _changed.notify_all();
+  join();
+}
+
+void JsonParallelReader::join() {
+  for (auto& thread : _threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+bool JsonParallelReader::take(size_t id, size_t& chunk) {
+  {
+    worker& self = _workers[id];
+    std::lock_guard lock(self.mutex);
+    if (!self.chunks.empty()) {
+      chunk = self.chunks.front();
+      self.chunks.pop_front();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < _worker_count; i++) {
+    worker& victim = _workers[(id + i) % _worker_count];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.chunks.empty()) {
+      chunk = victim.chunks.back();
+      victim.chunks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void JsonParallelReader::parse_chunk(worker& self, size_t chunk,
+                                     JsonChunk& out) {
+  const size_t offset = _bounds[chunk];
+  // the chunk is followed by the rest of the input and its padding
+  const PaddedStringView json(_input.data() + offset,
+                              _bounds[chunk + 1] - offset,
+                              _input.size() - offset + kJsonPadding);
+  out.index = chunk;
+  out.offset = offset;
+  out.count = self.parser.parse_many(json, out.documents);
+}
+
+void JsonParallelReader::run_worker(size_t id) {
+  worker& self = _workers[id];
+  size_t chunk;
+  while (take(id, chunk)) {
+    if (_callback != nullptr) {
+      parse_chunk(self, chunk, self.chunk);
+      (*_callback)(self.chunk);
+      continue;
+    }
+    const size_t slot = chunk % _slots.size();
+    {
+      std::unique_lock lock(_mutex);
+      _changed.wait(lock,
+                    [&] { return _stop || chunk < _released + _slots.size(); });
+      if (_stop) {
+        return;
+      }
+    }
+    parse_chunk(self, chunk, _slots[slot]);
+    {
+      std::lock_guard lock(_mutex);
+      _ready[slot] = chunk + 1;
+    }
+    _changed.notify_all();
+  }
+}
+
+const JsonChunk* JsonParallelReader::next() {
+  std::unique_lock lock(_mutex);
+  if (_holding) {
+    ++_released;
+    _holding = false;
+    _changed.notify_all();
+  }
+  if (_released >= chunk_count()) {
+    return nullptr;
+  }
+  const size_t slot = _released % _slots.size();
+  _changed.wait(lock, [&] { return _ready[slot] == _released + 1; });
+  _holding = true;
+  return &_slots[slot];
+}
+
+void parse_parallel(PaddedStringView input,
+                    const std::function<void(const JsonChunk&)>& callback,
+                    const ParallelOptions& options) {
+  JsonParallelReader reader(input, options, &callback);
+  reader.join();
+}
+}  // namespace simdjson
@@ -0,0 +1,491 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <cstdint>
+#include <string_view>
+#include "../push.h"
+#include "x86_number.h"
+
+namespace simdjson {
+namespace {
+bool is_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool is_number_char(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+// a string byte that needs no attention: ascii, not a quote, a backslash or
+// a control character
+bool is_plain(char c) {
+  const auto b = static_cast<uint8_t>(c);
+  return b >= 0x20 && b < 0x80 && c != '"' && c != '\\';
+}
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void append_utf8(std::string& out, uint32_t code) {
+  if (code < 0x80) {
+    out.push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  }
+}
+}  // namespace
+
+bool JsonPushParser::feed(std::string_view chunk) {
+  if (is_error()) {
+    return false;
+  }
+  _chunk = chunk.data();
+  const char* p = chunk.data();
+  const char* const end = p + chunk.size();
+  while (p != nullptr && p != end) {
+    switch (_token) {
+      case token::NONE:
+        p = next_token(p, end);
+        break;
+      case token::STRING:
+        p = read_string(p, end);
+        break;
+      case token::NUMBER:
+        p = read_number(p, end);
+        break;
+      case token::LITERAL:
+        p = read_literal(p, end);
+        break;
+    }
+  }
+  if (p == nullptr) {
+    _offset = _error.offset;
+    return false;
+  }
+  _offset += chunk.size();
+  _error.offset = _offset;
+  return true;
+}
+
+bool JsonPushParser::finish() {
+  if (is_error()) {
+    return false;
+  }
+  // nothing follows a number at the end of the input
+  _error.offset = _offset;
+  if (_token == token::NUMBER && !emit_number(_buffer)) {
+    // the whole number is in the buffer, it failed at its first byte
+    _error.offset = _offset - _buffer.size();
+    _offset = _error.offset;
+    return false;
+  }
+  if (_token == token::STRING) {
+    _error.code = error_code::UNCLOSED_STRING;
+    return false;
+  }
+  if (_token == token::LITERAL) {
+    _error.code = error_code::UNEXPECTED_END;
+    return false;
+  }
+  if (!_stack.empty()) {
+    _error.code = _stack.back() ? error_code::EXPECTED_OBJECT_END
+                                : error_code::EXPECTED_ARRAY_END;
+    return false;
+  }
+  const size_t documents = _document_count;
+  reset();
+  _document_count = documents;
+  return true;
+}
+
+void JsonPushParser::reset() {
+  _expect = expect::DOCUMENT;
+  _token = token::NONE;
+  _stack.clear();
+  _buffer.clear();
+  _escape = escape::NONE;
+  _high = 0;
+  _utf8_need = 0;
+  _utf8_low = 0x80;
+  _utf8_high = 0xBF;
+  _after_scalar = false;
+  _offset = 0;
+  _document_count = 0;
+  _chunk = nullptr;
+  _error = {};
+}
+
+const char* JsonPushParser::next_token(const char* p, const char* end) {
+  while (p != end && is_whitespace(*p)) {
+    _after_scalar = false;
+    ++p;
+  }
+  if (p == end) {
+    return p;
+  }
+  const char c = *p;
+  switch (_expect) {
+    case expect::DOCUMENT:
+      if (_after_scalar) {
+        return fail(p, error_code::UNEXPECTED_CHARACTER);
+      }
+      return start_value(p, end);
+    case expect::VALUE:
+      return start_value(p, end);
+    case expect::VALUE_OR_CLOSE:
+      return c == ']' ? close(p, false) : start_value(p, end);
+    case expect::KEY_OR_CLOSE:
+      if (c == '}') {
+        return close(p, true);
+      }
+      [[fallthrough]];
+    case expect::KEY:
+      if (c != '"') {
+        return fail(p, error_code::EXPECTED_KEY);
+      }
+      _key = true;
+      _token = token::STRING;
+      _buffer.clear();
+      return read_string(p + 1, end);
+    case expect::COLON:
+      if (c != ':') {
+        return fail(p, error_code::EXPECTED_COLON);
+      }
+      _expect = expect::VALUE;
+      return p + 1;
+    case expect::COMMA_OR_CLOSE: {
+      const bool object = _stack.back();
+      if (c == ',') {
+        _expect = object ? expect::KEY : expect::VALUE;
+        return p + 1;
+      }
+      if (c == (object ? '}' : ']')) {
+        return close(p, object);
+      }
+      return fail(p, object ? error_code::UNEXPECTED_IN_OBJECT
+                            : error_code::EXPECTED_ARRAY_END);
+    }
+  }
+  // never use
+  return p;
+}
+
+const char* JsonPushParser::start_value(const char* p, const char* end) {
+  switch (*p) {
+    case '{':
+      _stack.push_back(true);
+      _handler.start_object();
+      _expect = expect::KEY_OR_CLOSE;
+      return p + 1;
+    case '[':
+      _stack.push_back(false);
+      _handler.start_array();
+      _expect = expect::VALUE_OR_CLOSE;
+      return p + 1;
+    case '"':
+      _key = false;
+      _token = token::STRING;
+      _buffer.clear();
+      return read_string(p + 1, end);
+    case 't':
+      _literal = "true";
+      _literal_kind = literal::TRUE_VALUE;
+      break;
+    case 'f':
+      _literal = "false";
+      _literal_kind = literal::FALSE_VALUE;
+      break;
+    case 'n':
+      _literal = "null";
+      _literal_kind = literal::NULL_VALUE;
+      break;
+    default:
+      if (*p != '-' && (*p < '0' || *p > '9')) {
+        return fail(p, error_code::UNEXPECTED_CHARACTER);
+      }
+      _token = token::NUMBER;
+      _buffer.clear();
+      return read_number(p, end);
+  }
+  _token = token::LITERAL;
+  return read_literal(p, end);
+}
+
+const char* JsonPushParser::close(const char* p, bool object) {
+  _stack.pop_back();
+  if (object) {
+    _handler.end_object();
+  } else {
+    _handler.end_array();
+  }
+  value_done(false);
+  return p + 1;
+}
+
+const char* JsonPushParser::read_string(const char* p, const char* end) {
+  while (p != end) {
+    if (_escape != escape::NONE) {
+      p = read_escape(p);
+      if (p == nullptr) {
+        return nullptr;
+      }
+      continue;
+    }
+    if (_utf8_need != 0) {
+      const auto b = static_cast<uint8_t>(*p);
+      if (b < _utf8_low || b > _utf8_high) {
+        return fail(p, error_code::INVALID_UTF8);
+      }
+      _buffer.push_back(*p++);
+      _utf8_need--;
+      _utf8_low = 0x80;
+      _utf8_high = 0xBF;
+      continue;
+    }
+    const char* q = p;
+    while (q != end && is_plain(*q)) {
+      ++q;
+    }
+    if (q == end) {
+      _buffer.append(p, q);
+      return q;
+    }
+    if (*q == '"') {
+      // a string within one chunk is reported without a copy
+      std::string_view value(p, q - p);
+      if (!_buffer.empty()) {
+        _buffer.append(p, q);
+        value = _buffer;
+      }
+      emit_string(value);
+      return q + 1;
+    }
+    _buffer.append(p, q);
+    const auto b = static_cast<uint8_t>(*q);
+    if (b == '\\') {
+      _escape = escape::START;
+      p = q + 1;
+      continue;
+    }
+    if (b < 0x20) {
+      return fail(q, error_code::CONTROL_CHARACTER);
+    }
+    // the lead byte of a utf-8 sequence, without overlong forms and
+    // surrogates
+    if (b >= 0xC2 && b <= 0xDF) {
+      _utf8_need = 1;
+    } else if (b >= 0xE0 && b <= 0xEF) {
+      _utf8_need = 2;
+      _utf8_low = b == 0xE0 ? 0xA0 : 0x80;
+      _utf8_high = b == 0xED ? 0x9F : 0xBF;
+    } else if (b >= 0xF0 && b <= 0xF4) {
+      _utf8_need = 3;
+      _utf8_low = b == 0xF0 ? 0x90 : 0x80;
+      _utf8_high = b == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      return fail(q, error_code::INVALID_UTF8);
+    }
+    _buffer.push_back(*q);
+    p = q + 1;
+  }
+  return p;
+}
+
+const char* JsonPushParser::read_escape(const char* p) {
+  const char c = *p;
+  switch (_escape) {
+    case escape::START:
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          _buffer.push_back(c);
+          break;
+        case 'b':
+          _buffer.push_back('\b');
+          break;
+        case 'f':
+          _buffer.push_back('\f');
+          break;
+        case 'n':
+          _buffer.push_back('\n');
+          break;
+        case 'r':
+          _buffer.push_back('\r');
+          break;
+        case 't':
+          _buffer.push_back('\t');
+          break;
+        case 'u':
+          _escape = escape::UNICODE;
+          _hex_count = 0;
+          _code = 0;
+          return p + 1;
+        default:
+          return fail(p, error_code::INVALID_ESCAPE);
+      }
+      _escape = escape::NONE;
+      return p + 1;
+    case escape::UNICODE: {
+      const int digit = hex_value(c);
+      if (digit < 0) {
+        return fail(p, error_code::INVALID_ESCAPE);
+      }
+      _code = _code * 16 + digit;
+      if (++_hex_count < 4) {
+        return p + 1;
+      }
+      if (_high != 0) {
+        // a high surrogate must be followed by an escaped low surrogate
+        if (_code < 0xDC00 || _code >= 0xE000) {
+          return fail(p, error_code::INVALID_ESCAPE);
+        }
+        _code = 0x10000 + ((_high - 0xD800) << 10) + (_code - 0xDC00);
+        _high = 0;
+      } else if (_code >= 0xD800 && _code < 0xDC00) {
+        _high = _code;
+        _escape = escape::LOW_BACKSLASH;
+        return p + 1;
+      } else if (_code >= 0xDC00 && _code < 0xE000) {
+        return fail(p, error_code::INVALID_ESCAPE);
+      }
+      append_utf8(_buffer, _code);
+      _escape = escape::NONE;
+      return p + 1;
+    }
+    case escape::LOW_BACKSLASH:
+    case escape::LOW_U:
+      if (c != (_escape == escape::LOW_BACKSLASH ? '\\' : 'u')) {
+        return fail(p, error_code::INVALID_ESCAPE);
+      }
+      if (_escape == escape::LOW_U) {
+        _hex_count = 0;
+        _code = 0;
+      }
+      _escape = _escape == escape::LOW_BACKSLASH ? escape::LOW_U
+                                                 : escape::UNICODE;
+      return p + 1;
+    case escape::NONE:
+      break;
+  }
+  // never use
+  return p;
+}
+
+const char* JsonPushParser::read_number(const char* p, const char* end) {
+  const char* q = p;
+  while (q != end && is_number_char(*q)) {
+    ++q;
+  }
+  if (q == end) {
+    // the number may go on in the next chunk
+    _buffer.append(p, q);
+    return q;
+  }
+  std::string_view digits(p, q - p);
+  size_t carried = 0;
+  if (!_buffer.empty()) {
+    carried = _buffer.size();
+    _buffer.append(p, q);
+    digits = _buffer;
+  }
+  if (!emit_number(digits)) {
+    // at the first byte of the number, which may be in an earlier chunk
+    return fail(p, _error.code, carried);
+  }
+  return q;
+}
+
+const char* JsonPushParser::read_literal(const char* p, const char* end) {
+  while (p != end && !_literal.empty()) {
+    if (*p != _literal[0]) {
+      return fail(p, _literal_kind == literal::NULL_VALUE
+                         ? error_code::INVALID_NULL
+                         : error_code::INVALID_BOOL);
+    }
+    _literal.remove_prefix(1);
+    ++p;
+  }
+  if (!_literal.empty()) {
+    return p;
+  }
+  _token = token::NONE;
+  if (_literal_kind == literal::NULL_VALUE) {
+    _handler.null();
+  } else {
+    _handler.boolean(_literal_kind == literal::TRUE_VALUE);
+  }
+  value_done(true);
+  return p;
+}
+
+bool JsonPushParser::emit_number(std::string_view digits) {
+  json_number number;
+  if (!parse_json_number(digits, number, _error.code)) {
+    return false;
+  }
+  _token = token::NONE;
+  switch (number.type) {
+    case number_type::INT64:
+      _handler.number(number.i);
+      break;
+    case number_type::UINT64:
+      _handler.number(number.u);
+      break;
+    case number_type::DOUBLE:
+      _handler.number(number.d);
+      break;
+  }
+  value_done(true);
+  return true;
+}
+
+void JsonPushParser::emit_string(std::string_view value) {
+  _token = token::NONE;
+  if (_key) {
+    _handler.key(value);
+    _expect = expect::COLON;
+    return;
+  }
+  _handler.string(value);
+  value_done(false);
+}
+
+void JsonPushParser::value_done(bool scalar) {
+  if (!_stack.empty()) {
+    _expect = expect::COMMA_OR_CLOSE;
+    return;
+  }
+  _handler.end_document();
+  _document_count++;
+  _expect = expect::DOCUMENT;
+  _after_scalar = scalar;
+}
+
+const char* JsonPushParser::fail(const char* p, error_code error,
+                                 size_t carried) {
+  _error = {error, _offset + static_cast<size_t>(p - _chunk) - carried};
+  return nullptr;
+}
+}  // namespace simdjson
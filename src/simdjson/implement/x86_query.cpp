@@ -0,0 +1,230 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <cstdint>
+#include "../query.h"
+
+namespace simdjson {
+namespace {
+// a pointer token or a bracketed index: digits without a leading zero
+bool parse_index(std::string_view token, size_t& index) {
+  if (token.empty() || token.size() > 19 || (token[0] == '0' && token != "0")) {
+    return false;
+  }
+  index = 0;
+  for (char c : token) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    index = index * 10 + (c - '0');
+  }
+  return true;
+}
+}  // namespace
+
+JsonPath JsonPath::from_pointer(std::string_view pointer) {
+  JsonPath path;
+  if (pointer.empty()) {
+    return path;
+  }
+  if (pointer[0] != '/') {
+    path._error = "Json pointer must start with '/'";
+    return path;
+  }
+  size_t pos = 1;
+  while (true) {
+    const size_t end = std::min(pointer.find('/', pos), pointer.size());
+    const std::string_view token = pointer.substr(pos, end - pos);
+    step next;
+    for (size_t i = 0; i < token.size(); i++) {
+      if (token[i] != '~') {
+        next.key += token[i];
+      } else if (i + 1 < token.size() && token[i + 1] == '0') {
+        next.key += '~';
+        i++;
+      } else if (i + 1 < token.size() && token[i + 1] == '1') {
+        next.key += '/';
+        i++;
+      } else {
+        path._error = "Invalid '~' escape in json pointer";
+        return path;
+      }
+    }
+    next.by_key = true;
+    next.by_index = parse_index(next.key, next.index);
+    path._steps.push_back(std::move(next));
+    if (end == pointer.size()) {
+      return path;
+    }
+    pos = end + 1;
+  }
+}
+
+JsonPath JsonPath::from_expression(std::string_view expression) {
+  JsonPath path;
+  if (expression.empty() || expression[0] != '$') {
+    path._error = "Json path must start with '$'";
+    return path;
+  }
+  size_t pos = 1;
+  while (pos < expression.size()) {
+    step next;
+    if (expression[pos] == '.') {
+      const size_t end =
+          std::min(expression.find_first_of(".[", pos + 1), expression.size());
+      next.key = expression.substr(pos + 1, end - pos - 1);
+      next.by_key = true;
+      pos = end;
+      if (next.key.empty()) {
+        path._error = "Expected a name after '.' in json path";
+        return path;
+      }
+    } else if (expression[pos] == '[' && pos + 1 < expression.size() &&
+               (expression[pos + 1] == '\'' || expression[pos + 1] == '"')) {
+      const char quote = expression[pos + 1];
+      pos += 2;
+      while (pos < expression.size() && expression[pos] != quote) {
+        if (expression[pos] == '\\' && pos + 1 < expression.size()) {
+          pos++;
+        }
+        next.key += expression[pos++];
+      }
+      if (pos + 1 >= expression.size() || expression[pos + 1] != ']') {
+        path._error = "Unclosed name in json path";
+        return path;
+      }
+      next.by_key = true;
+      pos += 2;
+    } else if (expression[pos] == '[') {
+      const size_t end = expression.find(']', pos);
+      if (end == std::string_view::npos ||
+          !parse_index(expression.substr(pos + 1, end - pos - 1),
+                       next.index)) {
+        path._error = "Expected an index in '[]' in json path";
+        return path;
+      }
+      next.by_index = true;
+      pos = end + 1;
+    } else {
+      path._error = "Expected '.' or '[' in json path";
+      return path;
+    }
+    path._steps.push_back(std::move(next));
+  }
+  return path;
+}
+
+OnDemandValue JsonPath::find(OnDemandDocument& doc) const {
+  if (is_error()) {
+    return OnDemandValue();
+  }
+  OnDemandValue value = doc.root();
+  for (const step& s : _steps) {
+    if (s.by_key && value.is_object()) {
+      value = value[std::string_view(s.key)];
+    } else if (s.by_index && value.is_array()) {
+      value = value[s.index];
+    } else {
+      return OnDemandValue();
+    }
+  }
+  return value;
+}
+
+size_t JsonQuery::add(const JsonPath& path) {
+  const size_t slot = _slots++;
+  if (path.is_error()) {
+    return slot;
+  }
+  size_t id = 0;
+  for (const JsonPath::step& s : path._steps) {
+    auto& children = _nodes[id].children;
+    auto it = std::find_if(
+        children.begin(), children.end(),
+        [&](size_t child) { return _nodes[child].step == s; });
+    if (it != children.end()) {
+      id = *it;
+      continue;
+    }
+    const size_t child = _nodes.size();
+    _nodes.emplace_back();
+    _nodes[child].step = s;
+    node& parent = _nodes[id];
+    parent.children.push_back(child);
+    if (s.by_key) {
+      parent.key_children++;
+    }
+    if (s.by_index) {
+      parent.has_index_child = true;
+      parent.last_index = std::max(parent.last_index, s.index);
+    }
+    id = child;
+  }
+  _nodes[id].slots.push_back(slot);
+  return slot;
+}
+
+void JsonQuery::evaluate(OnDemandDocument& doc,
+                         std::vector<OnDemandValue>& results) const {
+  results.assign(_slots, OnDemandValue());
+  if (!doc.is_error()) {
+    walk(0, doc.root(), results);
+  }
+}
+
+void JsonQuery::walk(size_t id, OnDemandValue value,
+                     std::vector<OnDemandValue>& results) const {
+  const node& current = _nodes[id];
+  for (size_t slot : current.slots) {
+    results[slot] = value;
+  }
+  if (auto object = value.get_value<OnDemandObject>();
+      object && current.key_children != 0) {
+    // the first 64 children are marked when found, so a duplicate key is
+    // ignored and the scan ends once each of them was seen
+    const size_t tracked = std::min<size_t>(current.children.size(), 64);
+    const size_t wanted = current.children.size() > 64
+                              ? current.children.size() + 1
+                              : current.key_children;
+    uint64_t found = 0;
+    size_t count = 0;
+    for (const OnDemandField field : *object) {
+      if (!field.value.exists()) {
+        return;
+      }
+      for (size_t i = 0; i < current.children.size(); i++) {
+        const node& child = _nodes[current.children[i]];
+        if (!child.step.by_key || child.step.key != field.key) {
+          continue;
+        }
+        if (i < tracked) {
+          if (found & (uint64_t(1) << i)) {
+            continue;
+          }
+          found |= uint64_t(1) << i;
+          count++;
+        }
+        walk(current.children[i], field.value, results);
+      }
+      if (count == wanted) {
+        return;
+      }
+    }
+  } else if (auto array = value.get_value<OnDemandArray>();
+             array && current.has_index_child) {
+    size_t index = 0;
+    for (const OnDemandValue element : *array) {
+      for (size_t child : current.children) {
+        if (_nodes[child].step.by_index &&
+            _nodes[child].step.index == index) {
+          walk(child, element, results);
+        }
+      }
+      if (index++ == current.last_index) {
+        return;
+      }
+    }
+  }
+}
+}  // namespace simdjson
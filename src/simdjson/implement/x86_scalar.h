@@ -0,0 +1,61 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_SCALAR_H
+#define X86_SCALAR_H
+#include <memory_resource>
+#include <string_view>
+#include "../result.h"
+
+namespace simdjson {
+// a scalar value ends at whitespace, ',', ']', '}' or the end of the input
+inline bool is_value_end(std::string_view rest) {
+  if (rest.empty()) {
+    return true;
+  }
+  switch (rest[0]) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+    case ',':
+    case ']':
+    case '}':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// `rest` starts with the whole literal true, false or null, so `truex` is
+// not mistaken for true. Every builder checks its literals with this.
+inline bool match_literal(std::string_view rest, std::string_view literal) {
+  return rest.starts_with(literal) && is_value_end(rest.substr(literal.size()));
+}
+
+// scalar value parsers shared by the normal and the simd implement, each one
+// consumes the value from the front of `json`, sets `error` on failure and
+// allocates the node from `resource`. The caller knows the offset.
+Json parse_number(std::string_view& json, error_code& error,
+                  std::pmr::memory_resource* resource =
+                      std::pmr::get_default_resource());
+Json parse_bool(std::string_view& json, error_code& error,
+                std::pmr::memory_resource* resource =
+                    std::pmr::get_default_resource());
+Json parse_null(std::string_view& json, error_code& error,
+                std::pmr::memory_resource* resource =
+                    std::pmr::get_default_resource());
+// decode the escapes of the raw bytes between two quotes into `out`, which
+// has room for raw.size() bytes (decoding never grows a string), `len` is
+// set to the decoded size. Returns false on an invalid escape sequence.
+bool unescape_string(std::string_view raw, char* out, size_t& len);
+// decode the string whose bytes start at the front of `rest`, just past its
+// opening quote, into `out`, which has room for rest.size() bytes. The scan
+// that decodes it also finds its closing quote: `raw` is set to the bytes
+// between the quotes and `decoded` to the string in `out`.
+bool scan_string(std::string_view rest, char* out, std::string_view& raw,
+                 std::string_view& decoded, error_code& error);
+}  // namespace simdjson
+
+#endif  // X86_SCALAR_H
@@ -0,0 +1,388 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include "../node.h"
+#include "../result.h"
+#include "x86_kernel.h"
+
+namespace simdjson {
+namespace {
+// the longest integer is "-9223372036854775808" and the longest shortest
+// double "-2.2250738585072014e-308" followed by ".0" at most
+constexpr size_t kMaxNumberSize = 32;
+// strings are escaped in pieces, so a long one does not reserve six times
+// its size at once
+constexpr size_t kStringPiece = 4096;
+// the piece escaped to the side when a span is about to be full
+constexpr size_t kSidePiece = 64;
+constexpr size_t kMinCapacity = 256;
+
+// "00" to "99", integers are written two digits at a time
+constexpr std::array<char, 200> make_digit_pairs() {
+  std::array<char, 200> pairs{};
+  for (size_t i = 0; i < 100; i++) {
+    pairs[2 * i] = static_cast<char>('0' + i / 10);
+    pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+  }
+  return pairs;
+}
+constexpr std::array<char, 200> kDigitPairs = make_digit_pairs();
+
+constexpr uint64_t kPowersOfTen[] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull,
+    10000000000000000ull,
+    100000000000000000ull,
+    1000000000000000000ull,
+    10000000000000000000ull};
+
+size_t digit_count(uint64_t value) {
+  // 1233 / 4096 is just above log10(2), the guess is the count or one less.
+  // Setting the low bit makes zero count as one digit and never moves a
+  // value across a power of ten.
+  value |= 1;
+  const size_t guess = (std::bit_width(value) * 1233) >> 12;
+  return guess + (value >= kPowersOfTen[guess]);
+}
+
+size_t write_uint(uint64_t value, char* out) {
+  const size_t count = digit_count(value);
+  char* p = out + count;
+  while (value >= 100) {
+    p -= 2;
+    std::memcpy(p, &kDigitPairs[(value % 100) * 2], 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    std::memcpy(p - 2, &kDigitPairs[value * 2], 2);
+  } else {
+    p[-1] = static_cast<char>('0' + value);
+  }
+  return count;
+}
+
+size_t write_int(int64_t value, char* out) {
+  if (value >= 0) {
+    return write_uint(value, out);
+  }
+  *out = '-';
+  return 1 + write_uint(0 - static_cast<uint64_t>(value), out + 1);
+}
+
+size_t write_double(double value, char* out) {
+  if (!std::isfinite(value)) {
+    std::memcpy(out, "null", 4);
+    return 4;
+  }
+  char* end = std::to_chars(out, out + kMaxNumberSize - 2, value).ptr;
+  // keep the value a double when it is read back
+  if (std::find_if(out, end, [](char c) { return c == '.' || c == 'e'; }) ==
+      end) {
+    *end++ = '.';
+    *end++ = '0';
+  }
+  return end - out;
+}
+
+// Where dump writes: a string grown as needed, or a fixed span. A write
+// that does not fit in the span is skipped but counted, which leaves the
+// size past the end of the span, so every later write is skipped too.
+class json_writer {
+ public:
+  explicit json_writer(std::string& out)
+      : _string(&out), _data(nullptr), _capacity(0), _size(out.size()) {}
+  explicit json_writer(std::span<char> out)
+      : _string(nullptr),
+        _data(out.data()),
+        _capacity(out.size()),
+        _size(0) {}
+
+  // runs `fill` on room for `n` bytes at the end, it returns how many of
+  // them it wrote; false if a span has no room left
+  template <typename Fill>
+  bool write(size_t n, Fill fill) {
+    if (_string == nullptr) {
+      if (_size + n > _capacity) {
+        return false;
+      }
+      _size += fill(_data + _size);
+      return true;
+    }
+    if (_size + n > _string->capacity()) {
+      _string->reserve(
+          std::max({_size + n, 2 * _string->capacity(), kMinCapacity}));
+    }
+    // the string only grows by the bytes fill wrote, none are left unset
+    _string->resize_and_overwrite(_size + n, [&](char* data, size_t) {
+      return _size + fill(data + _size);
+    });
+    _size = _string->size();
+    return true;
+  }
+  // counts `n` bytes that did not fit in a span
+  void skip(size_t n) { _size += n; }
+
+  void put(char c) {
+    if (!write(1, [c](char* out) {
+          *out = c;
+          return size_t{1};
+        })) {
+      skip(1);
+    }
+  }
+  void put(const char* str, size_t n) {
+    if (!write(n, [str, n](char* out) {
+          std::memcpy(out, str, n);
+          return n;
+        })) {
+      skip(n);
+    }
+  }
+
+  size_t size() const { return _size; }
+
+ private:
+  std::string* _string;
+  char* _data;
+  size_t _capacity;
+  size_t _size;
+};
+}  // namespace
+
+class json_serializer {
+ public:
+  json_serializer(json_writer& writer, int indent)
+      : _writer(writer),
+        _indent(indent),
+        _escape(active_kernel().escape_string) {}
+
+  void write(const Json& json, size_t depth) {
+    // an error has no value, its message is written so that it cannot be
+    // read back as json
+    if (json._result == nullptr) {
+      const std::string message = json._error.message();
+      _writer.put(message.data(), message.size());
+      return;
+    }
+    std::visit([&](const auto& value) { write_value(value, depth); },
+               *json._result);
+  }
+
+  void write(const JsonNode& node, size_t depth) {
+    switch (node.type()) {
+      case JsonNodeType::NULL_VALUE:
+        write_value(NULL_T{}, depth);
+        break;
+      case JsonNodeType::BOOL:
+        write_value(node.get_value<bool>(), depth);
+        break;
+      case JsonNodeType::INT64:
+        write_value(node.get_value<int64_t>(), depth);
+        break;
+      case JsonNodeType::UINT64:
+        write_value(node.get_value<uint64_t>(), depth);
+        break;
+      case JsonNodeType::DOUBLE:
+        write_value(node.get_value<double>(), depth);
+        break;
+      case JsonNodeType::STRING:
+        write_string(node.get_value<std::string_view>());
+        break;
+      case JsonNodeType::ARRAY:
+        write_array(node.elements(), depth);
+        break;
+      case JsonNodeType::OBJECT:
+        write_object(node.members(), depth);
+        break;
+    }
+  }
+
+ private:
+  bool pretty() const { return _indent >= 0; }
+
+  void newline(size_t depth) {
+    const size_t n = 1 + depth * _indent;
+    if (!_writer.write(n, [n](char* out) {
+          out[0] = '\n';
+          std::memset(out + 1, ' ', n - 1);
+          return n;
+        })) {
+      _writer.skip(n);
+    }
+  }
+
+  // numbers are formatted in place when there is room
+  template <typename Format>
+  void write_number(Format format) {
+    if (_writer.write(kMaxNumberSize, format)) {
+      return;
+    }
+    char buffer[kMaxNumberSize];
+    _writer.put(buffer, format(buffer));
+  }
+
+  void write_string(std::string_view str) {
+    const auto* src = reinterpret_cast<const uint8_t*>(str.data());
+    _writer.put('"');
+    size_t pos = 0;
+    while (pos < str.size()) {
+      size_t piece = std::min(str.size() - pos, kStringPiece);
+      const bool written = _writer.write(6 * piece, [&](char* out) {
+        return _escape(src + pos, piece, reinterpret_cast<uint8_t*>(out));
+      });
+      if (!written) {
+        // the end of a span is near, escape to the side and copy what fits
+        uint8_t buffer[6 * kSidePiece];
+        piece = std::min(piece, kSidePiece);
+        _writer.put(reinterpret_cast<const char*>(buffer),
+                    _escape(src + pos, piece, buffer));
+      }
+      pos += piece;
+    }
+    _writer.put('"');
+  }
+
+  void write_value(const JsonString& value, size_t) { write_string(value); }
+  void write_value(int64_t value, size_t) {
+    write_number([value](char* out) { return write_int(value, out); });
+  }
+  void write_value(uint64_t value, size_t) {
+    write_number([value](char* out) { return write_uint(value, out); });
+  }
+  void write_value(double value, size_t) {
+    write_number([value](char* out) { return write_double(value, out); });
+  }
+  void write_value(bool value, size_t) {
+    if (value) {
+      _writer.put("true", 4);
+    } else {
+      _writer.put("false", 5);
+    }
+  }
+  void write_value(const NULL_T&, size_t) { _writer.put("null", 4); }
+
+  void write_value(const JsonObject& object, size_t depth) {
+    write_object(object, depth);
+  }
+  void write_value(const JsonArray& array, size_t depth) {
+    write_array(array, depth);
+  }
+
+  static std::string_view key_of(const JsonObject::value_type& member) {
+    return member.first;
+  }
+  static const Json& value_of(const JsonObject::value_type& member) {
+    return member.second;
+  }
+  static std::string_view key_of(const JsonMember& member) {
+    return member.key();
+  }
+  static const JsonNode& value_of(const JsonMember& member) {
+    return member.value();
+  }
+
+  template <typename Members>
+  void write_object(const Members& members, size_t depth) {
+    _writer.put('{');
+    bool first = true;
+    for (const auto& member : members) {
+      if (!first) {
+        _writer.put(',');
+      }
+      first = false;
+      if (pretty()) {
+        newline(depth + 1);
+      }
+      write_string(key_of(member));
+      if (pretty()) {
+        _writer.put(": ", 2);
+      } else {
+        _writer.put(':');
+      }
+      write(value_of(member), depth + 1);
+    }
+    if (pretty() && !first) {
+      newline(depth);
+    }
+    _writer.put('}');
+  }
+
+  template <typename Elements>
+  void write_array(const Elements& elements, size_t depth) {
+    _writer.put('[');
+    bool first = true;
+    for (const auto& element : elements) {
+      if (!first) {
+        _writer.put(',');
+      }
+      first = false;
+      if (pretty()) {
+        newline(depth + 1);
+      }
+      write(element, depth + 1);
+    }
+    if (pretty() && !first) {
+      newline(depth);
+    }
+    _writer.put(']');
+  }
+
+  json_writer& _writer;
+  int _indent;
+  size_t (*_escape)(const uint8_t*, size_t, uint8_t*);
+};
+
+std::string JsonNode::dump(int indent) const {
+  std::string out;
+  dump_to(out, indent);
+  return out;
+}
+
+void JsonNode::dump_to(std::string& out, int indent) const {
+  json_writer writer(out);
+  json_serializer(writer, indent).write(*this, 0);
+}
+
+size_t JsonNode::dump_to(std::span<char> out, int indent) const {
+  json_writer writer(out);
+  json_serializer(writer, indent).write(*this, 0);
+  return writer.size();
+}
+
+std::string Json::dump(int indent) const {
+  std::string out;
+  dump_to(out, indent);
+  return out;
+}
+
+void Json::dump_to(std::string& out, int indent) const {
+  json_writer writer(out);
+  json_serializer(writer, indent).write(*this, 0);
+}
+
+size_t Json::dump_to(std::span<char> out, int indent) const {
+  json_writer writer(out);
+  json_serializer(writer, indent).write(*this, 0);
+  return writer.size();
+}
+}  // namespace simdjson
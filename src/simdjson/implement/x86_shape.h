@@ -0,0 +1,42 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_SHAPE_H
+#define X86_SHAPE_H
+#include <cstddef>
+#include <string_view>
+#include "../node.h"
+
+namespace simdjson {
+// The shapes of the objects parsed into JsonNode trees by one parser, see
+// JsonShape. The table lives as long as the parser, so a stream of records
+// parsed one by one shares the shapes of the first record. Trees keep their
+// shapes alive after the parser is gone.
+class shape_table {
+ public:
+  shape_table();
+  ~shape_table();
+  shape_table(const shape_table&) = delete;
+  shape_table& operator=(const shape_table&) = delete;
+
+  // the shape of the empty object, where every object starts
+  JsonShape* root() { return _root; }
+  size_t size() const { return _count; }
+  // the shape of `shape` followed by `key`. The key that led to the shape
+  // used last is tried first, so a repeated schema costs one comparison per
+  // key. nullptr if `shape` already has the key or a limit is reached.
+  JsonShape* next(JsonShape* shape, std::string_view key);
+
+ private:
+  // every shape copies the keys of its parent, bound what documents without
+  // a schema can spend
+  static constexpr size_t kMaxShapes = 4096;
+  static constexpr size_t kMaxKeys = 64;
+
+  JsonShape* _root;
+  size_t _count = 0;
+};
+}  // namespace simdjson
+
+#endif  // X86_SHAPE_H
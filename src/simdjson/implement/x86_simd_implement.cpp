@@ -1,10 +1,127 @@
 //
 // Created by zzy on 12/17/23.
 //
-#include <mmintrin.h>
+#include <limits>
+#include <string_view>
+#include <vector>
 #include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_scalar.h"
+#include "x86_stage2.h"
+#include "x86_stats.h"
+
 namespace simdjson {
-Json x86_implement::parse_simd_impl(const std::string& json) {
-  return {};
+namespace {
+// Builds the Json tree from the values reported by the second pass. Like
+// the normal implement, the values of the open containers wait on `stack`,
+// which is left holding the root.
+class tree_builder {
+ public:
+  // every string, container and node comes from `resource`, escaped
+  // strings are decoded in `scratch` first
+  tree_builder(tree_stack& stack, std::pmr::memory_resource* resource,
+               std::vector<char>& scratch)
+      : _stack(stack), _resource(resource), _scratch(scratch) {}
+
+  void start_object() { start(true); }
+  void start_array() { start(false); }
+  void end_object() { close(); }
+  void end_array() { close(); }
+  bool key(std::string_view rest, std::string_view& raw, error_code& error) {
+    std::string_view decoded;
+    if (!decode(rest, raw, decoded, error)) {
+      return false;
+    }
+    _stack.keys.emplace_back(decoded, _resource);
+    return true;
+  }
+  bool string(std::string_view rest, std::string_view& raw,
+              error_code& error) {
+    std::string_view decoded;
+    if (!decode(rest, raw, decoded, error)) {
+      return false;
+    }
+    _stack.values.emplace_back(std::in_place_type<JsonString>, _resource,
+                               decoded, _resource);
+    return true;
+  }
+  bool primitive(std::string_view rest, error_code& error) {
+    Json value = rest[0] == 't' || rest[0] == 'f'
+                     ? parse_bool(rest, error, _resource)
+                 : rest[0] == 'n' ? parse_null(rest, error, _resource)
+                                  : parse_number(rest, error, _resource);
+    if (error != error_code::SUCCESS) {
+      return false;
+    }
+    _stack.values.push_back(std::move(value));
+    return true;
+  }
+
+ private:
+  void start(bool is_object) {
+    _stack.scopes.push_back(
+        {_stack.values.size(), _stack.keys.size(), is_object});
+  }
+  void close() { _stack.values.push_back(_stack.build_container(_resource)); }
+
+  // `decoded` views the scratch buffer until the next call
+  bool decode(std::string_view rest, std::string_view& raw,
+              std::string_view& decoded, error_code& error) {
+    if (_scratch.size() < rest.size()) {
+      _scratch.resize(rest.size());
+    }
+    return scan_string(rest, _scratch.data(), raw, decoded, error);
+  }
+
+  tree_stack& _stack;
+  std::pmr::memory_resource* _resource;
+  std::vector<char>& _scratch;
+};
+}  // namespace
+
+Json x86_implement::parse_simd_impl(std::string_view json,
+                                    std::pmr::memory_resource* resource) {
+  if (json.size() > std::numeric_limits<uint32_t>::max()) {
+    return Json(JsonError{error_code::TOO_LARGE});
+  }
+  if (_tokens.size() < json.size()) {
+    _tokens.resize(json.size());
+  }
+  if (!first_pass(_stats, json, _tokens.data(), _token_count)) {
+    return Json(first_pass_error(json));
+  }
+  JsonError error;
+  tree_builder builder(_tree_stack, resource, _string_buffer);
+  size_t index = 0;
+  const bool parsed = second_pass(_stats, json, _tokens.data(), _token_count,
+                                  index, builder, error, _scopes, _max_depth);
+  // as in the normal implement, the values left by a failure may come from
+  // an arena that is rewound before the next call
+  if (!parsed) {
+    _tree_stack.clear();
+    return Json(error);
+  }
+  Json root = std::move(_tree_stack.values.back());
+  _tree_stack.clear();
+  // the root must be the whole input
+  if (index != _token_count) {
+    return Json(JsonError{error_code::UNEXPECTED_CHARACTER, _tokens[index]});
+  }
+  if (_stats != nullptr) {
+    allocation_counter::count(root, *_stats);
+  }
+  return root;
 }
-}  // namespace simdjson
\ No newline at end of file
+
+Json& x86_implement::parse_in_arena_impl(std::string_view json) {
+  // the previous tree lives in the arena, destroy it before rewinding
+  _arena_root.reset();
+  _arena.rewind();
+  if (active_kernel().vectorized) {
+    _arena_root.emplace(parse_simd_impl(json, &_arena));
+  } else {
+    _arena_root.emplace(parse_normal_impl(json, &_arena));
+  }
+  return *_arena_root;
+}
+}  // namespace simdjson
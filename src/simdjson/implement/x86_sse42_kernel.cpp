@@ -0,0 +1,157 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <immintrin.h>
+#include <cstring>
+#include "x86_compress.h"
+#include "x86_kernel.h"
+#include "x86_target.h"
+
+SIMDJSON_TARGET_REGION("sse4.2,pclmul,popcnt")
+namespace simdjson {
+namespace {
+// one sse register of bytes, for the utf-8 check
+struct simd8 {
+  static constexpr size_t kSize = 16;
+  __m128i value;
+
+  static simd8 splat(uint8_t c) {
+    return {_mm_set1_epi8(static_cast<char>(c))};
+  }
+  static simd8 load(const uint8_t* ptr) {
+    return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))};
+  }
+  // a lookup table of 16 bytes in every lane
+  static simd8 table(const uint8_t (&t)[16]) { return load(t); }
+
+  simd8 shr4() const {
+    return {_mm_and_si128(_mm_srli_epi16(value, 4), _mm_set1_epi8(0x0F))};
+  }
+  simd8 lookup(simd8 table) const {
+    return {_mm_shuffle_epi8(table.value, value)};
+  }
+  // the register shifted by N bytes, the gap filled from the end of `before`
+  template <int N>
+  simd8 prev(simd8 before) const {
+    return {_mm_alignr_epi8(value, before.value, 16 - N)};
+  }
+  simd8 saturating_sub(simd8 other) const {
+    return {_mm_subs_epu8(value, other.value)};
+  }
+  simd8 operator&(simd8 other) const {
+    return {_mm_and_si128(value, other.value)};
+  }
+  simd8 operator|(simd8 other) const {
+    return {_mm_or_si128(value, other.value)};
+  }
+  simd8 operator^(simd8 other) const {
+    return {_mm_xor_si128(value, other.value)};
+  }
+  bool any() const { return !_mm_testz_si128(value, value); }
+};
+
+// 64 bytes of input held in four sse registers
+struct simd8x64 {
+  static constexpr size_t kRegisters = 4;
+  __m128i chunks[4];
+
+  explicit simd8x64(const uint8_t* ptr)
+      : chunks{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 16)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 32)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 48))} {}
+
+  static uint64_t to_bitmask(__m128i m0, __m128i m1, __m128i m2, __m128i m3) {
+    const uint64_t r0 = static_cast<uint16_t>(_mm_movemask_epi8(m0));
+    const uint64_t r1 = static_cast<uint16_t>(_mm_movemask_epi8(m1));
+    const uint64_t r2 = static_cast<uint16_t>(_mm_movemask_epi8(m2));
+    const uint64_t r3 = static_cast<uint16_t>(_mm_movemask_epi8(m3));
+    return r0 | (r1 << 16) | (r2 << 32) | (r3 << 48);
+  }
+
+  simd8 reg(size_t i) const { return {chunks[i]}; }
+  bool is_ascii() const {
+    const __m128i any = _mm_or_si128(_mm_or_si128(chunks[0], chunks[1]),
+                                     _mm_or_si128(chunks[2], chunks[3]));
+    return _mm_movemask_epi8(any) == 0;
+  }
+
+  void store(uint8_t* dst) const {
+    for (int i = 0; i < 4; i++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * i), chunks[i]);
+    }
+  }
+
+  // pack the bytes of the block whose bit is set in `keep` into `out`,
+  // eight bytes at a time with a shuffle from the compress table
+  static size_t compress(const uint8_t* ptr, uint64_t keep, uint8_t* out) {
+    uint8_t* const start = out;
+    for (size_t i = 0; i < 8; i++) {
+      const auto mask = static_cast<uint8_t>(keep >> (8 * i));
+      const __m128i bytes =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr + 8 * i));
+      const __m128i shuffle =
+          _mm_cvtsi64_si128(static_cast<int64_t>(kCompressTable[mask]));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out),
+                       _mm_shuffle_epi8(bytes, shuffle));
+      out += __builtin_popcount(mask);
+    }
+    return out - start;
+  }
+
+  uint64_t eq(uint8_t c) const {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(c));
+    return to_bitmask(
+        _mm_cmpeq_epi8(chunks[0], mask), _mm_cmpeq_epi8(chunks[1], mask),
+        _mm_cmpeq_epi8(chunks[2], mask), _mm_cmpeq_epi8(chunks[3], mask));
+  }
+
+  // bytes that are (unsigned) less than or equal to c
+  uint64_t lteq(uint8_t c) const {
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(c));
+    return to_bitmask(_mm_cmpeq_epi8(_mm_max_epu8(chunks[0], mask), mask),
+                      _mm_cmpeq_epi8(_mm_max_epu8(chunks[1], mask), mask),
+                      _mm_cmpeq_epi8(_mm_max_epu8(chunks[2], mask), mask),
+                      _mm_cmpeq_epi8(_mm_max_epu8(chunks[3], mask), mask));
+  }
+
+  // same shuffle lookups as the avx2 kernel, 16 bytes at a time
+  void classify(uint64_t& op, uint64_t& whitespace) const {
+    const __m128i ws_table =
+        _mm_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n',
+                      112, 100, '\r', 100, 100);
+    const __m128i op_table = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':',
+                                           '{', ',', '}', 0, 0);
+    const __m128i curly = _mm_set1_epi8(0x20);
+    __m128i ws[4];
+    __m128i ops[4];
+    for (int i = 0; i < 4; i++) {
+      ws[i] = _mm_cmpeq_epi8(chunks[i], _mm_shuffle_epi8(ws_table, chunks[i]));
+      const __m128i curlified = _mm_or_si128(chunks[i], curly);
+      ops[i] =
+          _mm_cmpeq_epi8(curlified, _mm_shuffle_epi8(op_table, curlified));
+    }
+    whitespace = to_bitmask(ws[0], ws[1], ws[2], ws[3]);
+    op = to_bitmask(ops[0], ops[1], ops[2], ops[3]);
+  }
+};
+
+uint64_t prefix_xor(uint64_t bitmask) {
+  const __m128i all_ones = _mm_set1_epi8('\xFF');
+  const __m128i result =
+      _mm_clmulepi64_si128(_mm_set_epi64x(0, bitmask), all_ones, 0);
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(result));
+}
+
+#include "x86_utf8_generic.h"
+#include "x86_stage1_generic.h"
+#include "x86_string_generic.h"
+#include "x86_minify_generic.h"
+}  // namespace
+
+const x86_kernel sse42_kernel{"sse42", kSSE42 | kPCLMUL | kPOPCNT, true,
+                              find_structural_bits, parse_string,
+                              escape_string, validate_utf8,
+                              skip_whitespace, minify};
+}  // namespace simdjson
+SIMDJSON_UNTARGET_REGION
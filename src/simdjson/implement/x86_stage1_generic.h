@@ -0,0 +1,108 @@
+//
+// Created by zzy on 12/17/23.
+//
+// The first pass shared by every kernel. There is no include guard on
+// purpose: each kernel includes this file inside its own anonymous namespace,
+// after defining simd8x64, prefix_xor and utf8_checker for its instruction
+// set, so the code below is compiled once per instruction set.
+
+// the first pass handles the input 64 bytes at a time, one bit per byte
+constexpr size_t kBlockSize = 64;
+
+// state carried from one block to the next
+struct stage1_state {
+  uint64_t prev_escaped = 0;
+  uint64_t prev_in_string = 0;
+  uint64_t prev_scalar = 0;
+  // unescaped control characters found inside strings
+  uint64_t error = 0;
+  // the utf-8 check runs on the registers already loaded for the block
+  utf8_checker utf8;
+};
+
+// the characters escaped by an odd-length run of backslashes
+inline uint64_t find_escaped(uint64_t backslash, uint64_t& prev_escaped) {
+  constexpr uint64_t even_bits = 0x5555555555555555ULL;
+  backslash &= ~prev_escaped;
+  const uint64_t follows_escape = backslash << 1 | prev_escaped;
+  const uint64_t odd_sequence_starts =
+      backslash & ~even_bits & ~follows_escape;
+  uint64_t sequences_starting_on_even_bits;
+  prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash,
+                                        &sequences_starting_on_even_bits);
+  const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// the structural characters of one block: the operators outside of strings,
+// the opening quote of every string and the first byte of every other scalar
+inline uint64_t next_block(const uint8_t* ptr, stage1_state& state) {
+  const simd8x64 in(ptr);
+  state.utf8.check_block(ptr, in);
+  const uint64_t escaped = find_escaped(in.eq('\\'), state.prev_escaped);
+  const uint64_t quote = in.eq('"') & ~escaped;
+  const uint64_t in_string = prefix_xor(quote) ^ state.prev_in_string;
+  state.prev_in_string =
+      static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+  uint64_t op;
+  uint64_t whitespace;
+  in.classify(op, whitespace);
+  const uint64_t scalar = ~(op | whitespace);
+  const uint64_t nonquote_scalar = scalar & ~quote;
+  const uint64_t follows_nonquote_scalar =
+      nonquote_scalar << 1 | state.prev_scalar;
+  state.prev_scalar = nonquote_scalar >> 63;
+
+  // the string content and its closing quote
+  const uint64_t string_tail = in_string ^ quote;
+  state.error |= in.lteq(0x1F) & string_tail;
+  const uint64_t scalar_start = scalar & ~follows_nonquote_scalar;
+  return (op | scalar_start) & ~string_tail;
+}
+
+inline size_t flatten(uint32_t* tokens, size_t count, uint32_t base,
+                      uint64_t bits) {
+  while (bits != 0) {
+    tokens[count++] = base + static_cast<uint32_t>(__builtin_ctzll(bits));
+    bits &= bits - 1;
+  }
+  return count;
+}
+
+bool find_structural_bits(const uint8_t* buf, size_t len, uint32_t* tokens,
+                          size_t& count) {
+  stage1_state state;
+  count = 0;
+  size_t idx = 0;
+  for (; idx + kBlockSize <= len; idx += kBlockSize) {
+    count = flatten(tokens, count, static_cast<uint32_t>(idx),
+                    next_block(buf + idx, state));
+  }
+  if (idx < len) {
+    uint8_t tail[kBlockSize];
+    std::memset(tail, ' ', kBlockSize);
+    std::memcpy(tail, buf + idx, len - idx);
+    count = flatten(tokens, count, static_cast<uint32_t>(idx),
+                    next_block(tail, state));
+  }
+  state.utf8.check_eof();
+  return state.error == 0 && state.prev_in_string == 0 &&
+         !state.utf8.has_error();
+}
+
+bool validate_utf8(const uint8_t* buf, size_t len) {
+  utf8_checker checker;
+  size_t idx = 0;
+  for (; idx + kBlockSize <= len; idx += kBlockSize) {
+    checker.check_block(buf + idx, simd8x64(buf + idx));
+  }
+  if (idx < len) {
+    uint8_t tail[kBlockSize];
+    std::memset(tail, ' ', kBlockSize);
+    std::memcpy(tail, buf + idx, len - idx);
+    checker.check_block(tail, simd8x64(tail));
+  }
+  checker.check_eof();
+  return !checker.has_error();
+}
@@ -0,0 +1,171 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_STAGE2_H
+#define X86_STAGE2_H
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "../result.h"
+
+namespace simdjson {
+// the first pass already paired the quotes, so the string ends at the first
+// quote that is not escaped by an odd run of backslashes
+inline bool find_string(std::string_view json, size_t quote,
+                        std::string_view& str) {
+  size_t end = quote;
+  while (true) {
+    end = json.find('"', end + 1);
+    if (end == std::string_view::npos) {
+      return false;
+    }
+    size_t backslashes = 0;
+    while (json[end - 1 - backslashes] == '\\') {
+      ++backslashes;
+    }
+    if (backslashes % 2 == 0) {
+      break;
+    }
+  }
+  str = json.substr(quote + 1, end - quote - 1);
+  return true;
+}
+
+// The second pass: walk the structural index of one document, check the
+// grammar and report every value to the visitor, which decides what to
+// build. The open containers are kept on an explicit stack instead of
+// recursion. The visitor provides
+//   start_object() / end_object() / start_array() / end_array()
+//   bool key(std::string_view rest, std::string_view& raw, error_code& error)
+//   bool string(std::string_view rest, std::string_view& raw,
+//               error_code& error)
+//   bool primitive(std::string_view rest, error_code& error)
+// where the `rest` of a string starts past its opening quote and runs to the
+// end of the input, so the decode only meets full blocks until the string
+// ends. The visitor decodes it with scan_string, which finds the closing
+// quote in the same scan, and sets `raw` to the bytes between the quotes. The `rest` of a primitive starts at a number, true, false or null.
+// A visitor only sets the code, the offset of the error is the token it was
+// handed.
+// `index` is advanced past the document. `stack` is scratch space owned by
+// the caller (true for an object scope, false for an array scope), so its
+// capacity is kept from one document to the next. A container nested
+// deeper than `max_depth` is an error.
+template <typename Visitor>
+bool walk_structurals(std::string_view json, const uint32_t* tokens,
+                      size_t count, size_t& index, Visitor& visitor,
+                      JsonError& error, std::vector<bool>& stack,
+                      size_t max_depth = kDefaultMaxDepth) {
+  stack.clear();
+  size_t i = index;
+  const char* buf = json.data();
+  // the offset of token i, the end of the input past the last token
+  const auto fail = [&](error_code code) {
+    error = {code, i < count ? tokens[i] : json.size()};
+    return false;
+  };
+  if (i >= count) {
+    return fail(error_code::EMPTY);
+  }
+
+parse_value:
+  if (i >= count) {
+    return fail(error_code::UNEXPECTED_END);
+  }
+  switch (buf[tokens[i]]) {
+    case '{': {
+      if (stack.size() >= max_depth) {
+        return fail(error_code::DEPTH_EXCEEDED);
+      }
+      stack.push_back(true);
+      visitor.start_object();
+      if (++i < count && buf[tokens[i]] == '}') {
+        ++i;
+        goto close_scope;
+      }
+      goto object_key;
+    }
+    case '[': {
+      if (stack.size() >= max_depth) {
+        return fail(error_code::DEPTH_EXCEEDED);
+      }
+      stack.push_back(false);
+      visitor.start_array();
+      if (++i < count && buf[tokens[i]] == ']') {
+        ++i;
+        goto close_scope;
+      }
+      goto parse_value;
+    }
+    case '\"': {
+      std::string_view raw;
+      error_code code = error_code::SUCCESS;
+      if (!visitor.string(json.substr(tokens[i] + 1), raw, code)) {
+        return fail(code);
+      }
+      break;
+    }
+    default: {
+      error_code code = error_code::SUCCESS;
+      if (!visitor.primitive(json.substr(tokens[i]), code)) {
+        return fail(code);
+      }
+      break;
+    }
+  }
+  ++i;
+  goto value_done;
+
+close_scope:
+  if (stack.back()) {
+    visitor.end_object();
+  } else {
+    visitor.end_array();
+  }
+  stack.pop_back();
+
+value_done: {
+  if (stack.empty()) {
+    index = i;
+    return true;
+  }
+  const bool is_object = stack.back();
+  if (i >= count) {
+    return fail(is_object ? error_code::EXPECTED_OBJECT_END
+                          : error_code::EXPECTED_ARRAY_END);
+  }
+  const char c = buf[tokens[i]];
+  if (c == ',') {
+    ++i;
+    if (is_object) {
+      goto object_key;
+    }
+    goto parse_value;
+  }
+  if (c == (is_object ? '}' : ']')) {
+    ++i;
+    goto close_scope;
+  }
+  return fail(is_object ? error_code::UNEXPECTED_IN_OBJECT
+                        : error_code::EXPECTED_ARRAY_END);
+}
+
+object_key: {
+  if (i >= count || buf[tokens[i]] != '\"') {
+    return fail(error_code::EXPECTED_KEY);
+  }
+  std::string_view raw;
+  error_code code = error_code::SUCCESS;
+  if (!visitor.key(json.substr(tokens[i] + 1), raw, code)) {
+    return fail(code);
+  }
+  if (++i >= count || buf[tokens[i]] != ':') {
+    return fail(error_code::EXPECTED_COLON);
+  }
+  ++i;
+  goto parse_value;
+}
+}
+}  // namespace simdjson
+
+#endif  // X86_STAGE2_H
@@ -0,0 +1,60 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <vector>
+#include "x86_stats.h"
+
+namespace simdjson {
+namespace {
+void count_string(const JsonString& str, ParseStats& stats) {
+  // a string that fits the small buffer allocates nothing
+  static const size_t small = JsonString().capacity();
+  if (str.capacity() > small) {
+    stats.allocations++;
+    stats.allocated_bytes += str.capacity() + 1;
+  }
+}
+}  // namespace
+
+void allocation_counter::count(const Json& root, ParseStats& stats) {
+  // a node of an unordered_map: the next pointer, the member and the hash
+  constexpr size_t member_node =
+      sizeof(void*) + sizeof(JsonObject::value_type) + sizeof(size_t);
+  // without recursion, a tree may be as deep as the parser allows
+  std::vector<const Json*> pending{&root};
+  while (!pending.empty()) {
+    const Json* json = pending.back();
+    pending.pop_back();
+    if (json->_result == nullptr) {
+      continue;
+    }
+    stats.allocations++;
+    stats.allocated_bytes += sizeof(JsonValue);
+    if (const auto* str = std::get_if<JsonString>(json->_result.get())) {
+      count_string(*str, stats);
+    } else if (const auto* array =
+                   std::get_if<JsonArray>(json->_result.get())) {
+      if (array->capacity() != 0) {
+        stats.allocations++;
+        stats.allocated_bytes += array->capacity() * sizeof(Json);
+      }
+      for (const Json& element : *array) {
+        pending.push_back(&element);
+      }
+    } else if (const auto* object =
+                   std::get_if<JsonObject>(json->_result.get())) {
+      // a map with one bucket keeps it inside itself
+      if (object->bucket_count() > 1) {
+        stats.allocations++;
+        stats.allocated_bytes += object->bucket_count() * sizeof(void*);
+      }
+      stats.allocations += object->size();
+      stats.allocated_bytes += object->size() * member_node;
+      for (const auto& [key, value] : *object) {
+        count_string(key, stats);
+        pending.push_back(&value);
+      }
+    }
+  }
+}
+}  // namespace simdjson
@@ -0,0 +1,190 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_STATS_H
+#define X86_STATS_H
+#include <x86intrin.h>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "../result.h"
+#include "../stats.h"
+#include "x86_kernel.h"
+#include "x86_stage2.h"
+
+namespace simdjson {
+class stage_timer {
+ public:
+  stage_timer() : _cycles(__rdtsc()), _start(std::chrono::steady_clock::now()) {}
+  void stop(ParseStageTime& stage) const {
+    stage.cycles += __rdtsc() - _cycles;
+    stage.time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _start);
+  }
+
+ private:
+  uint64_t _cycles;
+  std::chrono::steady_clock::time_point _start;
+};
+
+// The statistics policy of the builders, which call the hooks for every
+// value. no_stats compiles them away, so a parse without stats runs the
+// code it ran before; stats_hooks adds to a ParseStats. Strings and
+// primitives are decoded inside the hooks so that they can be timed.
+struct no_stats {
+  void start_container(bool) {}
+  void end_container() {}
+  void string_bytes(size_t) {}
+  template <typename F>
+  auto string(bool, F&& decode) {
+    return decode();
+  }
+  template <typename F>
+  auto primitive(char, F&& decode) {
+    return decode();
+  }
+};
+
+class stats_hooks {
+ public:
+  explicit stats_hooks(ParseStats& stats) : _stats(stats) {}
+
+  void start_container(bool object) {
+    (object ? _stats.objects : _stats.arrays)++;
+    if (++_depth > _stats.max_depth) {
+      _stats.max_depth = _depth;
+    }
+  }
+  void end_container() { _depth--; }
+  void string_bytes(size_t bytes) { _stats.string_bytes += bytes; }
+  template <typename F>
+  auto string(bool key, F&& decode) {
+    (key ? _stats.keys : _stats.strings)++;
+    const uint64_t start = __rdtsc();
+    auto result = decode();
+    _stats.string_cycles += __rdtsc() - start;
+    return result;
+  }
+  // `first` is the first character of the value
+  template <typename F>
+  auto primitive(char first, F&& decode) {
+    if (first == 't' || first == 'f') {
+      _stats.bools++;
+      return decode();
+    }
+    if (first == 'n') {
+      _stats.nulls++;
+      return decode();
+    }
+    _stats.numbers++;
+    const uint64_t start = __rdtsc();
+    auto result = decode();
+    _stats.number_cycles += __rdtsc() - start;
+    return result;
+  }
+
+ private:
+  ParseStats& _stats;
+  size_t _depth = 0;
+};
+
+// a visitor of walk_structurals that reports to the hooks before handing
+// every call to `visitor`
+template <typename Visitor>
+class stats_visitor {
+ public:
+  stats_visitor(Visitor& visitor, stats_hooks& hooks)
+      : _visitor(visitor), _hooks(hooks) {}
+
+  void start_object() {
+    _hooks.start_container(true);
+    _visitor.start_object();
+  }
+  void start_array() {
+    _hooks.start_container(false);
+    _visitor.start_array();
+  }
+  void end_object() {
+    _hooks.end_container();
+    _visitor.end_object();
+  }
+  void end_array() {
+    _hooks.end_container();
+    _visitor.end_array();
+  }
+  bool key(std::string_view rest, std::string_view& raw, error_code& error) {
+    const bool ok =
+        _hooks.string(true, [&] { return _visitor.key(rest, raw, error); });
+    _hooks.string_bytes(raw.size());
+    return ok;
+  }
+  bool string(std::string_view rest, std::string_view& raw,
+              error_code& error) {
+    const bool ok = _hooks.string(
+        false, [&] { return _visitor.string(rest, raw, error); });
+    _hooks.string_bytes(raw.size());
+    return ok;
+  }
+  bool primitive(std::string_view rest, error_code& error) {
+    return _hooks.primitive(
+        rest[0], [&] { return _visitor.primitive(rest, error); });
+  }
+
+ private:
+  Visitor& _visitor;
+  stats_hooks& _hooks;
+};
+
+// the first pass of the active kernel, timed when `stats` is attached
+inline bool first_pass(ParseStats* stats, std::string_view json,
+                       uint32_t* tokens, size_t& count) {
+  const auto* input = reinterpret_cast<const uint8_t*>(json.data());
+  if (stats == nullptr) {
+    return active_kernel().find_structural_bits(input, json.size(), tokens,
+                                                count);
+  }
+  stats->parses++;
+  stats->bytes += json.size();
+  const stage_timer timer;
+  const bool ok =
+      active_kernel().find_structural_bits(input, json.size(), tokens, count);
+  timer.stop(stats->first_pass);
+  return ok;
+}
+
+// walk_structurals, through stats_visitor when `stats` is attached
+template <typename Visitor>
+bool second_pass(ParseStats* stats, std::string_view json,
+                 const uint32_t* tokens, size_t count, size_t& index,
+                 Visitor& visitor, JsonError& error,
+                 std::vector<bool>& stack,
+                 size_t max_depth = kDefaultMaxDepth) {
+  if (stats == nullptr) {
+    return walk_structurals(json, tokens, count, index, visitor, error,
+                            stack, max_depth);
+  }
+  const stage_timer timer;
+  stats_hooks hooks(*stats);
+  stats_visitor<Visitor> counted(visitor, hooks);
+  const bool ok = walk_structurals(json, tokens, count, index, counted,
+                                   error, stack, max_depth);
+  timer.stop(stats->second_pass);
+  return ok;
+}
+
+// Counts what a finished tree took from its memory resource into `stats`:
+// the node of every value, the buffer of every string and key longer than
+// the small string buffer, the elements of every array and the buckets and
+// members of every object. The nodes of the members belong to the standard
+// library, their size is estimated. A tree keeps its resource and can
+// outlive its parser, so it is counted once it is built instead of through
+// a wrapper of the resource.
+class allocation_counter {
+ public:
+  static void count(const Json& root, ParseStats& stats);
+};
+}  // namespace simdjson
+
+#endif  // X86_STATS_H
@@ -0,0 +1,255 @@
+//
+// Created by zzy on 12/17/23.
+//
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include "../stream.h"
+#include "x86_implement.h"
+#include "x86_kernel.h"
+#include "x86_stats.h"
+#include "x86_tape.h"
+
+namespace simdjson {
+
+JsonStream::JsonStream(PaddedStringView input, size_t batch_size,
+                       ParseStats* stats, size_t max_depth)
+    : _input(input),
+      _batch_size(std::clamp<size_t>(batch_size, 1,
+                                     std::numeric_limits<uint32_t>::max())),
+      _find_structural_bits(active_kernel().find_structural_bits),
+      _stats(stats),
+      _max_depth(max_depth) {
+  if (_input.size() > _batch_size) {
+    _worker = std::thread(&JsonStream::run_worker, this);
+  }
+}
+
+JsonStream::~JsonStream() {
+  if (_worker.joinable()) {
+    {
+      std::lock_guard lock(_mutex);
+      _stop = true;
+    }
+    _changed.notify_all();
+    _worker.join();
+  }
+}
+
+// A newline is never inside a string, so cutting there keeps every string
+// in one batch. The batch is then trimmed to its last complete document,
+// found by tracking the depth over the structural index. A document larger
+// than the batch doubles the window until it fits.
+void JsonStream::index_batch(batch& out, size_t start) const {
+  const std::string_view json = _input.view();
+  out.start = start;
+  out.error = {};
+  out.first_pass = {};
+  size_t window = _batch_size;
+  while (true) {
+    size_t end = json.size();
+    if (json.size() - start > window) {
+      const size_t newline = json.rfind('\n', start + window - 1);
+      if (newline != std::string_view::npos && newline >= start) {
+        end = newline + 1;
+      } else {
+        const size_t after = json.find('\n', start + window);
+        end = after == std::string_view::npos ? json.size() : after + 1;
+      }
+    }
+    out.size = end - start;
+    if (out.size > std::numeric_limits<uint32_t>::max()) {
+      out.error = {error_code::TOO_LARGE, start};
+      out.next_start = json.size();
+      return;
+    }
+    if (out.tokens.size() < out.size) {
+      out.tokens.resize(out.size);
+    }
+    size_t count;
+    // the worker cannot touch the stats, the reader adds the time
+    const stage_timer timer;
+    const bool indexed = _find_structural_bits(
+        reinterpret_cast<const uint8_t*>(json.data() + start), out.size,
+        out.tokens.data(), count);
+    if (_stats != nullptr) {
+      timer.stop(out.first_pass);
+    }
+    if (!indexed) {
+      // the batches before this one were valid, the offset is absolute
+      out.error = first_pass_error(json.substr(0, start + out.size));
+      out.next_start = json.size();
+      return;
+    }
+    const char* buf = json.data() + start;
+    size_t complete = 0;
+    size_t depth = 0;
+    for (size_t i = 0; i < count; i++) {
+      const char c = buf[out.tokens[i]];
+      if (c == '{' || c == '[') {
+        ++depth;
+      } else if ((c == '}' || c == ']') && depth > 0) {
+        --depth;
+      }
+      if (depth == 0) {
+        complete = i + 1;
+      }
+    }
+    if (depth == 0 || end == json.size()) {
+      // an unterminated last document is reported by the second pass
+      out.token_count = count;
+      out.next_start = end;
+      return;
+    }
+    if (complete > 0) {
+      out.token_count = complete;
+      out.next_start = start + out.tokens[complete];
+      return;
+    }
+    window *= 2;
+  }
+}
+
+void JsonStream::run_worker() {
+  size_t start = 0;
+  for (size_t seq = 0; start < _input.size(); seq++) {
+    {
+      std::unique_lock lock(_mutex);
+      _changed.wait(lock, [&] { return _stop || seq < _consumed + 2; });
+      if (_stop) {
+        break;
+      }
+    }
+    // the reader holds at most the other batch
+    batch& out = _batches[seq % 2];
+    index_batch(out, start);
+    start = out.next_start;
+    {
+      std::lock_guard lock(_mutex);
+      _produced = seq + 1;
+    }
+    _changed.notify_all();
+  }
+  {
+    std::lock_guard lock(_mutex);
+    _finished = true;
+  }
+  _changed.notify_all();
+}
+
+bool JsonStream::acquire_batch() {
+  if (!_worker.joinable()) {
+    if (_next_start >= _input.size()) {
+      return false;
+    }
+    _batch = &_batches[0];
+    index_batch(*_batch, _next_start);
+    _next_start = _batch->next_start;
+    return true;
+  }
+  std::unique_lock lock(_mutex);
+  if (_batch != nullptr) {
+    // hand the batch back to the worker
+    ++_consumed;
+    _batch = nullptr;
+    _changed.notify_all();
+  }
+  _changed.wait(lock, [&] { return _produced > _consumed || _finished; });
+  if (_produced == _consumed) {
+    return false;
+  }
+  _batch = &_batches[_consumed % 2];
+  return true;
+}
+
+void JsonStream::next() {
+  while (!_done) {
+    if (!_failed && _batch != nullptr && _index < _batch->token_count) {
+      _document.clear();
+      const std::string_view json =
+          _input.view().substr(_batch->start, _batch->size);
+      if (_stats != nullptr) {
+        _stats->parses++;
+      }
+      _failed = !build_tape(json, _batch->tokens.data(), _batch->token_count,
+                            _index, true, _document, _scopes, _scratch,
+                            _containers, _stats, _max_depth);
+      if (_failed) {
+        // the tokens are relative to the batch, the offset is absolute
+        _document.set_error({_document.get_error_code(),
+                             _batch->start + _document.get_error_offset()});
+      }
+      ++_document_count;
+      return;
+    }
+    if (_failed || !acquire_batch()) {
+      _done = true;
+      return;
+    }
+    _index = 0;
+    if (_stats != nullptr) {
+      _stats->bytes += _batch->size;
+      _stats->first_pass.cycles += _batch->first_pass.cycles;
+      _stats->first_pass.time += _batch->first_pass.time;
+    }
+    if (_batch->error) {
+      _document.clear();
+      _document.set_error(_batch->error);
+      _failed = true;
+      ++_document_count;
+      return;
+    }
+  }
+}
+
+JsonStream x86_implement::parse_many_impl(PaddedStringView json,
+                                          size_t batch_size) {
+  return JsonStream(json, batch_size, _stats, _max_depth);
+}
+
+size_t x86_implement::parse_many_impl(PaddedStringView json,
+                                      std::vector<JsonDocument>& documents) {
+  const std::string_view view = json.view();
+  size_t count = 0;
+  auto next_document = [&]() -> JsonDocument& {
+    if (count == documents.size()) {
+      documents.emplace_back();
+    }
+    JsonDocument& document = documents[count++];
+    document.clear();
+    return document;
+  };
+  if (view.size() > std::numeric_limits<uint32_t>::max()) {
+    next_document().set_error({error_code::TOO_LARGE});
+    return count;
+  }
+  if (_tokens.size() < view.size()) {
+    _tokens.resize(view.size());
+  }
+  const stage_timer timer;
+  const bool indexed = active_kernel().find_structural_bits(
+      reinterpret_cast<const uint8_t*>(view.data()), view.size(),
+      _tokens.data(), _token_count);
+  if (_stats != nullptr) {
+    // counted like the stream, a parse per document
+    _stats->bytes += view.size();
+    timer.stop(_stats->first_pass);
+  }
+  if (!indexed) {
+    next_document().set_error(first_pass_error(view));
+    return count;
+  }
+  size_t index = 0;
+  while (index < _token_count) {
+    if (_stats != nullptr) {
+      _stats->parses++;
+    }
+    if (!build_tape(view, _tokens.data(), _token_count, index, true,
+                    next_document(), _scopes, _string_buffer, _containers,
+                    _stats, _max_depth)) {
+      break;
+    }
+  }
+  return count;
+}
+}  // namespace simdjson
@@ -0,0 +1,255 @@
+//
+// Created by zzy on 12/17/23.
+//
+// The string routines shared by every kernel. Like x86_stage1_generic.h it has
+// no include guard: each kernel includes it inside its own anonymous
+// namespace, after x86_stage1_generic.h and the definition of simd8x64 for
+// its instruction set.
+
+struct string_tables {
+  // the value of a hex digit, -1 for any other byte
+  int8_t hex[256];
+  // what the letter of a short escape decodes to, 0 for any other byte
+  uint8_t escape[256];
+};
+
+constexpr string_tables make_string_tables() {
+  string_tables tables{};
+  for (int c = 0; c < 256; c++) {
+    tables.hex[c] = c >= '0' && c <= '9'   ? c - '0'
+                    : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                    : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                           : -1;
+  }
+  tables.escape['"'] = '"';
+  tables.escape['\\'] = '\\';
+  tables.escape['/'] = '/';
+  tables.escape['b'] = '\b';
+  tables.escape['f'] = '\f';
+  tables.escape['n'] = '\n';
+  tables.escape['r'] = '\r';
+  tables.escape['t'] = '\t';
+  return tables;
+}
+
+// escapes are decoded from tables rather than branches, the kind of escape
+// that comes next is rarely predictable
+constexpr string_tables kStringTables = make_string_tables();
+
+inline bool parse_hex4(const uint8_t* src, size_t len, size_t pos,
+                       uint32_t& code) {
+  if (pos + 4 > len) {
+    return false;
+  }
+  const int8_t* hex = kStringTables.hex;
+  // a byte that is not a digit is -1, which leaves the value negative
+  const int32_t value = hex[src[pos]] << 12 | hex[src[pos + 1]] << 8 |
+                        hex[src[pos + 2]] << 4 | hex[src[pos + 3]];
+  code = static_cast<uint32_t>(value);
+  return value >= 0;
+}
+
+inline uint8_t* append_utf8(uint32_t code, uint8_t* out) {
+  if (code < 0x80) {
+    *out++ = static_cast<uint8_t>(code);
+  } else if (code < 0x800) {
+    *out++ = static_cast<uint8_t>(0xC0 | (code >> 6));
+    *out++ = static_cast<uint8_t>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    *out++ = static_cast<uint8_t>(0xE0 | (code >> 12));
+    *out++ = static_cast<uint8_t>(0x80 | ((code >> 6) & 0x3F));
+    *out++ = static_cast<uint8_t>(0x80 | (code & 0x3F));
+  } else {
+    *out++ = static_cast<uint8_t>(0xF0 | (code >> 18));
+    *out++ = static_cast<uint8_t>(0x80 | ((code >> 12) & 0x3F));
+    *out++ = static_cast<uint8_t>(0x80 | ((code >> 6) & 0x3F));
+    *out++ = static_cast<uint8_t>(0x80 | (code & 0x3F));
+  }
+  return out;
+}
+
+// decode the escape sequence at src[pos], which is a backslash, and move
+// `pos` past it. The utf-8 encoding of a \u escape is never longer than the
+// escape itself, so `out` stays behind `pos`.
+inline bool decode_escape(const uint8_t* src, size_t len, size_t& pos,
+                          uint8_t*& out) {
+  if (pos + 1 >= len) {
+    return false;
+  }
+  if (src[pos + 1] != 'u') {
+    const uint8_t decoded = kStringTables.escape[src[pos + 1]];
+    *out++ = decoded;
+    pos += 2;
+    return decoded != 0;
+  }
+  uint32_t code;
+  if (!parse_hex4(src, len, pos + 2, code)) {
+    return false;
+  }
+  pos += 6;
+  if (code >= 0xD800 && code < 0xDC00) {
+    // a high surrogate must be followed by an escaped low surrogate
+    uint32_t low;
+    if (pos + 1 >= len || src[pos] != '\\' || src[pos + 1] != 'u' ||
+        !parse_hex4(src, len, pos + 2, low) || low < 0xDC00 ||
+        low >= 0xE000) {
+      return false;
+    }
+    pos += 6;
+    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+  } else if (code >= 0xDC00 && code < 0xE000) {
+    return false;
+  }
+  out = append_utf8(code, out);
+  return true;
+}
+
+// Scan 64 bytes at a time for the quote, the backslash and the control
+// characters. A block is stored to `dst` as it is loaded and its stop mask
+// is kept: after an escape, the bits it consumed are cleared and the run up
+// to the next stop is copied from a copy of the block in 32-byte steps, a
+// new block is only loaded once `pos` leaves this one. So `dst` may be
+// written up to `len` bytes ahead even when the string is shorter. The last
+// partial block is scanned from a copy padded with quotes, nothing is read
+// past `len`.
+bool parse_string(const uint8_t* src, size_t len, uint8_t* dst,
+                  size_t& consumed, size_t& written) {
+  constexpr size_t kStep = 32;
+  size_t pos = 0;
+  uint8_t* out = dst;
+  // the block being walked, with room for the last step of a run
+  uint8_t block[kBlockSize + kStep] = {};
+  while (true) {
+    const size_t base = pos;
+    uint64_t stop;
+    if (len - base >= kBlockSize) {
+      const simd8x64 in(src + base);
+      stop = in.eq('"') | in.eq('\\') | in.lteq(0x1F);
+      in.store(out);
+      if (stop == 0) {
+        pos += kBlockSize;
+        out += kBlockSize;
+        continue;
+      }
+      in.store(block);
+    } else {
+      std::memset(block, '"', kBlockSize);
+      std::memcpy(block, src + base, len - base);
+      const simd8x64 in(block);
+      stop = in.eq('"') | in.eq('\\') | in.lteq(0x1F);
+      std::memcpy(out, block, __builtin_ctzll(stop));
+    }
+    // the run before the first stop was stored with the block
+    size_t offset = __builtin_ctzll(stop);
+    pos += offset;
+    out += offset;
+    while (true) {
+      if (pos == len || src[pos] == '"') {
+        consumed = pos;
+        written = out - dst;
+        return true;
+      }
+      // a control character has to be escaped
+      if (src[pos] != '\\' || !decode_escape(src, len, pos, out)) {
+        return false;
+      }
+      offset = pos - base;
+      if (offset >= kBlockSize) {
+        break;
+      }
+      // a padded block always has a stop left, a full one without any is
+      // loaded again from `pos`
+      stop &= ~uint64_t{0} << offset;
+      if (stop == 0) {
+        break;
+      }
+      const size_t run = __builtin_ctzll(stop) - offset;
+      if (pos + run + kStep <= len) {
+        // the bytes copied past the run are overwritten by what follows
+        size_t step = 0;
+        do {
+          std::memcpy(out + step, block + offset + step, kStep);
+          step += kStep;
+        } while (step < run);
+      } else {
+        std::memcpy(out, block + offset, run);
+      }
+      pos += run;
+      out += run;
+    }
+  }
+}
+
+// the escape of a byte a json string cannot hold as it is: the quote, the
+// backslash and the control characters
+inline uint8_t* encode_escape(uint8_t c, uint8_t* out) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  *out++ = '\\';
+  switch (c) {
+    case '"':
+      *out++ = '"';
+      break;
+    case '\\':
+      *out++ = '\\';
+      break;
+    case '\b':
+      *out++ = 'b';
+      break;
+    case '\f':
+      *out++ = 'f';
+      break;
+    case '\n':
+      *out++ = 'n';
+      break;
+    case '\r':
+      *out++ = 'r';
+      break;
+    case '\t':
+      *out++ = 't';
+      break;
+    default:
+      *out++ = 'u';
+      *out++ = '0';
+      *out++ = '0';
+      *out++ = kHex[c >> 4];
+      *out++ = kHex[c & 0xF];
+  }
+  return out;
+}
+
+// The reverse of parse_string with the same scan: runs without a byte to
+// escape are copied with full vector stores. An escape is at most six bytes
+// and a store never reaches past six times the bytes consumed plus the ones
+// left, so 6 * `len` bytes of `dst` are enough.
+size_t escape_string(const uint8_t* src, size_t len, uint8_t* dst) {
+  size_t pos = 0;
+  uint8_t* out = dst;
+  while (pos < len) {
+    uint64_t stop;
+    if (len - pos >= kBlockSize) {
+      const simd8x64 in(src + pos);
+      stop = in.eq('"') | in.eq('\\') | in.lteq(0x1F);
+      in.store(out);
+      if (stop == 0) {
+        pos += kBlockSize;
+        out += kBlockSize;
+        continue;
+      }
+    } else {
+      uint8_t tail[kBlockSize];
+      std::memset(tail, '"', kBlockSize);
+      std::memcpy(tail, src + pos, len - pos);
+      const simd8x64 in(tail);
+      stop = in.eq('"') | in.eq('\\') | in.lteq(0x1F);
+      std::memcpy(out, tail, __builtin_ctzll(stop));
+    }
+    const size_t run = __builtin_ctzll(stop);
+    pos += run;
+    out += run;
+    if (pos == len) {
+      break;
+    }
+    out = encode_escape(src[pos++], out);
+  }
+  return out - dst;
+}
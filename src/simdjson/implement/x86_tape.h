@@ -0,0 +1,28 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_TAPE_H
+#define X86_TAPE_H
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "../document.h"
+#include "../stats.h"
+
+namespace simdjson {
+// build the tape of the document that starts at tokens[index] into the
+// cleared `document`, `index` is advanced past it. With `borrow_strings`,
+// the strings without escapes point into `json`. On failure the error is
+// set on the document. `scopes`, `scratch`, where the strings are decoded,
+// and `containers`, the tape index of every open container, are owned by the
+// caller to keep their capacity. The second pass is counted into `stats` if
+// set.
+bool build_tape(std::string_view json, const uint32_t* tokens, size_t count,
+                size_t& index, bool borrow_strings, JsonDocument& document,
+                std::vector<bool>& scopes, std::vector<char>& scratch,
+                std::vector<size_t>& containers, ParseStats* stats = nullptr,
+                size_t max_depth = kDefaultMaxDepth);
+}  // namespace simdjson
+
+#endif  // X86_TAPE_H
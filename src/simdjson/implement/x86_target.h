@@ -0,0 +1,25 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_TARGET_H
+#define X86_TARGET_H
+
+// every function defined between SIMDJSON_TARGET_REGION and
+// SIMDJSON_UNTARGET_REGION is compiled for the given instruction set, so the
+// kernels can use it without passing -m flags to the whole build
+#define SIMDJSON_STRINGIFY_IMPL(x) #x
+#define SIMDJSON_STRINGIFY(x) SIMDJSON_STRINGIFY_IMPL(x)
+
+#if defined(__clang__)
+#define SIMDJSON_TARGET_REGION(T)                                       \
+  _Pragma(SIMDJSON_STRINGIFY(clang attribute push(                      \
+      __attribute__((target(T))), apply_to = function)))
+#define SIMDJSON_UNTARGET_REGION _Pragma("clang attribute pop")
+#else
+#define SIMDJSON_TARGET_REGION(T) \
+  _Pragma("GCC push_options") _Pragma(SIMDJSON_STRINGIFY(GCC target(T)))
+#define SIMDJSON_UNTARGET_REGION _Pragma("GCC pop_options")
+#endif
+
+#endif  // X86_TARGET_H
@@ -0,0 +1,91 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef X86_UTF8_H
+#define X86_UTF8_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace simdjson {
+// Byte at a time utf-8 automaton for the fallback kernel and for locating
+// an error. The lead byte narrows the range of the next continuation byte,
+// which rules out overlong encodings, surrogates and code points above
+// U+10FFFF.
+struct utf8_scalar_state {
+  // continuation bytes still expected, and the range of the next one
+  uint8_t remaining = 0;
+  uint8_t lo = 0x80;
+  uint8_t hi = 0xBF;
+
+  // false if `byte` cannot come next
+  bool next(uint8_t byte) {
+    if (remaining != 0) {
+      if (byte < lo || byte > hi) {
+        return false;
+      }
+      lo = 0x80;
+      hi = 0xBF;
+      --remaining;
+      return true;
+    }
+    if (byte < 0x80) {
+      return true;
+    }
+    if (byte >= 0xC2 && byte <= 0xDF) {
+      remaining = 1;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+      remaining = 2;
+      lo = byte == 0xE0 ? 0xA0 : 0x80;
+      hi = byte == 0xED ? 0x9F : 0xBF;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+      remaining = 3;
+      lo = byte == 0xF0 ? 0x90 : 0x80;
+      hi = byte == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // run over `len` bytes, skipping eight ascii bytes at a time between
+  // sequences
+  bool next(const uint8_t* buf, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+      if (remaining == 0 && i + 8 <= len) {
+        uint64_t word;
+        std::memcpy(&word, buf + i, sizeof(word));
+        if ((word & 0x8080808080808080) == 0) {
+          i += 8;
+          continue;
+        }
+      }
+      if (!next(buf[i++])) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// offset of the first byte of the first invalid sequence, `len` if the
+// whole buffer is valid
+inline size_t find_utf8_error(const uint8_t* buf, size_t len) {
+  utf8_scalar_state state;
+  size_t start = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (state.remaining == 0) {
+      start = i;
+    }
+    if (!state.next(buf[i])) {
+      // an invalid lead byte, or the sequence at `start` was cut short
+      return state.remaining == 0 ? i : start;
+    }
+  }
+  return state.remaining == 0 ? len : start;
+}
+}  // namespace simdjson
+
+#endif  // X86_UTF8_H
@@ -0,0 +1,134 @@
+//
+// Created by zzy on 12/17/23.
+//
+// The utf-8 check of the vectorized kernels. Like x86_stage1_generic.h it
+// has no include guard: each kernel includes it inside its own anonymous
+// namespace, after defining for its instruction set
+//   simd8     one register of bytes with splat, load, table, shr4, lookup,
+//             prev<N>, saturating_sub, the bitwise operators and any
+//   simd8x64  with kRegisters, reg(i) and is_ascii
+//
+// Every byte is classified by three table lookups, on the high and low
+// nibbles of the byte before it and on its own high nibble. The and of the
+// three has a bit set for each error the pair shows. A separate check makes
+// sure the third and fourth bytes of a sequence are continuation bytes.
+
+namespace utf8_errors {
+// 11______ 0_______ or 11______ 11______
+constexpr uint8_t TOO_SHORT = 1 << 0;
+// 0_______ 10______
+constexpr uint8_t TOO_LONG = 1 << 1;
+// 11100000 100_____
+constexpr uint8_t OVERLONG_3 = 1 << 2;
+// 11110100 1001____, 11110100 101_____ or 11110101 and above
+constexpr uint8_t TOO_LARGE = 1 << 3;
+// 11101101 101_____
+constexpr uint8_t SURROGATE = 1 << 4;
+// 1100000_ 10______
+constexpr uint8_t OVERLONG_2 = 1 << 5;
+// 11110101 1000____ and above
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+// 11110000 1000____
+constexpr uint8_t OVERLONG_4 = 1 << 6;
+// 10______ 10______, allowed if the lead byte expects it
+constexpr uint8_t TWO_CONTS = 1 << 7;
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+// indexed by the high nibble of the first byte of the pair
+constexpr uint8_t kByte1High[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+// indexed by the low nibble of the first byte of the pair
+constexpr uint8_t kByte1Low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000};
+// indexed by the high nibble of the second byte of the pair
+constexpr uint8_t kByte2High[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+        OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+}  // namespace utf8_errors
+
+// the largest byte allowed at each of the last positions of a block that
+// does not end inside a sequence, the register loads its tail
+constexpr uint8_t kIncompleteMax[64] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+
+struct utf8_checker {
+  // spelled out rather than default member initializers: the implicit
+  // constructor is not compiled for the instruction set of the kernel, and
+  // without inlining the registers would cross an abi boundary
+  utf8_checker()
+      : error(simd8::splat(0)),
+        prev_input(simd8::splat(0)),
+        prev_incomplete(simd8::splat(0)) {}
+
+  simd8 error;
+  simd8 prev_input;
+  // non-zero if the last block ended inside a sequence
+  simd8 prev_incomplete;
+
+  void check_block(const uint8_t*, const simd8x64& in) {
+    // an ascii block only has to close the sequence of the previous one
+    if (in.is_ascii()) {
+      error = error | prev_incomplete;
+      prev_input = simd8::splat(0);
+      prev_incomplete = simd8::splat(0);
+      return;
+    }
+    for (size_t i = 0; i < simd8x64::kRegisters; i++) {
+      check_register(in.reg(i));
+    }
+    prev_incomplete = prev_input.saturating_sub(
+        simd8::load(kIncompleteMax + 64 - simd8::kSize));
+  }
+
+  void check_eof() { error = error | prev_incomplete; }
+  bool has_error() const { return error.any(); }
+
+ private:
+  void check_register(simd8 input) {
+    using namespace utf8_errors;
+    const simd8 prev1 = input.prev<1>(prev_input);
+    const simd8 special_cases =
+        prev1.shr4().lookup(simd8::table(kByte1High)) &
+        (prev1 & simd8::splat(0x0F)).lookup(simd8::table(kByte1Low)) &
+        input.shr4().lookup(simd8::table(kByte2High));
+    // the third and fourth bytes of a sequence must be continuations, which
+    // the pair lookups flag as TWO_CONTS
+    const simd8 prev2 = input.prev<2>(prev_input);
+    const simd8 prev3 = input.prev<3>(prev_input);
+    const simd8 must_be_continuation =
+        (prev2.saturating_sub(simd8::splat(0xE0 - 0x80)) |
+         prev3.saturating_sub(simd8::splat(0xF0 - 0x80))) &
+        simd8::splat(0x80);
+    error = error | (must_be_continuation ^ special_cases);
+    prev_input = input;
+  }
+};
@@ -5,7 +5,15 @@
 #ifndef INTERNAL_H
 #define INTERNAL_H
 
+#include "bind.h"
+#include "columnar.h"
+#include "document.h"
+#include "node.h"
+#include "ondemand.h"
+#include "padded_string.h"
 #include "result.h"
+#include "stats.h"
+#include "stream.h"
 #if defined(_M_X64) || defined(__x86_64__) || defined(__amd64__)
 #define IS_X86_ARCH 1
 #else
@@ -16,20 +24,125 @@
 #include <expected>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace simdjson {
 
 template <typename T>
 class JsonParserBase {
  public:
-  Json parse(const std::string& json) {
+  Json parse(std::string_view json) {
     return static_cast<T*>(this)->parse_impl(json);
   }
+  // parse with the failure as a value: an error code and the byte offset
+  // it was found at, no message is built and nothing is allocated for it
+  std::expected<Json, JsonError> try_parse(std::string_view json) {
+    Json result = static_cast<T*>(this)->parse_impl(json);
+    if (result.is_error()) {
+      return std::unexpected(
+          JsonError{result.get_error_code(), result.get_error_offset()});
+    }
+    return result;
+  }
+  // load the file at `path` with PaddedString::load and parse it in place,
+  // an error if it cannot be read
+  Json parse_file(const std::string& path) {
+    return static_cast<T*>(this)->parse_file_impl(path);
+  }
+  // arena mode: every node of the tree comes from an arena owned by the
+  // parser, which is rewound by the next call, so steady-state parsing does
+  // not allocate. The tree is owned by the parser and only valid until the
+  // next parse_in_arena call.
+  Json& parse_in_arena(std::string_view json) {
+    return static_cast<T*>(this)->parse_in_arena_impl(json);
+  }
+  // compact mode: the tree as JsonNode values of 16 bytes, see node.h,
+  // with objects in the order of the input. On failure `error` is set and
+  // a null node is returned.
+  JsonNode parse_node(std::string_view json, JsonParseError& error) {
+    JsonError failure;
+    JsonNode node = static_cast<T*>(this)->parse_node_impl(json, failure);
+    error = failure ? failure.message() : JsonParseError();
+    return node;
+  }
+  std::expected<JsonNode, JsonError> try_parse_node(std::string_view json) {
+    JsonError failure;
+    JsonNode node = static_cast<T*>(this)->parse_node_impl(json, failure);
+    if (failure) {
+      return std::unexpected(failure);
+    }
+    return node;
+  }
+  // schema mode: decode `json` straight into a U described by JsonFields,
+  // see bind.h, on top of iterate, so no tree is built and members without
+  // a field are skipped unread. On failure `error` is set and the members
+  // bound so far are kept.
+  template <typename U>
+  U parse_into(PaddedStringView json, JsonParseError& error) {
+    U value{};
+    bind_document(static_cast<T*>(this)->iterate_impl(json), value, error);
+    return value;
+  }
+  // read-only mode: the whole parse in one flat tape, valid until the next
+  // call to parse_document on the same parser
+  const JsonDocument& parse_document(std::string_view json) {
+    return static_cast<T*>(this)->parse_document_impl(json);
+  }
+  // zero-copy read-only mode: the strings without escapes are views into
+  // `json`, which must outlive the document, only the escaped ones are
+  // decoded into the string buffer of the document
+  const JsonDocument& parse_document(PaddedStringView json) {
+    return static_cast<T*>(this)->parse_document_impl(json);
+  }
+  // on-demand mode: only the structural index is built, values are decoded
+  // when they are accessed and unread containers are skipped. The cursor
+  // borrows from `json` and is valid until the next call to iterate.
+  OnDemandDocument& iterate(PaddedStringView json) {
+    return static_cast<T*>(this)->iterate_impl(json);
+  }
+  // multi-document mode: one document per line of NDJSON, or per
+  // whitespace-separated document, see stream.h. `json` must outlive the
+  // stream.
+  JsonStream parse_many(PaddedStringView json,
+                        size_t batch_size = kDefaultBatchSize) {
+    return static_cast<T*>(this)->parse_many_impl(json, batch_size);
+  }
+  // eager multi-document mode: every document of `json` is built into
+  // documents[0, n), reusing the buffers of the documents already there.
+  // Returns n, the last document is the one that failed, if any.
+  size_t parse_many(PaddedStringView json,
+                    std::vector<JsonDocument>& documents) {
+    return static_cast<T*>(this)->parse_many_impl(json, documents);
+  }
+  // columnar mode: every record of `json`, one per line, is appended as a
+  // row of `columns`, see columnar.h. No tree is built, the values of the
+  // columns are decoded straight into their buffers and the rest of each
+  // record is skipped. Returns the rows appended, on failure the error is
+  // held by `columns`.
+  size_t parse_columns(PaddedStringView json, JsonColumns& columns) {
+    return static_cast<T*>(this)->parse_columns_impl(json, columns);
+  }
+
+  // statistics mode: while `stats` is attached, parse, parse_in_arena,
+  // parse_node, parse_document and both parse_many add what they cost to
+  // it, see stats.h.
+  // The counting is a policy the builders are compiled with, a parser
+  // without stats runs the builders without it. nullptr detaches.
+  void set_stats(ParseStats* stats) {
+    static_cast<T*>(this)->set_stats_impl(stats);
+  }
+  // containers nested deeper than `max_depth` make parse, parse_in_arena,
+  // parse_node, parse_document and both parse_many fail with an error,
+  // so a hostile document cannot exhaust the stack of whoever destroys or
+  // walks the tree. kDefaultMaxDepth until set.
+  void set_max_depth(size_t max_depth) {
+    static_cast<T*>(this)->set_max_depth_impl(max_depth);
+  }
 
   virtual ~JsonParserBase() = default;
 
  private:
-  void parse_impl(const std::string& json) {
+  void parse_impl(std::string_view json) {
     throw std::logic_error("unimplement");
   }
 };
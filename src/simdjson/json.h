@@ -5,13 +5,27 @@
 #ifndef JSON_H
 #define JSON_H
 
+#include "arena.h"
+#include "bind.h"
+#include "columnar.h"
+#include "document.h"
 #include "implement/x86_implement.h"
 #include "internal.h"
+#include "minify.h"
+#include "node.h"
+#include "ondemand.h"
+#include "padded_string.h"
+#include "parallel.h"
+#include "push.h"
+#include "query.h"
 #include "result.h"
+#include "stats.h"
+#include "stream.h"
+#include "utf8.h"
 
 namespace simdjson {
 
-using JsonParser = JsonParserBase<x86_implement>;
+using JsonParser = x86_implement;
 using simdjson::Json;
 
 }  // namespace simdjson
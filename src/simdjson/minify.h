@@ -0,0 +1,21 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef MINIFY_H
+#define MINIFY_H
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace simdjson {
+// Remove the whitespace outside of strings without parsing, with the active
+// kernel. Strings are tracked through their escapes like in the first pass
+// of the parser, but the input is not validated: invalid json gives invalid
+// output. `output` needs room for input.size() bytes, may be `input` itself,
+// and the minified size is returned.
+size_t minify(std::string_view input, char* output);
+std::string minify(std::string_view input);
+}  // namespace simdjson
+
+#endif  // MINIFY_H
@@ -0,0 +1,316 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef NODE_H
+#define NODE_H
+
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace simdjson {
+
+enum class JsonNodeType : uint8_t {
+  NULL_VALUE,
+  BOOL,
+  INT64,
+  UINT64,
+  DOUBLE,
+  STRING,
+  ARRAY,
+  OBJECT,
+};
+
+class JsonMember;
+
+// The keys of an object in order, shared by every object parsed with the
+// same keys in the same order, like the hidden classes of javascript
+// engines. The parser keeps a table of shapes linked by the key that leads
+// from one to the next, so the first object of a schema creates them and
+// the following ones only compare each key with the predicted one. A shape
+// never changes once created, objects hold a reference and borrow their
+// keys from it. Resolving a key once with find() gives its position in
+// every object of the same shape.
+class JsonShape {
+ public:
+  JsonShape(const JsonShape&) = delete;
+  JsonShape& operator=(const JsonShape&) = delete;
+
+  size_t size() const { return _keys.size(); }
+  std::string_view key(size_t index) const { return _keys[index]; }
+  // the position of `key`, size() if the shape does not have it
+  size_t find(std::string_view key) const;
+
+ private:
+  friend class JsonNode;
+  friend class shape_table;
+
+  JsonShape() = default;
+  ~JsonShape();
+  void retain() { _refs.fetch_add(1, std::memory_order_relaxed); }
+  void release() {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+  void build_index();
+
+  std::atomic<uint32_t> _refs{1};
+  // never resized once the shape is built, views into them stay valid
+  std::vector<std::string> _keys;
+  // position + 1 per bucket, empty while the shape is scanned linearly
+  std::vector<uint32_t> _index;
+  // the shapes one key longer, each holds a reference, only used by the
+  // parser that owns the table
+  std::vector<JsonShape*> _next;
+  size_t _predicted = 0;
+};
+
+// A mutable json value in 16 bytes: the type and a 32-bit size next to an
+// 8-byte payload. Scalars and strings of up to 8 bytes are stored in the
+// payload, longer strings and containers in one heap block owned by the
+// node. An object keeps its members in insertion order in one contiguous
+// block. Small objects are searched by scanning their keys, a hash index is
+// added once an object has room for more than kIndexThreshold members. Nodes
+// hold no pointer into themselves, so moving one only copies its 16 bytes
+// and resets the source, which is how containers relocate them.
+class JsonNode {
+ public:
+  static constexpr uint32_t kIndexThreshold = 16;
+
+  JsonNode() noexcept
+      : _type(JsonNodeType::NULL_VALUE), _flags(0), _size(0) {
+    _payload.u = 0;
+  }
+  JsonNode(std::nullptr_t) noexcept : JsonNode() {}
+  JsonNode(bool value) noexcept
+      : _type(JsonNodeType::BOOL), _flags(0), _size(0) {
+    _payload.u = 0;
+    _payload.b = value;
+  }
+  // like the parser, unsigned values only become UINT64 above INT64_MAX
+  template <std::integral T>
+    requires(!std::same_as<T, bool>)
+  JsonNode(T value) noexcept : _flags(0), _size(0) {
+    if (std::is_signed_v<T> ||
+        static_cast<uint64_t>(value) <=
+            static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+      _type = JsonNodeType::INT64;
+      _payload.i = static_cast<int64_t>(value);
+    } else {
+      _type = JsonNodeType::UINT64;
+      _payload.u = static_cast<uint64_t>(value);
+    }
+  }
+  JsonNode(double value) noexcept
+      : _type(JsonNodeType::DOUBLE), _flags(0), _size(0) {
+    _payload.d = value;
+  }
+  JsonNode(std::string_view value);
+  JsonNode(const char* value) : JsonNode(std::string_view(value)) {}
+  JsonNode(const std::string& value) : JsonNode(std::string_view(value)) {}
+  // empty containers with room for `capacity` elements / members
+  static JsonNode array(size_t capacity = 0);
+  static JsonNode object(size_t capacity = 0);
+
+  JsonNode(const JsonNode& other);
+  JsonNode(JsonNode&& other) noexcept
+      : _type(other._type),
+        _flags(other._flags),
+        _size(other._size),
+        _payload(other._payload) {
+    other.reset_to_null();
+  }
+  JsonNode& operator=(const JsonNode& other);
+  JsonNode& operator=(JsonNode&& other) noexcept;
+  ~JsonNode() { release(); }
+
+  JsonNodeType type() const { return _type; }
+  bool is_null() const { return _type == JsonNodeType::NULL_VALUE; }
+  bool is_bool() const { return _type == JsonNodeType::BOOL; }
+  bool is_int64() const { return _type == JsonNodeType::INT64; }
+  bool is_uint64() const { return _type == JsonNodeType::UINT64; }
+  bool is_double() const { return _type == JsonNodeType::DOUBLE; }
+  bool is_string() const { return _type == JsonNodeType::STRING; }
+  bool is_array() const { return _type == JsonNodeType::ARRAY; }
+  bool is_object() const { return _type == JsonNodeType::OBJECT; }
+  // the length of a string, the number of elements or members
+  size_t size() const { return _size; }
+
+  // T is one of std::string_view, int64_t, uint64_t, double or bool, and
+  // must be the type of the node
+  template <typename T>
+  T get_value() const;
+
+  // arrays
+  std::span<JsonNode> elements() {
+    assert(is_array());
+    return {_size == 0 ? nullptr : _payload.array->elements(), _size};
+  }
+  std::span<const JsonNode> elements() const {
+    assert(is_array());
+    return {_size == 0 ? nullptr : _payload.array->elements(), _size};
+  }
+  JsonNode& operator[](size_t index) {
+    assert(index < _size);
+    return elements()[index];
+  }
+  const JsonNode& operator[](size_t index) const {
+    assert(index < _size);
+    return elements()[index];
+  }
+  void append(JsonNode value);
+  // return false if index is out of range
+  bool remove(size_t index);
+
+  // objects, in insertion order
+  std::span<JsonMember> members();
+  std::span<const JsonMember> members() const;
+  // nullptr if the key is missing
+  JsonNode* find(std::string_view key);
+  const JsonNode* find(std::string_view key) const;
+  // the value of `key`, a null value is inserted if it is missing
+  JsonNode& operator[](std::string_view key);
+  JsonNode& insert_or_assign(std::string_view key, JsonNode value);
+  // return false if key not found, the order of the others is kept
+  bool remove(std::string_view key);
+  // the shape of an object built by the parser, while it still has exactly
+  // the keys of the shape in order, nullptr otherwise
+  const JsonShape* shape() const;
+
+  // serialize like Json::dump, members in insertion order
+  std::string dump(int indent = -1) const;
+  void dump_to(std::string& out, int indent = -1) const;
+  size_t dump_to(std::span<char> out, int indent = -1) const;
+
+ private:
+  friend class node_builder;
+
+  static constexpr uint32_t kInlineString = 8;
+  static constexpr uint32_t kNotFound = std::numeric_limits<uint32_t>::max();
+  // a key longer than kInlineString whose bytes belong to the shape of the
+  // object holding it
+  static constexpr uint8_t kBorrowedKey = 1;
+
+  struct array_block {
+    size_t capacity;
+    JsonNode* elements() { return reinterpret_cast<JsonNode*>(this + 1); }
+  };
+  struct object_block {
+    uint32_t capacity;
+    // a power of two, 0 while the object is scanned linearly
+    uint32_t buckets;
+    // member index + 1 per bucket, 0 for an empty bucket
+    uint32_t* index;
+    // holds the borrowed keys, nullptr if the parser built no shape
+    JsonShape* shape;
+    // the first shape->size() members still have the keys of the shape,
+    // lookups without an index of their own go through the shape
+    bool by_shape;
+    JsonMember* members() { return reinterpret_cast<JsonMember*>(this + 1); }
+  };
+
+  const char* string_data() const {
+    return _size <= kInlineString ? _payload.chars : _payload.str;
+  }
+  // the fields of `other`, over a node that owns nothing
+  void take_bits(const JsonNode& other) {
+    _type = other._type;
+    _flags = other._flags;
+    _size = other._size;
+    _payload = other._payload;
+  }
+  void reset_to_null() {
+    _type = JsonNodeType::NULL_VALUE;
+    _flags = 0;
+    _size = 0;
+    _payload.u = 0;
+  }
+  // a key node for `key`, which the shape of the object keeps alive
+  static JsonNode borrowed_key(std::string_view key);
+  // an object with the keys of `shape` and `values`, which are moved from,
+  // and room for `extra` more members
+  static JsonNode object_from_shape(JsonShape* shape, JsonNode* values,
+                                    size_t extra);
+  void release() noexcept;
+  void copy_from(const JsonNode& other);
+  void reserve_members(uint32_t capacity);
+  void rebuild_index();
+  uint32_t find_member(std::string_view key) const;
+  // insert_or_assign with a key node that is already a string
+  void emplace_member(JsonNode&& key, JsonNode&& value);
+
+  JsonNodeType _type;
+  uint8_t _flags;
+  uint32_t _size;
+  union {
+    bool b;
+    int64_t i;
+    uint64_t u;
+    double d;
+    char chars[kInlineString];
+    char* str;
+    array_block* array;
+    object_block* object;
+  } _payload;
+};
+
+class JsonMember {
+ public:
+  std::string_view key() const { return _key.get_value<std::string_view>(); }
+  JsonNode& value() { return _value; }
+  const JsonNode& value() const { return _value; }
+
+ private:
+  friend class JsonNode;
+  JsonMember(JsonNode&& key, JsonNode&& value)
+      : _key(std::move(key)), _value(std::move(value)) {}
+
+  JsonNode _key;
+  JsonNode _value;
+};
+
+static_assert(sizeof(JsonNode) == 16);
+
+template <typename T>
+T JsonNode::get_value() const {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    assert(is_string());
+    return std::string_view(string_data(), _size);
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    assert(is_int64());
+    return _payload.i;
+  } else if constexpr (std::is_same_v<T, uint64_t>) {
+    assert(is_uint64());
+    return _payload.u;
+  } else if constexpr (std::is_same_v<T, double>) {
+    assert(is_double());
+    return _payload.d;
+  } else {
+    static_assert(std::is_same_v<T, bool>, "unsupported type");
+    assert(is_bool());
+    return _payload.b;
+  }
+}
+
+inline std::span<JsonMember> JsonNode::members() {
+  assert(is_object());
+  return {_size == 0 ? nullptr : _payload.object->members(), _size};
+}
+
+inline std::span<const JsonMember> JsonNode::members() const {
+  assert(is_object());
+  return {_size == 0 ? nullptr : _payload.object->members(), _size};
+}
+}  // namespace simdjson
+
+#endif  // NODE_H
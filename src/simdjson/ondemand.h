@@ -0,0 +1,274 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef ONDEMAND_H
+#define ONDEMAND_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include "arena.h"
+#include "implement/x86_number.h"
+#include "result.h"
+
+namespace simdjson {
+
+class OnDemandDocument;
+class OnDemandObject;
+class OnDemandArray;
+
+// A lazy value: a position in the structural index of an OnDemandDocument.
+// Nothing is decoded until one of the accessors is called, and containers
+// that are never opened are skipped by jumping to their closing bracket.
+// Only the parts that are read are checked against the grammar, a malformed
+// construct met while reading is reported through the document. Values are
+// only valid as long as the document.
+class OnDemandValue {
+ public:
+  OnDemandValue() = default;
+  OnDemandValue(OnDemandDocument* doc, size_t token)
+      : _doc(doc), _token(token) {}
+
+  // false for the result of a lookup that found nothing
+  bool exists() const { return _doc != nullptr; }
+  bool is_string() const { return first_char() == '"'; }
+  bool is_number() const {
+    const char c = first_char();
+    return c == '-' || (c >= '0' && c <= '9');
+  }
+  bool is_bool() const { return first_char() == 't' || first_char() == 'f'; }
+  bool is_object() const { return first_char() == '{'; }
+  bool is_array() const { return first_char() == '['; }
+  bool is_null() const { return first_char() == 'n'; }
+
+  // decode the value, T is one of std::string_view, int64_t, uint64_t,
+  // double, json_number, bool, OnDemandObject or OnDemandArray, std::nullopt
+  // if the value has another type or is malformed. Any integer reads as a
+  // double, and a non-negative one as a uint64_t. A json_number is the
+  // number as parsed, for a caller that converts it by its type.
+  template <typename T>
+  std::optional<T> get_value() const;
+
+  // lookup in an object (any field order) / array, a value that does not
+  // exist() if the key or index is missing
+  OnDemandValue operator[](std::string_view key) const;
+  OnDemandValue operator[](size_t index) const;
+
+  // where a malformed value records its error, nullptr unless exists()
+  OnDemandDocument* document() const { return _doc; }
+
+ private:
+  char first_char() const;
+  std::optional<std::string_view> get_string() const;
+  std::optional<json_number> get_number() const;
+  std::optional<int64_t> get_int64() const;
+  std::optional<uint64_t> get_uint64() const;
+  std::optional<double> get_double() const;
+  std::optional<bool> get_bool() const;
+
+  OnDemandDocument* _doc = nullptr;
+  size_t _token = 0;
+};
+
+struct OnDemandField {
+  std::string_view key;
+  OnDemandValue value;
+};
+
+class OnDemandObject {
+ public:
+  class iterator {
+   public:
+    iterator(OnDemandDocument* doc, size_t token, size_t close)
+        : _doc(doc), _token(token), _close(close) {}
+    OnDemandField operator*() const;
+    iterator& operator++();
+    bool operator==(const iterator& other) const {
+      return _token == other._token;
+    }
+
+   private:
+    OnDemandDocument* _doc;
+    size_t _token;
+    size_t _close;
+  };
+
+  OnDemandObject(OnDemandDocument* doc, size_t token);
+  iterator begin() const { return {_doc, _first, _close}; }
+  iterator end() const { return {_doc, _close, _close}; }
+
+  // forward-only lookup: scans from the field after the last one found, so
+  // reading fields in document order visits every field once
+  OnDemandValue find_field(std::string_view key);
+  // lookup in any order, wraps around to the first field once
+  OnDemandValue find_field_unordered(std::string_view key);
+  OnDemandValue operator[](std::string_view key) {
+    return find_field_unordered(key);
+  }
+
+ private:
+  // scan the fields in [from, to) for `key`, the cursor is left after the
+  // field found, or at `to`
+  OnDemandValue scan(size_t from, size_t to, std::string_view key);
+
+  OnDemandDocument* _doc;
+  size_t _first;
+  size_t _close;
+  size_t _cursor;
+};
+
+class OnDemandArray {
+ public:
+  class iterator {
+   public:
+    iterator(OnDemandDocument* doc, size_t token, size_t close)
+        : _doc(doc), _token(token), _close(close) {}
+    OnDemandValue operator*() const { return {_doc, _token}; }
+    iterator& operator++();
+    bool operator==(const iterator& other) const {
+      return _token == other._token;
+    }
+
+   private:
+    OnDemandDocument* _doc;
+    size_t _token;
+    size_t _close;
+  };
+
+  OnDemandArray(OnDemandDocument* doc, size_t token);
+  iterator begin() const { return {_doc, _first, _close}; }
+  iterator end() const { return {_doc, _close, _close}; }
+  // skips the elements before `index` without decoding them
+  OnDemandValue at(size_t index) const;
+
+ private:
+  OnDemandDocument* _doc;
+  size_t _first;
+  size_t _close;
+};
+
+class OnDemandDocument {
+ public:
+  OnDemandValue root() {
+    return is_error() ? OnDemandValue() : OnDemandValue(this, 0);
+  }
+
+  // errors of the first pass, and the ones met while reading values. The
+  // first error is kept, its message is only built by get_error.
+  bool is_error() const { return static_cast<bool>(_error); }
+  JsonParseError get_error() const {
+    return is_error() ? _error.message() : JsonParseError();
+  }
+  error_code get_error_code() const { return _error.code; }
+  size_t get_error_offset() const { return _error.offset; }
+
+  // for the parser: `matching` holds, for every opening bracket in `tokens`,
+  // the index of its closing bracket
+  void reset(std::string_view json, const uint32_t* tokens, size_t count,
+             const uint32_t* matching) {
+    _json = json;
+    _tokens = tokens;
+    _count = count;
+    _matching = matching;
+    _error = {};
+    _strings.rewind();
+  }
+  void set_error(const JsonError& error) {
+    if (!_error) {
+      _error = error;
+    }
+  }
+
+ private:
+  friend class OnDemandValue;
+  friend class OnDemandObject;
+  friend class OnDemandArray;
+
+  char at(size_t token) const { return _json[_tokens[token]]; }
+  // the byte of the input where `token` starts, the end past the last one
+  size_t offset(size_t token) const {
+    return token < _count ? _tokens[token] : _json.size();
+  }
+  // the token after the value that starts at `token`
+  size_t skip(size_t token) const {
+    const char c = at(token);
+    return c == '{' || c == '[' ? _matching[token] + 1 : token + 1;
+  }
+  // the first token of the next element of a container closed at `close`,
+  // given `next`, the token after the current element. `close` when the
+  // container ends there or is malformed.
+  size_t next_element(size_t next, size_t close);
+  // the value token of the field whose key is at `key`, `close` if the
+  // field is malformed
+  size_t field_value(size_t key, size_t close);
+  std::optional<std::string_view> string_at(size_t token);
+
+  std::string_view _json;
+  const uint32_t* _tokens = nullptr;
+  size_t _count = 0;
+  const uint32_t* _matching = nullptr;
+  // decoded strings with escapes, stable until the next reset
+  JsonArena _strings{4096};
+  JsonError _error;
+};
+
+inline char OnDemandValue::first_char() const {
+  return exists() ? _doc->at(_token) : '\0';
+}
+
+template <typename T>
+std::optional<T> OnDemandValue::get_value() const {
+  if constexpr (std::is_same_v<T, std::string_view>) {
+    return get_string();
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    return get_int64();
+  } else if constexpr (std::is_same_v<T, uint64_t>) {
+    return get_uint64();
+  } else if constexpr (std::is_same_v<T, double>) {
+    return get_double();
+  } else if constexpr (std::is_same_v<T, json_number>) {
+    return get_number();
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return get_bool();
+  } else if constexpr (std::is_same_v<T, OnDemandObject>) {
+    if (!is_object()) {
+      return std::nullopt;
+    }
+    return OnDemandObject(_doc, _token);
+  } else {
+    static_assert(std::is_same_v<T, OnDemandArray>, "unsupported type");
+    if (!is_array()) {
+      return std::nullopt;
+    }
+    return OnDemandArray(_doc, _token);
+  }
+}
+
+inline OnDemandValue OnDemandValue::operator[](std::string_view key) const {
+  auto object = get_value<OnDemandObject>();
+  return object ? object->find_field_unordered(key) : OnDemandValue();
+}
+
+inline OnDemandValue OnDemandValue::operator[](size_t index) const {
+  auto array = get_value<OnDemandArray>();
+  return array ? array->at(index) : OnDemandValue();
+}
+
+inline OnDemandObject::OnDemandObject(OnDemandDocument* doc, size_t token)
+    : _doc(doc),
+      _first(token + 1),
+      _close(doc->_matching[token]),
+      _cursor(_first) {}
+
+inline OnDemandArray::OnDemandArray(OnDemandDocument* doc, size_t token)
+    : _doc(doc), _first(token + 1), _close(doc->_matching[token]) {}
+
+inline OnDemandArray::iterator& OnDemandArray::iterator::operator++() {
+  _token = _doc->next_element(_doc->skip(_token), _close);
+  return *this;
+}
+}  // namespace simdjson
+
+#endif  // ONDEMAND_H
@@ -0,0 +1,91 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef PADDED_STRING_H
+#define PADDED_STRING_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace simdjson {
+
+// readable bytes required after the end of the json, so the kernels can
+// load a whole register at any position of the input
+constexpr size_t kJsonPadding = 64;
+
+// how PaddedString::load brings a file in memory
+enum class FileLoad {
+  // map the file, its pages are read on first access, nothing is copied
+  MMAP,
+  // one read into a padded heap buffer
+  READ,
+  // one read into an anonymous mapping advised with MADV_HUGEPAGE, fewer
+  // tlb misses on large inputs when transparent huge pages are enabled
+  HUGE_PAGE_READ,
+};
+
+// An owned json buffer followed by kJsonPadding readable bytes: spaces when
+// the buffer is filled by a copy, zeros when a file is mapped.
+class PaddedString {
+ public:
+  PaddedString() = default;
+  explicit PaddedString(std::string_view str) : PaddedString(str.size()) {
+    std::memcpy(_data.get(), str.data(), str.size());
+  }
+  // room for `size` bytes, to be filled through data()
+  explicit PaddedString(size_t size)
+      : _data(new char[size + kJsonPadding]), _size(size) {
+    std::memset(_data.get() + size, ' ', kJsonPadding);
+  }
+
+  // replace the content by the file at `path`, false with errno set if it
+  // cannot be read
+  bool load(const std::string& path, FileLoad mode = FileLoad::MMAP);
+
+  const char* data() const { return _data.get(); }
+  char* data() { return _data.get(); }
+  size_t size() const { return _size; }
+  std::string_view view() const { return {_data.get(), _size}; }
+
+ private:
+  struct release {
+    release() : mapped(0) {}
+    explicit release(size_t mapped) : mapped(mapped) {}
+    void operator()(char* data) const;
+    // length of the mapping, 0 for a heap buffer
+    size_t mapped;
+  };
+
+  std::unique_ptr<char[], release> _data;
+  size_t _size = 0;
+};
+
+// a borrowed json buffer that has at least kJsonPadding readable bytes
+// after its end
+class PaddedStringView {
+ public:
+  PaddedStringView(const char* data, size_t size, size_t capacity)
+      : _data(data), _size(size) {
+    assert(capacity >= size + kJsonPadding);
+    (void)capacity;
+  }
+  PaddedStringView(const PaddedString& str)
+      : _data(str.data()), _size(str.size()) {}
+
+  const char* data() const { return _data; }
+  size_t size() const { return _size; }
+  std::string_view view() const { return {_data, _size}; }
+  operator std::string_view() const { return view(); }
+
+ private:
+  const char* _data;
+  size_t _size;
+};
+}  // namespace simdjson
+
+#endif  // PADDED_STRING_H
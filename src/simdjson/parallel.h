@@ -0,0 +1,118 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "implement/x86_implement.h"
+#include "padded_string.h"
+
+namespace simdjson {
+
+struct ParallelOptions {
+  // worker threads, 0 for one per hardware thread
+  size_t threads = 0;
+  // bytes per chunk, rounded up to the end of a line
+  size_t chunk_size = 1 << 20;
+  // chunks parsed ahead of the reader in ordered mode, 0 for twice the
+  // number of threads. Bounds the memory held by the results.
+  size_t queue_depth = 0;
+};
+
+// the documents parsed from one chunk of the input
+struct JsonChunk {
+  // position of the chunk among the chunks, and in the input
+  size_t index = 0;
+  size_t offset = 0;
+  // only the first `count` documents belong to this chunk, the others keep
+  // their buffers for the next one
+  std::vector<JsonDocument> documents;
+  size_t count = 0;
+
+  auto begin() const { return documents.begin(); }
+  auto end() const { return documents.begin() + count; }
+};
+
+// Unordered mode of JsonParallelReader below: `callback` is called from the
+// worker threads with every chunk as soon as it is parsed, the chunk is only
+// valid during the call. Returns once the whole input is parsed.
+void parse_parallel(PaddedStringView input,
+                    const std::function<void(const JsonChunk&)>& callback,
+                    const ParallelOptions& options = {});
+
+// Parallel NDJSON ingestion: the input is split after a newline into chunks
+// of about chunk_size bytes, so it must hold whole documents per line. The
+// chunks are dealt to the workers round robin, a worker takes the next chunk
+// from the front of its own queue and steals from the back of the others
+// once it is empty. Every worker keeps its own JsonParser, so the buffers of
+// the first pass and of the tapes are reused instead of allocated per
+// document. The strings of the documents are borrowed from the input.
+//
+// Ordered mode: next() hands the chunks over in input order, at most
+// queue_depth chunks are parsed ahead of the reader.
+class JsonParallelReader {
+ public:
+  explicit JsonParallelReader(PaddedStringView input,
+                              const ParallelOptions& options = {});
+  ~JsonParallelReader();
+  JsonParallelReader(const JsonParallelReader&) = delete;
+  JsonParallelReader& operator=(const JsonParallelReader&) = delete;
+
+  // the next chunk in input order, nullptr at the end. The previous chunk
+  // is handed back to the workers.
+  const JsonChunk* next();
+  size_t chunk_count() const { return _bounds.size() - 1; }
+
+ private:
+  friend void parse_parallel(PaddedStringView input,
+                             const std::function<void(const JsonChunk&)>&,
+                             const ParallelOptions& options);
+  using Callback = std::function<void(const JsonChunk&)>;
+
+  struct worker {
+    std::mutex mutex;
+    std::deque<size_t> chunks;
+    x86_implement parser;
+    // results of the unordered mode
+    JsonChunk chunk;
+  };
+
+  JsonParallelReader(PaddedStringView input, const ParallelOptions& options,
+                     const Callback* callback);
+  bool take(size_t id, size_t& chunk);
+  void parse_chunk(worker& self, size_t chunk, JsonChunk& out);
+  void run_worker(size_t id);
+  void join();
+
+  PaddedStringView _input;
+  // chunk i is [_bounds[i], _bounds[i + 1])
+  std::vector<size_t> _bounds;
+  const Callback* _callback;
+  size_t _worker_count;
+  std::unique_ptr<worker[]> _workers;
+  std::vector<std::thread> _threads;
+
+  // ordered mode: chunk i is parsed into _slots[i % depth] once the reader
+  // has released every chunk before i - depth
+  std::vector<JsonChunk> _slots;
+  // chunk index + 1 once the slot holds a parsed chunk
+  std::vector<size_t> _ready;
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  size_t _released = 0;
+  bool _holding = false;
+  bool _stop = false;
+};
+}  // namespace simdjson
+
+#endif  // PARALLEL_H
@@ -0,0 +1,128 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef PUSH_H
+#define PUSH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "result.h"
+
+namespace simdjson {
+
+// Receives the events of a JsonPushParser in document order. Keys and
+// strings are decoded and only valid during the call.
+class JsonPushHandler {
+ public:
+  virtual ~JsonPushHandler() = default;
+
+  virtual void start_object() {}
+  virtual void end_object() {}
+  virtual void start_array() {}
+  virtual void end_array() {}
+  virtual void key(std::string_view /*key*/) {}
+  virtual void string(std::string_view /*value*/) {}
+  // like Json, integers are int64_t, or uint64_t above INT64_MAX
+  virtual void number(int64_t /*value*/) {}
+  virtual void number(uint64_t /*value*/) {}
+  virtual void number(double /*value*/) {}
+  virtual void boolean(bool /*value*/) {}
+  virtual void null() {}
+  // a top-level value closed
+  virtual void end_document() {}
+};
+
+// Parses whitespace-separated documents handed over in chunks of any size,
+// such as socket reads. The scanning state survives the chunk boundaries,
+// so each event is reported as soon as its bytes arrived, and the parser
+// only keeps the container stack and the token being read, never the
+// document. The first error stops the parser until reset().
+class JsonPushParser {
+ public:
+  explicit JsonPushParser(JsonPushHandler& handler) : _handler(handler) {}
+
+  // the next bytes of the input, false once the input is invalid
+  bool feed(std::string_view chunk);
+  // the end of the input, a number at the very end is reported now. False
+  // if a document is unfinished, otherwise the parser takes a new input.
+  bool finish();
+  void reset();
+
+  // the message is only built by get_error
+  bool is_error() const { return static_cast<bool>(_error); }
+  JsonParseError get_error() const {
+    return is_error() ? _error.message() : JsonParseError();
+  }
+  error_code get_error_code() const { return _error.code; }
+  // bytes consumed so far, the offset of the failing byte after an error
+  size_t offset() const { return _offset; }
+  // documents completed since the last reset
+  size_t document_count() const { return _document_count; }
+
+ private:
+  // the grammar: what may come after the last token
+  enum class expect : uint8_t {
+    DOCUMENT,
+    VALUE,
+    VALUE_OR_CLOSE,
+    KEY,
+    KEY_OR_CLOSE,
+    COLON,
+    COMMA_OR_CLOSE,
+  };
+  // the token that the last chunk ended in
+  enum class token : uint8_t { NONE, STRING, NUMBER, LITERAL };
+  // the literal that the last chunk ended in
+  enum class literal : uint8_t { TRUE_VALUE, FALSE_VALUE, NULL_VALUE };
+  // where a string is in an escape sequence
+  enum class escape : uint8_t { NONE, START, UNICODE, LOW_BACKSLASH, LOW_U };
+
+  const char* next_token(const char* p, const char* end);
+  const char* start_value(const char* p, const char* end);
+  const char* close(const char* p, bool object);
+  const char* read_string(const char* p, const char* end);
+  const char* read_escape(const char* p);
+  const char* read_number(const char* p, const char* end);
+  const char* read_literal(const char* p, const char* end);
+  bool emit_number(std::string_view digits);
+  void emit_string(std::string_view value);
+  void value_done(bool scalar);
+  // `carried` bytes of the failing token came in earlier chunks
+  const char* fail(const char* p, error_code error, size_t carried = 0);
+
+  JsonPushHandler& _handler;
+  expect _expect = expect::DOCUMENT;
+  token _token = token::NONE;
+  // true for an object
+  std::vector<bool> _stack;
+  // the part of a string or number seen in earlier chunks, a string that
+  // ends in its first chunk is reported from the chunk
+  std::string _buffer;
+  bool _key = false;
+  escape _escape = escape::NONE;
+  uint8_t _hex_count = 0;
+  uint32_t _code = 0;
+  // a high surrogate waiting for its low half
+  uint32_t _high = 0;
+  // continuation bytes left in a utf-8 sequence, and the range of the next
+  uint8_t _utf8_need = 0;
+  uint8_t _utf8_low = 0x80;
+  uint8_t _utf8_high = 0xBF;
+  // the rest of true, false or null, and which of them it is
+  std::string_view _literal;
+  literal _literal_kind = literal::NULL_VALUE;
+  // a top-level number or literal needs whitespace before the next document
+  bool _after_scalar = false;
+  size_t _offset = 0;
+  size_t _document_count = 0;
+  // the chunk being fed, errors are reported relative to its start
+  const char* _chunk = nullptr;
+  JsonError _error;
+};
+}  // namespace simdjson
+
+#endif  // PUSH_H
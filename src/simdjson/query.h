@@ -0,0 +1,95 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ondemand.h"
+#include "result.h"
+
+namespace simdjson {
+
+// A path compiled once and evaluated against on-demand documents, see
+// ondemand.h. Only the containers on the path are opened, the values next to
+// it are skipped with a jump to their closing bracket.
+class JsonPath {
+ public:
+  // the root
+  JsonPath() = default;
+
+  // an RFC 6901 pointer: "" is the root and "/a/0" the member "0" of an
+  // object or the first element of an array under "a". "~1" stands for '/'
+  // and "~0" for '~' inside a token.
+  static JsonPath from_pointer(std::string_view pointer);
+  // the subset "$", ".name", "['name']" or "[\"name\"]" and "[3]", as in
+  // "$.a.b[3]". A backslash inside a quoted name escapes the next character.
+  static JsonPath from_expression(std::string_view expression);
+
+  // the path could not be compiled, it never matches
+  bool is_error() const { return !_error.empty(); }
+  JsonParseError get_error() const { return _error; }
+  size_t size() const { return _steps.size(); }
+
+  // the value at the path, one that does not exist() if a step is missing
+  OnDemandValue find(OnDemandDocument& doc) const;
+
+ private:
+  friend class JsonQuery;
+
+  static constexpr size_t kNoIndex = static_cast<size_t>(-1);
+  // a member name, an array index, or for pointers a token that is both
+  struct step {
+    std::string key;
+    size_t index = kNoIndex;
+    bool by_key = false;
+    bool by_index = false;
+    bool operator==(const step&) const = default;
+  };
+
+  std::vector<step> _steps;
+  JsonParseError _error;
+};
+
+// Several paths evaluated in one walk: the paths are merged into a tree of
+// steps, every container that some path goes through is read once, and
+// reading an object stops as soon as every member asked for is found.
+class JsonQuery {
+ public:
+  JsonQuery() : _nodes(1) {}
+
+  // add `path` and return its slot in the results. A path that is_error()
+  // keeps its slot but never matches.
+  size_t add(const JsonPath& path);
+  size_t size() const { return _slots; }
+
+  // results[i] is the value of the path in slot i, or a value that does not
+  // exist() if the path is missing. Duplicate keys resolve to the first.
+  void evaluate(OnDemandDocument& doc,
+                std::vector<OnDemandValue>& results) const;
+
+ private:
+  struct node {
+    JsonPath::step step;
+    std::vector<size_t> children;
+    // the slots of the paths that end here
+    std::vector<size_t> slots;
+    // the largest index among the children, how far an array is read
+    size_t last_index = 0;
+    bool has_index_child = false;
+    size_t key_children = 0;
+  };
+
+  void walk(size_t id, OnDemandValue value,
+            std::vector<OnDemandValue>& results) const;
+
+  std::vector<node> _nodes;
+  size_t _slots = 0;
+};
+}  // namespace simdjson
+
+#endif  // QUERY_H
@@ -5,9 +5,16 @@
 #define RESULT_H
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -19,56 +26,183 @@ class NULL_T {
   bool operator<(const NULL_T&) const { return false; }
 };
 
-using JsonObject = std::unordered_map<std::string, Json>;
-using JsonArray = std::vector<Json>;
-using JsonValue = std::variant<std::string, int64_t, double, bool, JsonObject,
-                               JsonArray, NULL_T>;
+// strings and containers take a memory resource, so a parser can build the
+// whole tree in its arena, see arena.h
+using JsonString = std::pmr::string;
+using JsonObject = std::pmr::unordered_map<JsonString, Json>;
+using JsonArray = std::pmr::vector<Json>;
+// uint64_t only holds the integers above INT64_MAX
+using JsonValue = std::variant<JsonString, int64_t, uint64_t, double, bool,
+                               JsonObject, JsonArray, NULL_T>;
 using JsonParseError = std::string;
+// containers nested deeper than this are an error, unless the parser is
+// given another limit with set_max_depth
+constexpr size_t kDefaultMaxDepth = 1024;
+
+// why a parse failed, one byte so that failing costs no more than a return
+enum class error_code : uint8_t {
+  SUCCESS = 0,
+  EMPTY,
+  UNEXPECTED_END,
+  TOO_LARGE,
+  DEPTH_EXCEEDED,
+  INVALID_UTF8,
+  UNCLOSED_STRING,
+  CONTROL_CHARACTER,
+  INVALID_ESCAPE,
+  EXPECTED_KEY,
+  EXPECTED_COLON,
+  EXPECTED_OBJECT_END,
+  UNEXPECTED_IN_OBJECT,
+  EXPECTED_ARRAY_END,
+  INVALID_NUMBER,
+  NUMBER_OUT_OF_RANGE,
+  INVALID_BOOL,
+  INVALID_NULL,
+  UNEXPECTED_CHARACTER,
+  UNEXPECTED_TYPE,
+  IO_ERROR,
+};
+
+constexpr std::string_view error_message(error_code code) {
+  switch (code) {
+    case error_code::SUCCESS:
+      return "Success";
+    case error_code::EMPTY:
+      return "Empty json";
+    case error_code::UNEXPECTED_END:
+      return "Unexpected end of json";
+    case error_code::TOO_LARGE:
+      return "Json too large";
+    case error_code::DEPTH_EXCEEDED:
+      return "Exceeded max depth";
+    case error_code::INVALID_UTF8:
+      return "Invalid UTF-8";
+    case error_code::UNCLOSED_STRING:
+      return "Expected '\"' in string";
+    case error_code::CONTROL_CHARACTER:
+      return "Invalid escape or control character in string";
+    case error_code::INVALID_ESCAPE:
+      return "Invalid escape in string";
+    case error_code::EXPECTED_KEY:
+      return "Expected '\"' in object";
+    case error_code::EXPECTED_COLON:
+      return "Expected ':' in object";
+    case error_code::EXPECTED_OBJECT_END:
+      return "Expected '}' in object";
+    case error_code::UNEXPECTED_IN_OBJECT:
+      return "Unexpected charater squence in object";
+    case error_code::EXPECTED_ARRAY_END:
+      return "Expected ']' in array";
+    case error_code::INVALID_NUMBER:
+      return "Expected number";
+    case error_code::NUMBER_OUT_OF_RANGE:
+      return "Number out of range";
+    case error_code::INVALID_BOOL:
+      return "Expected 'true' or 'false'";
+    case error_code::INVALID_NULL:
+      return "Expected 'null'";
+    case error_code::UNEXPECTED_CHARACTER:
+      return "Unexpected character in json";
+    case error_code::UNEXPECTED_TYPE:
+      return "Unexpected type";
+    case error_code::IO_ERROR:
+      return "Cannot read file";
+  }
+  return "Unknown error";
+}
+
+// A failed parse: the error and the byte of the input it was found at.
+// Like std::error_code, it is true in a condition when it holds an error.
+// Only message() allocates.
+struct JsonError {
+  error_code code = error_code::SUCCESS;
+  size_t offset = 0;
+
+  explicit operator bool() const { return code != error_code::SUCCESS; }
+  std::string message() const {
+    return std::string(error_message(code)) + " at byte " +
+           std::to_string(offset);
+  }
+};
 
 class Json {
  public:
-  // from other result
-  Json() : _result(std::make_unique<JsonValue>()) {}
+  // from other result, a copy always lives on the default resource
+  Json() : _result(make_value(std::pmr::get_default_resource())) {}
   Json(const Json& other)
-      : _result(std::make_unique<JsonValue>(*other._result)) {}
-  Json(Json&& other) noexcept { _result = std::move(other._result); }
+      : _result(other.is_error() ? nullptr
+                                 : make_value(std::pmr::get_default_resource(),
+                                              *other._result)),
+        _error(other._error) {}
+  Json(Json&& other) noexcept
+      : _result(std::move(other._result)), _error(other._error) {}
   Json& operator=(const Json& other) {
-    _result = std::make_unique<JsonValue>(*other._result);
+    _result = other.is_error()
+                  ? nullptr
+                  : make_value(std::pmr::get_default_resource(),
+                               *other._result);
+    _error = other._error;
     return *this;
   }
   Json& operator=(Json&& other) noexcept {
     _result = std::move(other._result);
+    _error = other._error;
     return *this;
   }
 
   // from value and error
   explicit Json(const JsonValue& value)
-      : _result(std::make_unique<JsonValue>(value)) {}
+      : _result(make_value(std::pmr::get_default_resource(), value)) {}
   explicit Json(JsonValue&& value)
-      : _result(std::make_unique<JsonValue>(std::move(value))) {}
-  explicit Json(const JsonParseError& error)
-      : _result(std::make_unique<JsonValue>(error)) {}
-  explicit Json(JsonParseError&& error)
-      : _result(std::make_unique<JsonValue>(std::move(error))) {}
+      : _result(
+            make_value(std::pmr::get_default_resource(), std::move(value))) {}
+  // the node is allocated from `resource`, which should also own the
+  // strings and containers inside `value`
+  Json(JsonValue&& value, std::pmr::memory_resource* resource)
+      : _result(make_value(resource, std::move(value))) {}
+  // the alternative T is constructed from `args` inside the node, so the
+  // builders never move a string or a container into place
+  template <typename T, typename... Args>
+  Json(std::in_place_type_t<T> type, std::pmr::memory_resource* resource,
+       Args&&... args)
+      : _result(make_value(resource, type, std::forward<Args>(args)...)) {}
+  // a failure holds no value and allocates nothing
+  explicit Json(const JsonError& error) : _error(error) {}
   ~Json() = default;
 
-  // check if error
-  bool is_error() const { return !_error.empty(); }
-  JsonParseError get_error() const { return _error; }
+  // check if error, the message is only built by get_error
+  bool is_error() const { return static_cast<bool>(_error); }
+  JsonParseError get_error() const {
+    return is_error() ? _error.message() : JsonParseError();
+  }
+  error_code get_error_code() const { return _error.code; }
+  size_t get_error_offset() const { return _error.offset; }
 
-  // access values
+  // access values, std::string is accepted for string values as well
   template <typename T>
   T get_value() const {
-    assert(is_type<T>(*_result));
-    return std::get<T>(*_result);
+    if constexpr (std::is_same_v<T, std::string>) {
+      assert(is_string());
+      return std::string(std::get<JsonString>(*_result));
+    } else {
+      assert(is_type<T>(*_result));
+      return std::get<T>(*_result);
+    }
   }
 
-  Json& operator[](const std::string& key) {
+  Json& operator[](std::string_view key) {
     assert(is_object());
-    return std::get<JsonObject>(*_result).count(key)
-               ? std::get<JsonObject>(*_result).at(key)
-               : (std::get<JsonObject>(*_result)[key] =
-                      Json(JsonValue(NULL_T{})));
+    auto& object = std::get<JsonObject>(*_result);
+    JsonString object_key(key, object.get_allocator());
+    auto it = object.find(object_key);
+    if (it != object.end()) {
+      return it->second;
+    }
+    return object
+        .emplace(std::move(object_key),
+                 Json(JsonValue(NULL_T{}), object.get_allocator().resource()))
+        .first->second;
   }
   Json& operator[](size_t index) {
     assert(is_array());
@@ -80,16 +214,28 @@ class Json {
   bool is_type(const std::variant<Args...>& v) const {
     return std::holds_alternative<T>(v);
   }
-  bool is_string() const { return is_type<std::string>(*_result); }
-  bool is_int64() const { return is_type<int64_t>(*_result); }
-  bool is_double() const { return is_type<double>(*_result); }
-  bool is_bool() const { return is_type<bool>(*_result); }
-  bool is_object() const { return is_type<JsonObject>(*_result); }
-  bool is_array() const { return is_type<JsonArray>(*_result); }
-  bool is_null() const { return is_type<NULL_T>(*_result); }
+  bool is_string() const { return holds<JsonString>(); }
+  bool is_int64() const { return holds<int64_t>(); }
+  bool is_uint64() const { return holds<uint64_t>(); }
+  bool is_double() const { return holds<double>(); }
+  bool is_bool() const { return holds<bool>(); }
+  bool is_object() const { return holds<JsonObject>(); }
+  bool is_array() const { return holds<JsonArray>(); }
+  bool is_null() const { return holds<NULL_T>(); }
 
-  // dump the json value as a string
-  std::string dump() { return {}; }
+  // Serialize the value. With a negative `indent` the output is compact,
+  // otherwise every member and element goes on its own line, indented by
+  // `indent` spaces per level. Members come in the order of the map. Doubles
+  // take the shortest form that reads back to the same value, with ".0"
+  // when that looks like an integer. nan and infinity are written as null.
+  // An error is written as its message, which is not json.
+  std::string dump(int indent = -1) const;
+  // append the output of dump to `out`, reusing its capacity
+  void dump_to(std::string& out, int indent = -1) const;
+  // write the output of dump to `out` without allocating and return its
+  // size. If the size is larger than `out`, the output did not fit and the
+  // contents of `out` are unspecified.
+  size_t dump_to(std::span<char> out, int indent = -1) const;
 
   // append and remove values
   void append_value(const JsonValue& value) {
@@ -111,23 +257,56 @@ class Json {
     return true;
   }
   // for object, key is the key to remove, return false if key not found
-  bool remove_value(const std::string& key) {
+  bool remove_value(std::string_view key) {
     assert(is_object());
     auto& object = std::get<JsonObject>(*_result);
-    if (object.find(key) == object.end()) {
+    auto it = object.find(JsonString(key, object.get_allocator()));
+    if (it == object.end()) {
       return false;
     }
-    object.erase(key);
+    object.erase(it);
     return true;
   }
 
  protected:
   // for parser to pass the errors
-  void set_error(std::string_view error) { _error = error; }
+  void set_error(const JsonError& error) {
+    _result.reset();
+    _error = error;
+  }
 
  private:
-  std::unique_ptr<JsonValue> _result;
-  std::string _error;
+  friend class json_serializer;
+  friend class allocation_counter;
+
+  // an error holds no value
+  template <typename T>
+  bool holds() const {
+    return _result != nullptr && std::holds_alternative<T>(*_result);
+  }
+
+  // returns the node to the resource it was allocated from
+  struct ValueDeleter {
+    ValueDeleter() : resource(nullptr) {}
+    explicit ValueDeleter(std::pmr::memory_resource* r) : resource(r) {}
+    std::pmr::memory_resource* resource;
+    void operator()(JsonValue* value) const {
+      std::destroy_at(value);
+      resource->deallocate(value, sizeof(JsonValue), alignof(JsonValue));
+    }
+  };
+  using ValuePtr = std::unique_ptr<JsonValue, ValueDeleter>;
+
+  template <typename... Args>
+  static ValuePtr make_value(std::pmr::memory_resource* resource,
+                             Args&&... args) {
+    void* node = resource->allocate(sizeof(JsonValue), alignof(JsonValue));
+    return ValuePtr(new (node) JsonValue(std::forward<Args>(args)...),
+                    ValueDeleter(resource));
+  }
+
+  ValuePtr _result;
+  JsonError _error;
 };
 
 };      // namespace simdjson
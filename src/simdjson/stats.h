@@ -0,0 +1,59 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace simdjson {
+
+// the time spent in one pass of the parser
+struct ParseStageTime {
+  // ticks of the time stamp counter, which runs at a fixed rate
+  uint64_t cycles = 0;
+  std::chrono::nanoseconds time{0};
+};
+
+// What the parses of a parser cost, added up from one parse to the next
+// while it is attached with set_stats. parse, parse_in_arena, parse_node,
+// parse_document and parse_many report to it, parse_many counts every
+// document as a parse. The counters a mode cannot see stay 0.
+struct ParseStats {
+  size_t parses = 0;
+  size_t bytes = 0;
+  // the first pass indexes the structurals and checks the utf-8, the second
+  // builds the tree. The normal implement has no index, its first pass only
+  // checks the utf-8.
+  ParseStageTime first_pass;
+  ParseStageTime second_pass;
+  // the part of the second pass spent converting numbers and decoding and
+  // copying strings, keys included. Reading the counter around every value
+  // slows the second pass down, compare passes with each other, not with a
+  // parse without stats.
+  uint64_t number_cycles = 0;
+  uint64_t string_cycles = 0;
+
+  size_t objects = 0;
+  size_t arrays = 0;
+  size_t keys = 0;
+  size_t strings = 0;
+  size_t numbers = 0;
+  size_t bools = 0;
+  size_t nulls = 0;
+  size_t max_depth = 0;
+  // bytes of strings and keys between their quotes
+  size_t string_bytes = 0;
+  // taken from the memory resource by the trees of the successful parses,
+  // counted once they are built, only Json trees count
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+
+  void reset() { *this = ParseStats(); }
+};
+}  // namespace simdjson
+
+#endif  // STATS_H
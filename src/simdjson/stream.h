@@ -0,0 +1,118 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "padded_string.h"
+#include "result.h"
+#include "stats.h"
+
+namespace simdjson {
+
+constexpr size_t kDefaultBatchSize = 1 << 20;
+
+// A stream of whitespace-separated documents, one per line for NDJSON.
+// The input is indexed by the first pass in batches of about `batch_size`
+// bytes, cut after a newline. When the input spans several batches, a worker
+// thread indexes the next batch while the documents of the current one are
+// read. Each document is built on a tape reused by the next one, with its
+// strings borrowed from the input. The stream stops after the first document
+// that fails, or nests deeper than `max_depth`. While `stats` is attached,
+// every document counts as a parse and every batch adds its bytes and the
+// time of its first pass.
+class JsonStream {
+ public:
+  class iterator {
+   public:
+    explicit iterator(JsonStream* stream) : _stream(stream) {}
+    const JsonDocument& operator*() const { return _stream->_document; }
+    iterator& operator++() {
+      _stream->next();
+      return *this;
+    }
+    bool operator==(std::default_sentinel_t) const { return _stream->_done; }
+
+   private:
+    JsonStream* _stream;
+  };
+
+  JsonStream(PaddedStringView input, size_t batch_size,
+             ParseStats* stats = nullptr,
+             size_t max_depth = kDefaultMaxDepth);
+  ~JsonStream();
+  JsonStream(const JsonStream&) = delete;
+  JsonStream& operator=(const JsonStream&) = delete;
+
+  // the stream is single pass, begin() reads the first document
+  iterator begin() {
+    next();
+    return iterator(this);
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+  // documents read so far
+  size_t document_count() const { return _document_count; }
+
+ private:
+  struct batch {
+    // offset of the batch in the input, tokens are relative to it
+    size_t start = 0;
+    size_t size = 0;
+    std::vector<uint32_t> tokens;
+    // tokens of the complete documents of the batch
+    size_t token_count = 0;
+    // where the next batch starts
+    size_t next_start = 0;
+    JsonError error;
+    // time of the first pass, only taken while stats are attached
+    ParseStageTime first_pass;
+  };
+
+  void next();
+  bool acquire_batch();
+  void index_batch(batch& out, size_t start) const;
+  void run_worker();
+
+  PaddedStringView _input;
+  size_t _batch_size;
+  bool (*_find_structural_bits)(const uint8_t*, size_t, uint32_t*, size_t&);
+  // not owned, only touched by the reading side
+  ParseStats* _stats;
+  size_t _max_depth;
+
+  // double buffer: the worker fills one batch while the other is read
+  batch _batches[2];
+  std::thread _worker;
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  size_t _produced = 0;
+  size_t _consumed = 0;
+  bool _finished = false;
+  bool _stop = false;
+
+  // reading side
+  batch* _batch = nullptr;
+  size_t _next_start = 0;
+  size_t _index = 0;
+  size_t _document_count = 0;
+  bool _failed = false;
+  bool _done = false;
+  JsonDocument _document;
+  std::vector<bool> _scopes;
+  // where the strings are decoded before they are borrowed or copied
+  std::vector<char> _scratch;
+  // tape index of every open container of the document being built
+  std::vector<size_t> _containers;
+};
+}  // namespace simdjson
+
+#endif  // STREAM_H
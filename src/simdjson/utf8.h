@@ -0,0 +1,20 @@
+//
+// Created by zzy on 12/17/23.
+//
+
+#ifndef UTF8_H
+#define UTF8_H
+#include <cstddef>
+#include <span>
+
+namespace simdjson {
+// Check that `input` is valid utf-8 with the active kernel, 64 bytes at a
+// time with a fast path for ascii blocks. The parsers run the same check
+// during their first pass, this is for input that is not parsed.
+bool validate_utf8(std::span<const char> input);
+// same, on failure `error_offset` is set to the first byte of the first
+// invalid sequence
+bool validate_utf8(std::span<const char> input, size_t& error_offset);
+}  // namespace simdjson
+
+#endif  // UTF8_H
@@ -3,9 +3,14 @@
 //
 #include <gtest/gtest.h>
 #include <simdjson/json.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <random>
 
 TEST(simdjson, declare) {
   simdjson::JsonParser parser;
@@ -34,20 +39,55 @@ TEST(simdjson, normal_impl_number) {
 
   // for overflow int64
   auto json_obj5 = parser.parse("9223372036854775808");
-  EXPECT_EQ(json_obj5.is_double(), true);
-  EXPECT_EQ(json_obj5.get_value<double>(), 9223372036854775808.0);
+  EXPECT_EQ(json_obj5.is_uint64(), true);
+  EXPECT_EQ(json_obj5.get_value<uint64_t>(), 9223372036854775808ull);
+  auto json_obj8 = parser.parse("18446744073709551616");
+  EXPECT_EQ(json_obj8.is_double(), true);
+  EXPECT_EQ(json_obj8.get_value<double>(), 18446744073709551616.0);
+  auto json_obj9 = parser.parse("-9223372036854775808");
+  EXPECT_EQ(json_obj9.is_int64(), true);
+  EXPECT_EQ(json_obj9.get_value<int64_t>(), INT64_MIN);
 
-  // for illegal number
-  auto json_obj6 = parser.parse("123.456.789");
-  // we just care first match, so it is not error
-  EXPECT_EQ(json_obj6.is_error(), false);
-  EXPECT_EQ(json_obj6.is_double(), true);
-  EXPECT_EQ(json_obj6.get_value<double>(), 123.456);
+  // for illegal number, the number must end at a delimiter
+  for (const char* number : {"123.456.789", "123.4e6.789", "01", "-", "1.",
+                             ".5", "1e", "1e+", "+1", "1x"}) {
+    auto json = parser.parse(number);
+    EXPECT_TRUE(json.is_error()) << number;
+    EXPECT_EQ(json.get_error_code(), simdjson::error_code::INVALID_NUMBER)
+        << number;
+  }
+}
 
-  auto json_obj7 = parser.parse("123.4e6.789");
-  EXPECT_EQ(json_obj7.is_error(), false);
-  EXPECT_EQ(json_obj7.is_double(), true);
-  EXPECT_EQ(json_obj7.get_value<double>(), 123.4e6);
+TEST(simdjson, number_engine) {
+  simdjson::JsonParser parser;
+  // every path must give the correctly rounded double
+  for (const char* number :
+       {"0.1", "1e23", "2.2250738585072014e-308", "4.9e-324",
+        "1.7976931348623157e308", "9007199254740993.0",
+        "123456789012345678901234567890", "0.000001234", "-1.5e-7",
+        "3.14159265358979323846264338327950288", "1E22", "1e-400"}) {
+    SCOPED_TRACE(number);
+    auto json = parser.parse(number);
+    ASSERT_TRUE(json.is_double());
+    EXPECT_EQ(json.get_value<double>(), std::strtod(number, nullptr));
+  }
+  EXPECT_EQ(parser.parse("12345678901234567").get_value<int64_t>(),
+            12345678901234567);
+  EXPECT_EQ(parser.parse("-0").get_value<int64_t>(), 0);
+  EXPECT_FALSE(parser.parse("1e400").is_double());
+
+  const auto& doc = parser.parse_document(
+      "[18446744073709551615, -12, 2.5, 1e2, 9223372036854775807]");
+  ASSERT_FALSE(doc.is_error());
+  auto root = doc.root();
+  EXPECT_EQ(root[0].get_value<uint64_t>(), UINT64_MAX);
+  EXPECT_EQ(root[1].get_value<int64_t>(), -12);
+  EXPECT_EQ(root[2].get_value<double>(), 2.5);
+  EXPECT_EQ(root[3].get_value<double>(), 100.0);
+  EXPECT_EQ(root[4].get_value<int64_t>(), INT64_MAX);
+  EXPECT_TRUE(parser.parse_document("[123.456.789]").is_error());
+  EXPECT_TRUE(parser.parse_document("[1.5e]").is_error());
+  EXPECT_TRUE(parser.parse_document("{\"a\": 01}").is_error());
 }
 
 TEST(simdjson, normal_impl_string) {
@@ -315,12 +355,1579 @@ TEST(simdjson, regression_test_2) {
   std::ifstream ifs(std::string(__FILE_PATH__) +
                     "/local_large_json/amazon_cellphones.ndjson");
   ASSERT_TRUE(ifs.is_open());
-  while (ifs.eof()) {
+  std::string content((std::istreambuf_iterator<char>(ifs)),
+                      std::istreambuf_iterator<char>());
+  const simdjson::PaddedString json(content);
+  // the last line has no trailing newline
+  const size_t lines = std::count(content.begin(), content.end(), '\n') + 1;
+  simdjson::JsonParser parser;
+  // a small batch size so the stream runs over many batches
+  auto stream = parser.parse_many(json, 16 * 1024);
+  size_t count = 0;
+  for (const auto& doc : stream) {
+    ASSERT_FALSE(doc.is_error()) << doc.get_error();
+    ASSERT_TRUE(doc.root().is_array());
+    ++count;
+  }
+  EXPECT_EQ(count, lines);
+  EXPECT_EQ(stream.document_count(), lines);
+}
+static void expect_same_json(simdjson::Json& lhs, simdjson::Json& rhs) {
+  ASSERT_EQ(lhs.is_object(), rhs.is_object());
+  ASSERT_EQ(lhs.is_array(), rhs.is_array());
+  ASSERT_EQ(lhs.is_string(), rhs.is_string());
+  ASSERT_EQ(lhs.is_int64(), rhs.is_int64());
+  ASSERT_EQ(lhs.is_uint64(), rhs.is_uint64());
+  ASSERT_EQ(lhs.is_double(), rhs.is_double());
+  ASSERT_EQ(lhs.is_bool(), rhs.is_bool());
+  ASSERT_EQ(lhs.is_null(), rhs.is_null());
+  if (lhs.is_object()) {
+    auto lhs_obj = lhs.get_value<simdjson::JsonObject>();
+    auto rhs_obj = rhs.get_value<simdjson::JsonObject>();
+    ASSERT_EQ(lhs_obj.size(), rhs_obj.size());
+    for (auto& [key, value] : lhs_obj) {
+      ASSERT_EQ(rhs_obj.count(key), 1);
+      expect_same_json(value, rhs_obj[key]);
+    }
+  } else if (lhs.is_array()) {
+    auto lhs_arr = lhs.get_value<simdjson::JsonArray>();
+    auto rhs_arr = rhs.get_value<simdjson::JsonArray>();
+    ASSERT_EQ(lhs_arr.size(), rhs_arr.size());
+    for (size_t i = 0; i < lhs_arr.size(); i++) {
+      expect_same_json(lhs_arr[i], rhs_arr[i]);
+    }
+  } else if (lhs.is_string()) {
+    EXPECT_EQ(lhs.get_value<std::string>(), rhs.get_value<std::string>());
+  } else if (lhs.is_int64()) {
+    EXPECT_EQ(lhs.get_value<int64_t>(), rhs.get_value<int64_t>());
+  } else if (lhs.is_uint64()) {
+    EXPECT_EQ(lhs.get_value<uint64_t>(), rhs.get_value<uint64_t>());
+  } else if (lhs.is_double()) {
+    EXPECT_EQ(lhs.get_value<double>(), rhs.get_value<double>());
+  } else if (lhs.is_bool()) {
+    EXPECT_EQ(lhs.get_value<bool>(), rhs.get_value<bool>());
+  }
+}
+
+// run the body once with every kernel the cpu supports
+template <typename Body>
+static void for_each_kernel(Body body) {
+  const auto& active = simdjson::active_kernel();
+  for (const auto* kernel : simdjson::available_kernels()) {
+    if (!simdjson::force_kernel(kernel->name)) {
+      continue;
+    }
+    SCOPED_TRACE(std::string(kernel->name));
+    body();
+  }
+  ASSERT_TRUE(simdjson::force_kernel(active.name));
+}
+
+TEST(simdjson, kernel_dispatch) {
+  const auto& active = simdjson::active_kernel();
+  EXPECT_TRUE(active.supported());
+  EXPECT_TRUE(simdjson::force_kernel("fallback"));
+  EXPECT_EQ(simdjson::active_kernel().name, "fallback");
+  EXPECT_FALSE(simdjson::force_kernel("unknown"));
+  EXPECT_EQ(simdjson::active_kernel().name, "fallback");
+  // the parser picks the normal implement on the fallback kernel
+  simdjson::JsonParser parser;
+  EXPECT_EQ(parser.parse("[1, 2]").get_value<simdjson::JsonArray>().size(), 2);
+  EXPECT_TRUE(simdjson::force_kernel(active.name));
+}
+
+TEST(simdjson, simd_impl_matches_normal_impl) {
+  for_each_kernel([] {
+    simdjson::JsonParser parser;
+    for (const std::string json :
+         {"123", "-123.456", "\"123\"", "true", "false", "null", "[]", "{}",
+          "[\"value\", 123, true, null, {\"key\": \"value\"}]",
+          "{\"key\": \"value\", \"key2\": 123, \"key3\": true, \"key4\": null, "
+          "\"key5\": {\"key6\": \"value6\", \"key7\": [1, 2.5, [], {}]}}"}) {
+      auto simd = parser.parse_simd_impl(json);
+      auto normal = parser.parse_normal_impl(json);
+      expect_same_json(simd, normal);
+    }
+
+    std::ifstream ifs(std::string(__FILE_PATH__) +
+                      "/local_large_json/simple_array.json");
+    ASSERT_TRUE(ifs.is_open());
+    std::string content((std::istreambuf_iterator<char>(ifs)),
+                        std::istreambuf_iterator<char>());
+    auto simd = parser.parse_simd_impl(content);
+    auto normal = parser.parse_normal_impl(content);
+    EXPECT_EQ(simd.get_value<simdjson::JsonArray>().size(), 10);
+    expect_same_json(simd, normal);
+  });
+}
+
+TEST(simdjson, simd_impl_string) {
+  for_each_kernel([] {
+    simdjson::JsonParser parser;
+    // structural characters and escaped quotes inside strings
+    auto json_obj = parser.parse_simd_impl(
+        "{\"k{e}y\": \"[v,a:l]\", \"a\\\"b\": \"c\\\\\", \"d\": \"\\\\\\\"\"}");
+    EXPECT_EQ(json_obj.is_object(), true);
+    EXPECT_EQ(json_obj.get_value<simdjson::JsonObject>().size(), 3);
+    EXPECT_EQ(json_obj["k{e}y"].get_value<std::string>(), "[v,a:l]");
+    EXPECT_EQ(json_obj["a\"b"].get_value<std::string>(), "c\\");
+    EXPECT_EQ(json_obj["d"].get_value<std::string>(), "\\\"");
+
+    // strings and backslash runs crossing the 64 bytes block boundary
+    for (size_t pad = 50; pad < 80; pad++) {
+      std::string value = std::string(pad, 'x') + "\\\\\\\"y";
+      auto json_arr = parser.parse_simd_impl("[\"" + value + "\", 1]");
+      ASSERT_EQ(json_arr.is_array(), true);
+      ASSERT_EQ(json_arr.get_value<simdjson::JsonArray>().size(), 2);
+      EXPECT_EQ(json_arr[0].get_value<std::string>(),
+                std::string(pad, 'x') + "\\\"y");
+      EXPECT_EQ(json_arr[1].get_value<int64_t>(), 1);
+    }
+  });
+}
+
+TEST(simdjson, whole_input) {
+  for_each_kernel([] {
+    simdjson::JsonParser parser;
+    // a literal must end at a delimiter, like a number
+    for (const char* json : {"[truex]", "[nullnull]", "[falsey]", "truex",
+                             "{\"a\": nul}", "[tru]"}) {
+      SCOPED_TRACE(json);
+      EXPECT_TRUE(parser.parse_simd_impl(json).is_error());
+      EXPECT_TRUE(parser.parse_normal_impl(json).is_error());
+      EXPECT_TRUE(parser.parse_document(json).is_error());
+      EXPECT_FALSE(parser.try_parse_node(json).has_value());
+    }
+    for (const char* json : {"[truex]", "[falsey]"}) {
+      const simdjson::PaddedString padded(json);
+      EXPECT_FALSE(
+          parser.iterate(padded).root()[0].get_value<bool>().has_value());
+    }
+    EXPECT_EQ(parser.parse_simd_impl("[true,null]").dump(), "[true,null]");
+    EXPECT_EQ(parser.parse_normal_impl("[true,null]").dump(), "[true,null]");
+    EXPECT_TRUE(parser.parse_simd_impl("false ").is_bool());
+
+    // nothing but whitespace may follow the root
+    for (const auto& [json, offset] :
+         {std::pair{"1 2", 2}, {"[1] [2]", 4}, {"[1]]", 3}, {"{} x", 3}}) {
+      SCOPED_TRACE(json);
+      const auto simd = parser.parse_simd_impl(json);
+      EXPECT_EQ(simd.get_error_code(),
+                simdjson::error_code::UNEXPECTED_CHARACTER);
+      EXPECT_EQ(simd.get_error_offset(), offset);
+      const auto normal = parser.parse_normal_impl(json);
+      EXPECT_EQ(normal.get_error_code(),
+                simdjson::error_code::UNEXPECTED_CHARACTER);
+      EXPECT_EQ(normal.get_error_offset(), offset);
+      const auto& doc = parser.parse_document(json);
+      EXPECT_EQ(doc.get_error_code(),
+                simdjson::error_code::UNEXPECTED_CHARACTER);
+      EXPECT_EQ(doc.get_error_offset(), offset);
+      const auto node = parser.try_parse_node(json);
+      ASSERT_FALSE(node.has_value());
+      EXPECT_EQ(node.error().code, simdjson::error_code::UNEXPECTED_CHARACTER);
+      EXPECT_EQ(node.error().offset, offset);
+    }
+    EXPECT_FALSE(parser.parse_document(" [1] \n").is_error());
+    EXPECT_TRUE(parser.parse_simd_impl(" [1] \n").is_array());
+    EXPECT_TRUE(parser.parse_normal_impl(" [1] \n").is_array());
+  });
+}
+
+TEST(simdjson, max_depth) {
+  const auto nested = [](size_t depth) {
+    std::string json;
+    for (size_t i = 0; i < depth; i++) {
+      json += i % 2 == 0 ? "[" : "{\"k\":";
+    }
+    json += "1";
+    for (size_t i = depth; i > 0; i--) {
+      json += (i - 1) % 2 == 0 ? "]" : "}";
+    }
+    return json;
+  };
+  simdjson::JsonParser parser;
+  // no recursion, a hostile document is only an error
+  const std::string hostile(1000000, '[');
+  EXPECT_FALSE(parser.parse_normal_impl(hostile).is_array());
+  EXPECT_FALSE(parser.parse_simd_impl(hostile).is_array());
+
+  const std::string deep = nested(simdjson::kDefaultMaxDepth);
+  for (auto tree : {parser.parse_normal_impl(deep),
+                    parser.parse_simd_impl(deep)}) {
+    ASSERT_TRUE(tree.is_array());
+    EXPECT_EQ(tree.dump(), deep);
+  }
+  const std::string too_deep = nested(simdjson::kDefaultMaxDepth + 1);
+  EXPECT_FALSE(parser.parse_normal_impl(too_deep).is_array());
+  EXPECT_FALSE(parser.parse_simd_impl(too_deep).is_array());
+  // a raised depth reaches the stream too
+  const simdjson::PaddedString padded_too_deep(too_deep);
+  parser.set_max_depth(simdjson::kDefaultMaxDepth + 1);
+  for (const auto& streamed : parser.parse_many(padded_too_deep)) {
+    EXPECT_FALSE(streamed.is_error()) << streamed.get_error();
+  }
+
+  parser.set_max_depth(3);
+  EXPECT_TRUE(parser.parse_normal_impl(nested(3)).is_array());
+  EXPECT_TRUE(parser.parse_simd_impl(nested(3)).is_array());
+  EXPECT_FALSE(parser.parse_normal_impl(nested(4)).is_array());
+  EXPECT_FALSE(parser.parse_simd_impl(nested(4)).is_array());
+  simdjson::JsonParseError error;
+  parser.parse_node(nested(3), error);
+  EXPECT_TRUE(error.empty()) << error;
+  parser.parse_node(nested(4), error);
+  EXPECT_EQ(error, "Exceeded max depth at byte 7");
+  EXPECT_FALSE(parser.parse_document(nested(3)).is_error());
+  const auto& doc = parser.parse_document(nested(4));
+  ASSERT_TRUE(doc.is_error());
+  EXPECT_EQ(doc.get_error(), "Exceeded max depth at byte 7");
+  // the stream is bound by the same depth
+  const simdjson::PaddedString lines(nested(3) + "\n" + nested(4));
+  std::vector<std::string> errors;
+  for (const auto& streamed : parser.parse_many(lines)) {
+    errors.push_back(streamed.get_error());
+  }
+  EXPECT_EQ(errors, (std::vector<std::string>{
+                        "", "Exceeded max depth at byte " +
+                                std::to_string(nested(3).size() + 1 + 7)}));
+  // scalars and flat containers are not nested
+  parser.set_max_depth(0);
+  EXPECT_EQ(parser.parse_normal_impl("12").get_value<int64_t>(), 12);
+  EXPECT_FALSE(parser.parse_normal_impl("[]").is_array());
+
+  // the stack is reused, a failure leaves nothing behind
+  parser.set_max_depth(simdjson::kDefaultMaxDepth);
+  for (const char* bad : {"[1, {\"a\": [2,", "[1 2]", "{\"a\": 1,}", "[1,]"}) {
+    EXPECT_FALSE(parser.parse_normal_impl(bad).is_array()) << bad;
+    EXPECT_FALSE(parser.parse_normal_impl(bad).is_object()) << bad;
+  }
+  EXPECT_EQ(parser.parse_normal_impl("[1, {\"a\": [2, 3], \"a\": 4}]").dump(),
+            "[1,{\"a\":4}]");
+}
+
+TEST(simdjson, error_codes) {
+  using simdjson::error_code;
+  simdjson::JsonParser parser;
+  for (auto tree : {parser.parse_normal_impl("{\"a\" 1}"),
+                    parser.parse_simd_impl("{\"a\" 1}")}) {
+    ASSERT_TRUE(tree.is_error());
+    EXPECT_FALSE(tree.is_string());
+    EXPECT_EQ(tree.get_error_code(), error_code::EXPECTED_COLON);
+    EXPECT_EQ(tree.get_error_offset(), 5);
+    EXPECT_EQ(tree.get_error(), "Expected ':' in object at byte 5");
+    // copies keep the error
+    const simdjson::Json copy = tree;
+    EXPECT_TRUE(copy.is_error());
+  }
+  EXPECT_FALSE(parser.parse("[1, 2]").is_error());
+  EXPECT_EQ(parser.parse("[1, 2]").get_error(), "");
+
+  auto parsed = parser.try_parse("{\"a\": [1, true]}");
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_TRUE((*parsed)["a"][1].get_value<bool>());
+  for (const auto& [input, code, offset] :
+       std::vector<std::tuple<std::string, error_code, size_t>>{
+           {"", error_code::EMPTY, 0},
+           {"[1, 2", error_code::EXPECTED_ARRAY_END, 5},
+           {"[1, 2}", error_code::EXPECTED_ARRAY_END, 5},
+           {"{\"a\": 1 \"b\"}", error_code::UNEXPECTED_IN_OBJECT, 8},
+           {"{1: 2}", error_code::EXPECTED_KEY, 1},
+           {"[tru]", error_code::INVALID_BOOL, 1},
+           {"[-]", error_code::INVALID_NUMBER, 1},
+           {"[\"a\\q\"]", error_code::INVALID_ESCAPE, 1},
+           {"[\"abc", error_code::UNCLOSED_STRING, 1},
+           {"[\"a\x01\"]", error_code::CONTROL_CHARACTER, 3},
+           {"[\"\xff\"]", error_code::INVALID_UTF8, 2}}) {
+    SCOPED_TRACE(input);
+    const auto failed = parser.try_parse(input);
+    ASSERT_FALSE(failed.has_value());
+    EXPECT_EQ(failed.error().code, code);
+    EXPECT_EQ(failed.error().offset, offset);
+    const auto node = parser.try_parse_node(input);
+    ASSERT_FALSE(node.has_value());
+    EXPECT_EQ(node.error().code, code);
+    EXPECT_EQ(node.error().offset, offset);
+    const auto& doc = parser.parse_document(input);
+    ASSERT_TRUE(doc.is_error());
+    EXPECT_EQ(doc.get_error_code(), code);
+    EXPECT_EQ(doc.get_error_offset(), offset);
+  }
+
+  // a number out of range is reported at its first byte by every mode
+  for (const auto& [json, offset] :
+       {std::pair{"1.5e999", 0}, {"[0, -1e400]", 4}}) {
+    SCOPED_TRACE(json);
+    const auto normal = parser.parse_normal_impl(json);
+    const auto simd = parser.parse_simd_impl(json);
+    EXPECT_EQ(normal.get_error_code(), error_code::NUMBER_OUT_OF_RANGE);
+    EXPECT_EQ(simd.get_error_code(), error_code::NUMBER_OUT_OF_RANGE);
+    EXPECT_EQ(normal.get_error_offset(), offset);
+    EXPECT_EQ(simd.get_error_offset(), offset);
+    EXPECT_EQ(parser.parse_document(json).get_error_offset(), offset);
+  }
+
+  // lazy errors point at the token that was read
+  const simdjson::PaddedString lazy("[1, 2 3]");
+  auto& ondemand = parser.iterate(lazy);
+  const auto array = ondemand.root().get_value<simdjson::OnDemandArray>();
+  ASSERT_TRUE(array.has_value());
+  for (const auto value : *array) {
+    (void)value;
+  }
+  EXPECT_EQ(ondemand.get_error_code(), error_code::EXPECTED_ARRAY_END);
+  EXPECT_EQ(ondemand.get_error_offset(), 6);
+
+  // stream offsets count from the start of the input
+  const simdjson::PaddedString stream("[1]\n[2]\n[3,]\n");
+  for (const auto& doc : parser.parse_many(stream, 4)) {
+    if (doc.is_error()) {
+      EXPECT_EQ(doc.get_error_code(), error_code::INVALID_NUMBER);
+      EXPECT_EQ(doc.get_error_offset(), 11);
+    }
+  }
+}
+
+TEST(simdjson, string_escapes) {
+  // escapes around and across the 64 bytes blocks of the string kernel
+  std::vector<std::pair<std::string, std::string>> cases = {
+      {"", ""},
+      {"plain", "plain"},
+      {"a\\\"b\\/\\b\\f\\n\\r\\t", "a\"b/\b\f\n\r\t"},
+      {"\\u0041\\u00e9\\u20AC\\ud83d\\ude00", "A\u00e9\u20ac\U0001f600"},
+      {"http:\\/\\/example.com\\/a\\/b?q=\\\"x\\\"",
+       "http://example.com/a/b?q=\"x\""},
+  };
+  for (size_t pad = 55; pad < 75; pad++) {
+    cases.emplace_back(std::string(pad, 'x') + "\\u00e9\\\\" +
+                           std::string(pad, 'y') + "\\\"",
+                       std::string(pad, 'x') + "\u00e9\\" +
+                           std::string(pad, 'y') + "\"");
+  }
+  for_each_kernel([&] {
+    simdjson::JsonParser parser;
+    for (const auto& [raw, decoded] : cases) {
+      const std::string json = "{\"" + raw + "\": [\"" + raw + "\"]}";
+      for (auto tree : {parser.parse(json), parser.parse_normal_impl(json),
+                        parser.parse_simd_impl(json)}) {
+        ASSERT_TRUE(tree.is_object()) << raw;
+        const auto& obj = tree.get_value<simdjson::JsonObject>();
+        ASSERT_EQ(obj.count(simdjson::JsonString(decoded)), 1) << raw;
+        EXPECT_EQ(tree[decoded][0].get_value<std::string>(), decoded);
+      }
+      simdjson::PaddedString padded(json);
+      const auto& doc = parser.parse_document(padded);
+      ASSERT_FALSE(doc.is_error()) << raw;
+      EXPECT_EQ(doc.root()[decoded][0].get_value<std::string_view>(),
+                decoded);
+      auto& lazy = parser.iterate(padded);
+      EXPECT_EQ(lazy.root()[decoded].get_value<simdjson::OnDemandArray>()
+                    ->at(0)
+                    .get_value<std::string_view>(),
+                decoded);
+    }
+    // invalid escapes, lone surrogates and raw control characters
+    for (std::string bad : {"\"\\x\"", "\"\\u12G4\"", "\"\\ud83d\"",
+                            "\"\\ude00\"", "\"a\nb\"", "\"abc"}) {
+      bad = "[" + bad + "]";
+      EXPECT_FALSE(parser.parse_normal_impl(bad).is_array()) << bad;
+      EXPECT_FALSE(parser.parse_simd_impl(bad).is_array()) << bad;
+      EXPECT_TRUE(parser.parse_document(bad).is_error()) << bad;
+    }
+  });
+}
+
+TEST(simdjson, utf8_validation) {
+  // {input, offset of the first invalid sequence or npos}
+  const std::vector<std::pair<std::string, size_t>> cases = {
+      {"plain ascii", std::string::npos},
+      {"\xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", std::string::npos},
+      {"\xED\x9F\xBF \xEE\x80\x80 \xF4\x8F\xBF\xBF", std::string::npos},
+      {"a\x80", 1},             // lone continuation
+      {"ab\xC3", 2},            // cut short at the end
+      {"\xC3(", 0},             // cut short by ascii
+      {"\xC0\xAF", 0},          // overlong 2 bytes
+      {"x\xE0\x80\xAF", 1},     // overlong 3 bytes
+      {"\xF0\x80\x80\xAF", 0},  // overlong 4 bytes
+      {"xy\xED\xA0\x80", 2},    // surrogate
+      {"\xF4\x90\x80\x80", 0},  // above U+10FFFF
+      {"\xF5\x80\x80\x80", 0},
+      {"\xFF", 0},
+      {"\xE2\x82\xAC\x80", 3},  // one continuation too many
+  };
+  for_each_kernel([&] {
+    for (const auto& [text, expected] : cases) {
+      // at every position around the 16, 32 and 64 bytes boundaries
+      for (size_t pad = 0; pad < 70; pad++) {
+        const std::string input = std::string(pad, ' ') + text;
+        size_t offset = 0;
+        const bool valid = simdjson::validate_utf8(input, offset);
+        EXPECT_EQ(valid, expected == std::string::npos) << pad << text;
+        if (!valid) {
+          EXPECT_EQ(offset, pad + expected) << pad << text;
+        }
+      }
+    }
+    // every kernel agrees with the fallback automaton on random input
+    std::mt19937 rng(7);
+    // four valid sequences, then four invalid ones
+    const std::string pieces[] = {"a", "\xC3\xA9", "\xE2\x82\xAC",
+                                  "\xF0\x9F\x98\x80", "\x80", "\xC3",
+                                  "\xED\xA0\x80", "\xF4\x90\x80\x80"};
+    for (int round = 0; round < 2000; round++) {
+      std::string input;
+      const size_t count = rng() % 80;
+      for (size_t i = 0; i < count; i++) {
+        // mostly valid sequences, so the errors land anywhere
+        input += pieces[rng() % 100 < 97 ? rng() % 4 : 4 + rng() % 4];
+      }
+      const auto& active = simdjson::active_kernel();
+      ASSERT_TRUE(simdjson::force_kernel("fallback"));
+      const bool expected = simdjson::validate_utf8(input);
+      ASSERT_TRUE(simdjson::force_kernel(active.name));
+      EXPECT_EQ(simdjson::validate_utf8(input), expected) << round;
+    }
+    // the parsers reject invalid utf-8 in their first pass
+    simdjson::JsonParser parser;
+    const std::string bad = "{\"key\": \"caf\xC3\"}";
+    const auto& doc = parser.parse_document(bad);
+    ASSERT_TRUE(doc.is_error());
+    EXPECT_EQ(doc.get_error(), "Invalid UTF-8 at byte 12");
+    EXPECT_FALSE(parser.parse(bad).is_object());
+    EXPECT_FALSE(parser.parse_normal_impl(bad).is_object());
+    simdjson::PaddedString padded(bad);
+    EXPECT_TRUE(parser.iterate(padded).is_error());
+    EXPECT_TRUE(parser.parse("[\"\xC3\xA9t\xC3\xA9\"]").is_array());
+  });
+}
+
+// drop the whitespace outside of strings one byte at a time
+static std::string reference_minify(std::string_view json) {
+  std::string out;
+  bool in_string = false;
+  bool escaped = false;
+  for (char c : json) {
+    if (in_string) {
+      in_string = escaped || c != '"';
+      escaped = !escaped && c == '\\';
+    } else if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      continue;
+    } else {
+      in_string = c == '"';
+    }
+    out += c;
+  }
+  return out;
+}
+
+TEST(simdjson, minify) {
+  std::ifstream ifs(std::string(__FILE_PATH__) +
+                    "/local_large_json/simple_array.json");
+  ASSERT_TRUE(ifs.is_open());
+  const std::string pretty((std::istreambuf_iterator<char>(ifs)),
+                           std::istreambuf_iterator<char>());
+  std::vector<std::string> inputs = {"", "   ", " [ 1 , 2 ]\n", pretty,
+                                     "[\"unclosed  string"};
+  // strings with whitespace, escaped quotes and backslash runs around the
+  // block boundaries, between runs of indentation
+  for (size_t pad = 50; pad < 140; pad += 3) {
+    inputs.push_back("{\n" + std::string(pad, ' ') + "\"a b\\\\\\\" c\" :\t[ " +
+                     std::string(pad % 7, '\\') + std::string(pad % 7, '\\') +
+                     " \"\\\"  \" ,\r\n" + std::string(pad, '\t') + "1 ] }");
+  }
+  for_each_kernel([&] {
+    for (const auto& input : inputs) {
+      const std::string expected = reference_minify(input);
+      EXPECT_EQ(simdjson::minify(input), expected);
+      // in place
+      std::string buffer = input;
+      buffer.resize(simdjson::minify(buffer, buffer.data()));
+      EXPECT_EQ(buffer, expected);
+    }
+    // the normal implement jumps over the indentation with the kernel
+    simdjson::JsonParser parser;
+    auto normal = parser.parse_normal_impl(pretty);
+    auto compact = parser.parse_normal_impl(simdjson::minify(pretty));
+    ASSERT_TRUE(normal.is_array());
+    expect_same_json(normal, compact);
+    for (size_t pad = 0; pad < 140; pad += 7) {
+      const std::string ws(pad, ' ');
+      const std::string json = ws + "{" + ws + "\"k\"" + ws + ":" + ws + "[" +
+                               ws + "1" + ws + "," + ws + "\"v\"" + ws + "]" +
+                               ws + "}" + ws;
+      auto tree = parser.parse_normal_impl(json);
+      ASSERT_TRUE(tree.is_object()) << pad;
+      EXPECT_EQ(tree["k"][1].get_value<std::string>(), "v");
+    }
+  });
+}
+
+// a json string escaped one byte at a time
+static std::string reference_escape(std::string_view str) {
+  std::string out = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escape[7];
+      std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+      out += escape;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+TEST(simdjson, dump) {
+  using simdjson::Json;
+  using simdjson::JsonValue;
+  simdjson::JsonParser parser;
+  EXPECT_EQ(parser.parse("null").dump(), "null");
+  // an error is not dumped as a value
+  const auto failed = parser.parse("[1,");
+  ASSERT_TRUE(failed.is_error());
+  EXPECT_EQ(failed.dump(), failed.get_error());
+  EXPECT_EQ(parser.parse(" [ true , false , [ ] , { } ] ").dump(),
+            "[true,false,[],{}]");
+  EXPECT_EQ(parser.parse("[0, 7, -12, 18446744073709551615, "
+                         "-9223372036854775808, 1.5, 2.0, -0.0, 1e300, "
+                         "0.1, 123456.789e-3]")
+                .dump(),
+            "[0,7,-12,18446744073709551615,-9223372036854775808,1.5,2.0,"
+            "-0.0,1e+300,0.1,123.456789]");
+  EXPECT_EQ(Json(JsonValue(std::numeric_limits<double>::quiet_NaN())).dump(),
+            "null");
+  // every digit count
+  for (uint64_t power = 1; power <= 1000000000000000000ull; power *= 10) {
+    for (uint64_t value : {power - 1, power, power + 1, 9 * power}) {
+      EXPECT_EQ(Json(JsonValue(value)).dump(), std::to_string(value));
+      const auto negative = -static_cast<int64_t>(value);
+      EXPECT_EQ(Json(JsonValue(negative)).dump(), std::to_string(negative));
+    }
+  }
+  EXPECT_EQ(parser.parse("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0001\\u00e9\"").dump(),
+            "\"\\\"\\\\/\\b\\f\\n\\r\\t\\u0001\xC3\xA9\"");
+
+  auto tree = parser.parse("{\"a\": [1, [], {\"b\": null}]}");
+  EXPECT_EQ(tree.dump(2),
+            "{\n  \"a\": [\n    1,\n    [],\n    {\n      \"b\": null\n    }\n"
+            "  ]\n}");
+  EXPECT_EQ(tree.dump(0), "{\n\"a\": [\n1,\n[],\n{\n\"b\": null\n}\n]\n}");
+
+  // dump_to appends, and the span overload only writes what fits
+  std::string out = "x";
+  tree.dump_to(out);
+  EXPECT_EQ(out, "x{\"a\":[1,[],{\"b\":null}]}");
+  const std::string compact = tree.dump();
+  std::vector<char> buffer(compact.size());
+  EXPECT_EQ(tree.dump_to(std::span<char>(buffer)), compact.size());
+  EXPECT_EQ(std::string(buffer.begin(), buffer.end()), compact);
+  EXPECT_EQ(tree.dump_to(std::span<char>(buffer).first(compact.size() - 1)),
+            compact.size());
+
+  // escapes around the block boundaries, in full and in tight spans
+  for_each_kernel([] {
+    for (size_t len = 0; len < 300; len += 7) {
+      std::string str(len, 'a');
+      for (size_t i = len % 5; i < len; i += 11 + len % 13) {
+        str[i] = "\"\\\n\x01\x1f\xC3"[i % 6];
+      }
+      const Json value{JsonValue(simdjson::JsonString(str))};
+      const std::string expected = reference_escape(str);
+      EXPECT_EQ(value.dump(), expected);
+      std::vector<char> exact(expected.size());
+      EXPECT_EQ(value.dump_to(std::span<char>(exact)), expected.size());
+      EXPECT_EQ(std::string(exact.begin(), exact.end()), expected);
+    }
+  });
+
+  std::ifstream ifs(std::string(__FILE_PATH__) +
+                    "/local_large_json/simple_array.json");
+  ASSERT_TRUE(ifs.is_open());
+  const std::string content((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+  auto original = parser.parse(content);
+  ASSERT_TRUE(original.is_array());
+  for (int indent : {-1, 0, 4}) {
+    auto again = parser.parse(original.dump(indent));
+    expect_same_json(original, again);
+  }
+}
+
+TEST(simdjson, compact_node) {
+  using simdjson::JsonNode;
+  static_assert(sizeof(JsonNode) == 16);
+  JsonNode object = JsonNode::object();
+  object["b"] = 1;
+  object["a"] = "a string longer than eight bytes";
+  object["c"] = JsonNode::array();
+  object["c"].append(2.5);
+  object["c"].append(uint64_t(18446744073709551615ull));
+  object["c"].append(nullptr);
+  object["short"] = "inline";
+  object.insert_or_assign("b", true);
+  EXPECT_EQ(object.size(), 4);
+  EXPECT_EQ(object.dump(),
+            "{\"b\":true,\"a\":\"a string longer than eight bytes\","
+            "\"c\":[2.5,18446744073709551615,null],\"short\":\"inline\"}");
+  EXPECT_EQ(object.find("missing"), nullptr);
+  EXPECT_EQ(object.find("short")->get_value<std::string_view>(), "inline");
+  EXPECT_TRUE(object["c"][1].is_uint64());
+  EXPECT_TRUE(JsonNode(-1).is_int64());
+  EXPECT_TRUE(JsonNode(uint64_t(7)).is_int64());
+
+  // copies are deep, moves leave null behind
+  JsonNode copy = object;
+  EXPECT_TRUE(copy.remove("a"));
+  EXPECT_FALSE(copy.remove("a"));
+  EXPECT_TRUE(copy["c"].remove(0));
+  EXPECT_FALSE(copy["c"].remove(5));
+  EXPECT_EQ(copy.dump(),
+            "{\"b\":true,\"c\":[18446744073709551615,null],"
+            "\"short\":\"inline\"}");
+  EXPECT_EQ(object.size(), 4);
+  JsonNode moved = std::move(copy);
+  EXPECT_TRUE(copy.is_null());
+  // assigning a child of the node to the node itself
+  moved = moved["c"];
+  EXPECT_EQ(moved.dump(), "[18446744073709551615,null]");
+  moved = std::move(moved[1]);
+  EXPECT_TRUE(moved.is_null());
+
+  // large objects switch to the hash index and keep their order
+  JsonNode wide = JsonNode::object();
+  for (int i = 0; i < 100; i++) {
+    wide["key" + std::to_string(i)] = i;
+  }
+  for (int i = 0; i < 100; i += 2) {
+    EXPECT_TRUE(wide.remove("key" + std::to_string(i)));
+  }
+  ASSERT_EQ(wide.size(), 50);
+  for (int i = 0; i < 100; i++) {
+    const JsonNode* value = wide.find("key" + std::to_string(i));
+    ASSERT_EQ(value != nullptr, i % 2 == 1);
+    if (value != nullptr) {
+      EXPECT_EQ(value->get_value<int64_t>(), i);
+    }
+  }
+  EXPECT_EQ(wide.members()[0].key(), "key1");
+  EXPECT_EQ(wide.members()[49].key(), "key99");
+
+  for_each_kernel([] {
+    simdjson::JsonParser parser;
+    simdjson::JsonParseError error;
+    const std::string json =
+        "{\"z\": [1, -2, 3.5, true, false, null, \"s\\n\", {}], \"a\": {\"k\": "
+        "\"v\", \"k\": \"last\"}, \"m\": []}";
+    auto node = parser.parse_node(json, error);
+    ASSERT_TRUE(error.empty()) << error;
+    // the order of the input, duplicate keys keep the last value
+    EXPECT_EQ(node.dump(),
+              "{\"z\":[1,-2,3.5,true,false,null,\"s\\n\",{}],\"a\":{\"k\":"
+              "\"last\"},\"m\":[]}");
+    EXPECT_EQ(node["z"][6].get_value<std::string_view>(), "s\n");
+
+    node = parser.parse_node("[1, {]", error);
+    EXPECT_FALSE(error.empty());
+    EXPECT_TRUE(node.is_null());
+    parser.parse_node("[\"\\x\"]", error);
+    EXPECT_FALSE(error.empty());
+
+    std::ifstream ifs(std::string(__FILE_PATH__) +
+                      "/local_large_json/simple_array.json");
+    ASSERT_TRUE(ifs.is_open());
+    const std::string content((std::istreambuf_iterator<char>(ifs)),
+                              std::istreambuf_iterator<char>());
+    auto tree = parser.parse_node(content, error);
+    ASSERT_TRUE(error.empty());
+    auto expected = parser.parse(content);
+    auto again = parser.parse(tree.dump());
+    expect_same_json(expected, again);
+  });
+}
+
+TEST(simdjson, node_shapes) {
+  using simdjson::JsonNode;
+  for_each_kernel([] {
+    simdjson::JsonParseError error;
+    std::vector<JsonNode> records;
+    {
+      simdjson::JsonParser parser;
+      for (int i = 0; i < 3; i++) {
+        const std::string json = "{\"identifier\": " + std::to_string(i) +
+                                 ", \"a\": {\"description\": \"x\"}}";
+        records.push_back(parser.parse_node(json, error));
+        ASSERT_TRUE(error.empty()) << error;
+      }
+      // another key order is another shape, escaped keys are decoded first
+      records.push_back(parser.parse_node(
+          "{\"a\": null, \"identif\\u0069er\": 3}", error));
+      ASSERT_TRUE(error.empty()) << error;
+    }
+    // the shapes outlive the parser
+    const simdjson::JsonShape* shape = records[0].shape();
+    ASSERT_NE(shape, nullptr);
+    EXPECT_EQ(records[1].shape(), shape);
+    EXPECT_EQ(records[2].shape(), shape);
+    EXPECT_EQ(records[1]["a"].shape(), records[0]["a"].shape());
+    EXPECT_NE(records[3].shape(), shape);
+    ASSERT_EQ(shape->size(), 2);
+    EXPECT_EQ(shape->key(0), "identifier");
+    const size_t id = shape->find("identifier");
+    EXPECT_EQ(shape->find("missing"), shape->size());
+    for (int i = 0; i < 3; i++) {
+      EXPECT_EQ(records[i].members()[id].value().get_value<int64_t>(), i);
+    }
+    EXPECT_EQ(records[3].find("identifier")->get_value<int64_t>(), 3);
+    EXPECT_EQ(records[2].dump(),
+              "{\"identifier\":2,\"a\":{\"description\":\"x\"}}");
+
+    // copies share the shape, inserting and removing leave it
+    JsonNode copy = records[0];
+    EXPECT_EQ(copy.shape(), shape);
+    copy["another long key"] = 1;
+    EXPECT_EQ(copy.shape(), nullptr);
+    EXPECT_EQ(copy.find("identifier")->get_value<int64_t>(), 0);
+    EXPECT_EQ(copy.find("another long key")->get_value<int64_t>(), 1);
+    EXPECT_TRUE(copy.remove("identifier"));
+    EXPECT_EQ(copy.find("identifier"), nullptr);
+    EXPECT_EQ(copy.dump(),
+              "{\"a\":{\"description\":\"x\"},\"another long key\":1}");
+    records.clear();
+    EXPECT_EQ(copy["a"].find("description")->get_value<std::string_view>(),
+              "x");
+
+    // duplicate keys and objects wider than the shapes go by hand
+    simdjson::JsonParser parser;
+    auto node = parser.parse_node(
+        "{\"duplicate key\": 1, \"b\": 2, \"duplicate key\": 3}", error);
+    ASSERT_TRUE(error.empty()) << error;
+    EXPECT_EQ(node.dump(), "{\"duplicate key\":3,\"b\":2}");
+    // the last value replaced the first, the keys are still the shape
+    ASSERT_NE(node.shape(), nullptr);
+    EXPECT_EQ(node.shape()->size(), 2);
+    std::string wide = "{";
+    for (int i = 0; i < 100; i++) {
+      wide += (i == 0 ? "\"key" : ", \"key") + std::to_string(i) + "\": " +
+              std::to_string(i);
+    }
+    wide += "}";
+    for (int round = 0; round < 2; round++) {
+      node = parser.parse_node(wide, error);
+      ASSERT_TRUE(error.empty()) << error;
+      ASSERT_EQ(node.size(), 100);
+      for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(node.find("key" + std::to_string(i))->get_value<int64_t>(),
+                  i);
+      }
+      EXPECT_TRUE(node.remove("key10"));
+      EXPECT_EQ(node.find("key10"), nullptr);
+      EXPECT_EQ(node.find("key99")->get_value<int64_t>(), 99);
+    }
+  });
+}
+
+TEST(simdjson, document_navigation) {
+  simdjson::JsonParser parser;
+  const auto& doc = parser.parse_document(
+      "{\"key\": \"value\", \"key2\": 123, \"key3\": true, \"key4\": null, "
+      "\"key5\": {\"key6\": [1.5, false, \"x\", {}, []]}, \"key7\": -8}");
+  ASSERT_FALSE(doc.is_error());
+  auto root = doc.root();
+  EXPECT_TRUE(root.is_object());
+  EXPECT_EQ(root.get_value<simdjson::JsonObjectView>().size(), 6);
+  EXPECT_EQ(root["key"].get_value<std::string_view>(), "value");
+  EXPECT_EQ(root["key2"].get_value<int64_t>(), 123);
+  EXPECT_EQ(root["key3"].get_value<bool>(), true);
+  EXPECT_TRUE(root["key4"].is_null());
+  // key7 is found by jumping over the whole key5 subtree
+  EXPECT_EQ(root["key7"].get_value<int64_t>(), -8);
+  EXPECT_FALSE(
+      root.get_value<simdjson::JsonObjectView>().contains("missing"));
+
+  auto array = root["key5"]["key6"].get_value<simdjson::JsonArrayView>();
+  EXPECT_EQ(array.size(), 5);
+  EXPECT_EQ(array.at(0).get_value<double>(), 1.5);
+  EXPECT_EQ(array.at(1).get_value<bool>(), false);
+  EXPECT_EQ(array.at(2).get_value<std::string_view>(), "x");
+  EXPECT_EQ(array.at(3).get_value<simdjson::JsonObjectView>().size(), 0);
+  EXPECT_EQ(array.at(4).get_value<simdjson::JsonArrayView>().size(), 0);
+
+  std::vector<std::string_view> keys;
+  for (auto field : root.get_value<simdjson::JsonObjectView>()) {
+    keys.push_back(field.key);
+  }
+  EXPECT_EQ(keys, (std::vector<std::string_view>{"key", "key2", "key3",
+                                                 "key4", "key5", "key7"}));
+}
+
+TEST(simdjson, document_reuse) {
+  simdjson::JsonParser parser;
+  std::ifstream ifs(std::string(__FILE_PATH__) +
+                    "/local_large_json/simple_array.json");
+  ASSERT_TRUE(ifs.is_open());
+  std::string content((std::istreambuf_iterator<char>(ifs)),
+                      std::istreambuf_iterator<char>());
+  for (int round = 0; round < 2; round++) {
+    const auto& doc = parser.parse_document(content);
+    ASSERT_FALSE(doc.is_error());
+    auto array = doc.root().get_value<simdjson::JsonArrayView>();
+    EXPECT_EQ(array.size(), 10);
+    int64_t id = 1;
+    for (auto element : array) {
+      EXPECT_EQ(element["id"].get_value<int64_t>(), id++);
+      EXPECT_TRUE(element["city"].is_string());
+    }
+    EXPECT_EQ(array.at(0)["city"].get_value<std::string_view>(), "beijing");
+
+    const auto& scalar = parser.parse_document("\"scalar\"");
+    EXPECT_EQ(scalar.root().get_value<std::string_view>(), "scalar");
+  }
+  EXPECT_TRUE(parser.parse_document("[1, 2").is_error());
+  EXPECT_TRUE(parser.parse_document("{\"a\" 1}").is_error());
+  EXPECT_TRUE(parser.parse_document("").is_error());
+}
+
+TEST(simdjson, document_zero_copy) {
+  const simdjson::PaddedString json(
+      "{\"title\": \"plain\", \"esc\\\"key\": \"a\\n\\u00e9\\ud83d\\ude00\", "
+      "\"list\": [\"x\", 1]}");
+  simdjson::JsonParser parser;
+  const auto& doc = parser.parse_document(json);
+  ASSERT_FALSE(doc.is_error());
+  auto root = doc.root();
+  // strings without escapes point into the padded input
+  auto title = root["title"].get_value<std::string_view>();
+  EXPECT_EQ(title, "plain");
+  EXPECT_GE(title.data(), json.data());
+  EXPECT_LT(title.data(), json.data() + json.size());
+  EXPECT_EQ(root["list"][0].get_value<std::string_view>(), "x");
+  EXPECT_EQ(root["list"][1].get_value<int64_t>(), 1);
+  // escaped keys and values are decoded into the document
+  EXPECT_EQ(root["esc\"key"].get_value<std::string_view>(),
+            "a\n\xc3\xa9\xf0\x9f\x98\x80");
+
+  // the copying mode decodes the same way
+  const auto& copied = parser.parse_document(std::string(json.view()));
+  EXPECT_EQ(copied.root()["esc\"key"].get_value<std::string_view>(),
+            "a\n\xc3\xa9\xf0\x9f\x98\x80");
+  EXPECT_NE(copied.root()["title"].get_value<std::string_view>().data(),
+            title.data());
+
+  EXPECT_TRUE(
+      parser.parse_document(simdjson::PaddedString("[\"\\x\"]")).is_error());
+  EXPECT_TRUE(
+      parser.parse_document(simdjson::PaddedString("[\"\\ud83d\"]"))
+          .is_error());
+}
+
+TEST(simdjson, ondemand_iterate) {
+  const simdjson::PaddedString json(
+      "{\"skip\": {\"deep\": [[1, 2], {\"x\": \"\\u0041\"}]}, \"id\": 42, "
+      "\"name\": \"a\\tb\", \"ok\": true, \"none\": null, \"pi\": 3.5, "
+      "\"list\": [\"x\", {\"y\": 1}, [], 7]}");
+  for_each_kernel([&] {
+    simdjson::JsonParser parser;
+    auto& doc = parser.iterate(json);
+    ASSERT_FALSE(doc.is_error());
+    auto root = doc.root().get_value<simdjson::OnDemandObject>();
+    ASSERT_TRUE(root.has_value());
+    // forward-only lookups jump over the unread "skip" subtree
+    EXPECT_EQ(root->find_field("id").get_value<int64_t>(), 42);
+    EXPECT_EQ(root->find_field("name").get_value<std::string_view>(), "a\tb");
+    EXPECT_EQ(root->find_field("pi").get_value<double>(), 3.5);
+    EXPECT_FALSE(root->find_field("ok").exists());
+    // the unordered lookup wraps around
+    EXPECT_EQ((*root)["ok"].get_value<bool>(), true);
+    EXPECT_TRUE((*root)["none"].is_null());
+    EXPECT_FALSE((*root)["id"].get_value<bool>().has_value());
+    EXPECT_FALSE((*root)["missing"].exists());
+    EXPECT_EQ(doc.root()["skip"]["deep"][1]["x"].get_value<std::string_view>(),
+              "A");
+    EXPECT_FALSE(doc.root()["id"].get_value<std::string_view>().has_value());
+
+    auto list = doc.root()["list"].get_value<simdjson::OnDemandArray>();
+    ASSERT_TRUE(list.has_value());
+    size_t count = 0;
+    for (auto value : *list) {
+      EXPECT_TRUE(value.exists());
+      ++count;
+    }
+    EXPECT_EQ(count, 4);
+    EXPECT_EQ(list->at(3).get_value<int64_t>(), 7);
+    EXPECT_FALSE(list->at(4).exists());
+    // integers widen to double and non-negative ones read as uint64_t
+    EXPECT_EQ((*root)["id"].get_value<double>(), 42.0);
+    EXPECT_EQ((*root)["id"].get_value<uint64_t>(), 42u);
+    EXPECT_EQ(list->at(3).get_value<uint64_t>(), 7u);
+    EXPECT_FALSE((*root)["pi"].get_value<uint64_t>().has_value());
+    EXPECT_FALSE((*root)["pi"].get_value<int64_t>().has_value());
+
+    std::vector<std::string_view> keys;
+    for (auto field : *root) {
+      keys.push_back(field.key);
+    }
+    EXPECT_EQ(keys, (std::vector<std::string_view>{
+                        "skip", "id", "name", "ok", "none", "pi", "list"}));
+    EXPECT_FALSE(doc.is_error());
+
+    const simdjson::PaddedString numbers("[-4, 18446744073709551615]");
+    auto& signs = parser.iterate(numbers);
+    EXPECT_FALSE(signs.root()[0].get_value<uint64_t>().has_value());
+    EXPECT_EQ(signs.root()[0].get_value<double>(), -4.0);
+    EXPECT_EQ(signs.root()[1].get_value<uint64_t>(), UINT64_MAX);
+    EXPECT_EQ(signs.root()[1].get_value<double>(), 18446744073709551615.0);
+    EXPECT_FALSE(signs.root()[1].get_value<int64_t>().has_value());
+
+    EXPECT_TRUE(parser.iterate(simdjson::PaddedString("[1, {]")).is_error());
+    EXPECT_TRUE(parser.iterate(simdjson::PaddedString("{\"a\": [")).is_error());
+    EXPECT_TRUE(parser.iterate(simdjson::PaddedString("")).is_error());
+    // grammar errors are found when the broken part is read
+    const simdjson::PaddedString malformed("{\"a\" 1}");
+    auto& broken = parser.iterate(malformed);
+    EXPECT_FALSE(broken.is_error());
+    EXPECT_FALSE(broken.root()["a"].exists());
+    EXPECT_TRUE(broken.is_error());
+    // so are malformed scalars, when they are read
+    const simdjson::PaddedString bad_number("{\"x\": 1.2.3}");
+    auto& number = parser.iterate(bad_number);
+    EXPECT_FALSE(number.root()["x"].get_value<double>().has_value());
+    EXPECT_TRUE(number.is_error());
+    EXPECT_EQ(number.get_error_offset(), 6);
+    const simdjson::PaddedString bad_bool("{\"f\": truex}");
+    auto& boolean = parser.iterate(bad_bool);
+    EXPECT_FALSE(boolean.root()["f"].get_value<bool>().has_value());
+    EXPECT_EQ(boolean.get_error_code(), simdjson::error_code::INVALID_BOOL);
+    EXPECT_EQ(boolean.get_error_offset(), 6);
+  });
+}
+
+struct bound_point {
+  double x = 0;
+  double y = 0;
+};
+struct bound_shape {
+  std::string name;
+  uint32_t sides = 0;
+  bool closed = false;
+  std::vector<bound_point> points;
+  std::optional<int64_t> color;
+  std::vector<bool> flags;
+};
+
+template <>
+struct simdjson::JsonFields<bound_point> {
+  static constexpr auto fields = std::make_tuple(
+      json_field("x", &bound_point::x), json_field("y", &bound_point::y));
+};
+template <>
+struct simdjson::JsonFields<bound_shape> {
+  static constexpr auto fields = std::make_tuple(
+      json_field("name", &bound_shape::name),
+      json_field("sides", &bound_shape::sides),
+      json_field("closed", &bound_shape::closed),
+      json_field("points", &bound_shape::points),
+      json_field("color", &bound_shape::color),
+      json_field("flags", &bound_shape::flags));
+};
+
+// far more names than a struct has, still without a collision
+constexpr std::array<std::array<char, 2>, 120> kManyNames = [] {
+  std::array<std::array<char, 2>, 120> names{};
+  for (size_t i = 0; i < names.size(); i++) {
+    names[i] = {static_cast<char>('a' + i / 26),
+                static_cast<char>('a' + i % 26)};
+  }
+  return names;
+}();
+constexpr auto kManySlots = simdjson::find_field_slots([] {
+  std::array<std::string_view, kManyNames.size()> views;
+  for (size_t i = 0; i < views.size(); i++) {
+    views[i] = std::string_view(kManyNames[i].data(), kManyNames[i].size());
+  }
+  return views;
+}());
+static_assert(kManySlots.mask >= kManyNames.size() - 1);
+
+TEST(simdjson, parse_into) {
+  for_each_kernel([] {
+    simdjson::JsonParser parser;
+    simdjson::JsonParseError error;
+    auto shape = parser.parse_into<bound_shape>(
+        simdjson::PaddedString(
+            "{\"name\": \"tri\\nangle\", \"unknown\": {\"name\": [1, 2]}, "
+            "\"sides\": 3, \"closed\": true, \"color\": null, "
+            "\"points\": [{\"x\": 0, \"y\": 1.5}, {\"y\": -2, \"z\": 9}], "
+            "\"flags\": [true, false]}"),
+        error);
+    ASSERT_TRUE(error.empty()) << error;
+    EXPECT_EQ(shape.name, "tri\nangle");
+    EXPECT_EQ(shape.sides, 3);
+    EXPECT_TRUE(shape.closed);
+    EXPECT_FALSE(shape.color.has_value());
+    ASSERT_EQ(shape.points.size(), 2);
+    EXPECT_EQ(shape.points[0].y, 1.5);
+    EXPECT_EQ(shape.points[1].x, 0);
+    EXPECT_EQ(shape.points[1].y, -2);
+    EXPECT_EQ(shape.flags, std::vector<bool>({true, false}));
+
+    auto points = parser.parse_into<std::vector<bound_point>>(
+        simdjson::PaddedString("[{\"x\": 1e3}, {\"x\": 18446744073709551615}]"),
+        error);
+    ASSERT_TRUE(error.empty()) << error;
+    EXPECT_EQ(points[0].x, 1000);
+    EXPECT_EQ(points[1].x, 18446744073709551615.0);
+
+    // the member that failed is named, out of range integers fail
+    parser.parse_into<bound_shape>(
+        simdjson::PaddedString("{\"points\": [{\"x\": \"1\"}]}"), error);
+    EXPECT_EQ(error, "Unexpected type for member 'x'");
+    parser.parse_into<bound_shape>(
+        simdjson::PaddedString("{\"sides\": -1}"), error);
+    EXPECT_EQ(error, "Unexpected type for member 'sides'");
+    // a malformed member reports the error of the document instead
+    parser.parse_into<bound_shape>(
+        simdjson::PaddedString("{\"points\": [{\"x\": 1.2.3}]}"), error);
+    EXPECT_EQ(error,
+              (simdjson::JsonError{simdjson::error_code::INVALID_NUMBER, 18})
+                  .message());
+    parser.parse_into<bound_shape>(simdjson::PaddedString("[]"), error);
+    EXPECT_EQ(error, "Unexpected type at the root");
+    parser.parse_into<bound_shape>(simdjson::PaddedString("{\"name\" 1}"),
+                                   error);
+    EXPECT_FALSE(error.empty());
+  });
+}
+
+TEST(simdjson, parse_stats) {
+  const std::string json =
+      "{\"a\": [1, -2.5, \"s\\n\", true, null], \"b\": {\"c\": {}}, "
+      "\"long key name\": \"a string longer than the small buffer\"}";
+  auto expect_counts = [](const simdjson::ParseStats& stats, size_t parses) {
+    EXPECT_EQ(stats.parses, parses);
+    EXPECT_EQ(stats.objects, 3 * parses);
+    EXPECT_EQ(stats.arrays, parses);
+    EXPECT_EQ(stats.keys, 4 * parses);
+    EXPECT_EQ(stats.strings, 2 * parses);
+    EXPECT_EQ(stats.numbers, 2 * parses);
+    EXPECT_EQ(stats.bools, parses);
+    EXPECT_EQ(stats.nulls, parses);
+    EXPECT_EQ(stats.max_depth, 3);
+    // "a" "s\n" "b" "c" "long key name" and the long string, raw
+    EXPECT_EQ(stats.string_bytes, (1 + 3 + 1 + 1 + 13 + 37) * parses);
+  };
+  for_each_kernel([&] {
+    simdjson::JsonParser parser;
+    simdjson::ParseStats stats;
+    parser.set_stats(&stats);
+    auto simd = parser.parse_simd_impl(json);
+    expect_counts(stats, 1);
+    EXPECT_EQ(stats.bytes, json.size());
+    EXPECT_GT(stats.allocations, 0);
+    EXPECT_GT(stats.allocated_bytes, 0);
+    EXPECT_GT(stats.first_pass.cycles, 0);
+    EXPECT_GT(stats.second_pass.time.count(), 0);
+    EXPECT_GT(stats.number_cycles + stats.string_cycles, 0);
+
+    auto normal = parser.parse_normal_impl(json);
+    expect_counts(stats, 2);
+    expect_same_json(simd, normal);
+
+    stats.reset();
+    const simdjson::PaddedString padded(json);
+    EXPECT_FALSE(parser.parse_document(padded).is_error());
+    simdjson::JsonParseError error;
+    parser.parse_node(json, error);
+    EXPECT_TRUE(error.empty());
+    expect_counts(stats, 2);
+    // the document reuses its buffers and nodes allocate from the heap
+    EXPECT_EQ(stats.allocations, 0);
+
+    // both parse_many count every document as a parse
+    stats.reset();
+    const simdjson::PaddedString lines(json + "\n" + json + "\n" + json);
+    size_t streamed = 0;
+    for (const auto& doc : parser.parse_many(lines, json.size() + 1)) {
+      EXPECT_FALSE(doc.is_error());
+      ++streamed;
+    }
+    EXPECT_EQ(streamed, 3);
+    expect_counts(stats, 3);
+    EXPECT_EQ(stats.bytes, lines.size());
+    EXPECT_GT(stats.first_pass.cycles, 0);
+    std::vector<simdjson::JsonDocument> documents;
+    EXPECT_EQ(parser.parse_many(lines, documents), 3);
+    expect_counts(stats, 6);
+    EXPECT_EQ(stats.bytes, 2 * lines.size());
+
+    // the trees built while counting outlive the counting
+    parser.set_stats(nullptr);
+    stats.reset();
+    auto again = parser.parse(json);
+    EXPECT_EQ(stats.parses, 0);
+    simd = again;
+    normal = std::move(again);
+    EXPECT_EQ(simd.dump(), normal.dump());
+
+    // a number is only its node, a failure allocates nothing
+    parser.set_stats(&stats);
+    EXPECT_TRUE(parser.parse_simd_impl("1").is_int64());
+    EXPECT_TRUE(parser.parse_normal_impl("[1").is_error());
+    EXPECT_EQ(stats.allocations, 1);
+    EXPECT_EQ(stats.allocated_bytes, sizeof(simdjson::JsonValue));
+  });
+}
+
+TEST(simdjson, path_query) {
+  using simdjson::JsonPath;
+  const simdjson::PaddedString json(
+      "{\"skip\": [{\"id\": 0}], \"a\": {\"b\": [10, {\"c\": \"x\"}, 30, 40]}, "
+      "\"a/b\": 1, \"m~n\": 2, \"\": 3, \"k\\\"q\": 4, \"7\": 5, "
+      "\"dup\": 1, \"dup\": 2}");
+  EXPECT_TRUE(JsonPath::from_pointer("a").is_error());
+  EXPECT_TRUE(JsonPath::from_pointer("/a~2").is_error());
+  EXPECT_TRUE(JsonPath::from_expression("a.b").is_error());
+  EXPECT_TRUE(JsonPath::from_expression("$.").is_error());
+  EXPECT_TRUE(JsonPath::from_expression("$[01]").is_error());
+  EXPECT_TRUE(JsonPath::from_expression("$['a]").is_error());
+  EXPECT_EQ(JsonPath::from_expression("$.a['b'][3]").size(), 3);
+  for_each_kernel([&] {
+    simdjson::JsonParser parser;
+    auto& doc = parser.iterate(json);
+    EXPECT_TRUE(JsonPath::from_pointer("").find(doc).is_object());
+    EXPECT_TRUE(JsonPath::from_expression("$").find(doc).is_object());
+    EXPECT_EQ(JsonPath::from_pointer("/a/b/3").find(doc).get_value<int64_t>(),
+              40);
+    EXPECT_EQ(JsonPath::from_expression("$.a.b[3]")
+                  .find(doc)
+                  .get_value<int64_t>(),
+              40);
+    EXPECT_EQ(JsonPath::from_expression("$[\"a\"]['b'][1].c")
+                  .find(doc)
+                  .get_value<std::string_view>(),
+              "x");
+    EXPECT_EQ(JsonPath::from_pointer("/a~1b").find(doc).get_value<int64_t>(),
+              1);
+    EXPECT_EQ(JsonPath::from_pointer("/m~0n").find(doc).get_value<int64_t>(),
+              2);
+    EXPECT_EQ(JsonPath::from_pointer("/").find(doc).get_value<int64_t>(), 3);
+    EXPECT_EQ(JsonPath::from_expression("$['k\\\"q']")
+                  .find(doc)
+                  .get_value<int64_t>(),
+              4);
+    // a pointer token is a key in an object and an index in an array
+    EXPECT_EQ(JsonPath::from_pointer("/7").find(doc).get_value<int64_t>(), 5);
+    EXPECT_FALSE(JsonPath::from_expression("$[7]").find(doc).exists());
+    EXPECT_FALSE(JsonPath::from_pointer("/a/b/4").find(doc).exists());
+    EXPECT_FALSE(JsonPath::from_pointer("/a/b/-").find(doc).exists());
+    EXPECT_FALSE(JsonPath::from_pointer("/a/x").find(doc).exists());
+    EXPECT_FALSE(JsonPath::from_pointer("/a/b/0/c").find(doc).exists());
+
+    simdjson::JsonQuery query;
+    EXPECT_EQ(query.add(JsonPath::from_pointer("/a/b/3")), 0);
+    EXPECT_EQ(query.add(JsonPath::from_expression("$.a.b[1].c")), 1);
+    EXPECT_EQ(query.add(JsonPath::from_pointer("/missing")), 2);
+    EXPECT_EQ(query.add(JsonPath::from_pointer("bad")), 3);
+    EXPECT_EQ(query.add(JsonPath::from_pointer("/dup")), 4);
+    EXPECT_EQ(query.add(JsonPath::from_pointer("/a")), 5);
+    EXPECT_EQ(query.add(JsonPath::from_pointer("/a/b/0")), 6);
+    EXPECT_EQ(query.size(), 7);
+    std::vector<simdjson::OnDemandValue> results;
+    query.evaluate(doc, results);
+    ASSERT_EQ(results.size(), 7);
+    EXPECT_EQ(results[0].get_value<int64_t>(), 40);
+    EXPECT_EQ(results[1].get_value<std::string_view>(), "x");
+    EXPECT_FALSE(results[2].exists());
+    EXPECT_FALSE(results[3].exists());
+    EXPECT_EQ(results[4].get_value<int64_t>(), 1);
+    EXPECT_TRUE(results[5].is_object());
+    EXPECT_EQ(results[6].get_value<int64_t>(), 10);
+    EXPECT_FALSE(doc.is_error());
+
+    // a broken document matches nothing
+    query.evaluate(parser.iterate(simdjson::PaddedString("{\"a\": [")),
+                   results);
+    EXPECT_FALSE(results[5].exists());
+  });
+}
+
+TEST(simdjson, parse_many_batches) {
+  // whitespace-separated documents, some spanning several lines
+  std::string content;
+  for (int i = 0; i < 200; i++) {
+    content += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\\nb\"]}\n";
+    content += "[\n  " + std::to_string(i) + ",\n  {\"x\": \"y\"}\n]\n";
+    content += "\"s\" " + std::to_string(i) + "\n\n";
+  }
+  const simdjson::PaddedString json(content);
+  simdjson::JsonParser parser;
+  for (size_t batch_size :
+       {size_t(1), size_t(7), size_t(100), size_t(1) << 20}) {
+    SCOPED_TRACE(batch_size);
+    size_t count = 0;
+    for (const auto& doc : parser.parse_many(json, batch_size)) {
+      ASSERT_FALSE(doc.is_error()) << doc.get_error();
+      const auto root = doc.root();
+      const int64_t i = count / 4;
+      switch (count % 4) {
+        case 0:
+          EXPECT_EQ(root["id"].get_value<int64_t>(), i);
+          EXPECT_EQ(root["tags"][0].get_value<std::string_view>(), "a\nb");
+          break;
+        case 1:
+          EXPECT_EQ(root[0].get_value<int64_t>(), i);
+          EXPECT_EQ(root[1]["x"].get_value<std::string_view>(), "y");
+          break;
+        case 2:
+          EXPECT_EQ(root.get_value<std::string_view>(), "s");
+          break;
+        default:
+          EXPECT_EQ(root.get_value<int64_t>(), i);
+      }
+      ++count;
+    }
+    EXPECT_EQ(count, 800);
+  }
+
+  // the stream stops after the first broken document
+  const simdjson::PaddedString broken("[1]\n[2,]\n[3]\n");
+  std::vector<bool> errors;
+  for (const auto& doc : parser.parse_many(broken, 4)) {
+    errors.push_back(doc.is_error());
+  }
+  EXPECT_EQ(errors, (std::vector<bool>{false, true}));
+  const simdjson::PaddedString unclosed("{\"a\": [1,\n2]\n");
+  for (const auto& doc : parser.parse_many(unclosed, 4)) {
+    EXPECT_TRUE(doc.is_error());
+  }
+  const simdjson::PaddedString empty(" \n\n ");
+  EXPECT_EQ(parser.parse_many(empty).begin(), std::default_sentinel);
+}
+
+TEST(simdjson, parse_columns) {
+  using simdjson::JsonColumnType;
+  for_each_kernel([] {
     simdjson::JsonParser parser;
+    simdjson::JsonColumns columns;
+    columns.add_column("id", JsonColumnType::INT64)
+        .add_column("name", JsonColumnType::STRING)
+        .add_column("rating", JsonColumnType::DOUBLE)
+        .add_column("active", JsonColumnType::BOOL);
+    const simdjson::PaddedString json(
+        "{\"id\": 1, \"name\": \"a\\\"b\", \"skip\": {\"x\": [1, {}]}, "
+        "\"rating\": 4, \"active\": true}\n"
+        "{\"active\": false, \"rating\": 2.5, \"id\": 2, \"n\\u0061me\": "
+        "\"\"}\n"
+        "{\"id\": null, \"extra\": [[]], \"name\": \"first\", "
+        "\"name\": \"last\"}\n"
+        "{}\n");
+    ASSERT_EQ(parser.parse_columns(json, columns), 4);
+    ASSERT_FALSE(columns.is_error()) << columns.get_error();
+    ASSERT_EQ(columns.row_count(), 4);
+
+    const simdjson::JsonColumn& id = *columns.find("id");
+    EXPECT_EQ(id.size(), 4);
+    EXPECT_EQ(id.null_count(), 2);
+    EXPECT_EQ(std::vector<int64_t>(id.int64_values().begin(),
+                                   id.int64_values().end()),
+              (std::vector<int64_t>{1, 2, 0, 0}));
+    EXPECT_EQ(id.validity(), (std::vector<uint8_t>{0b0011}));
+
+    const simdjson::JsonColumn& name = columns[1];
+    EXPECT_EQ(name.string_at(0), "a\"b");
+    EXPECT_TRUE(name.is_valid(1));
+    EXPECT_EQ(name.string_at(1), "");
+    // the last of duplicate members wins
+    EXPECT_EQ(name.string_at(2), "last");
+    EXPECT_FALSE(name.is_valid(3));
+    EXPECT_EQ(std::vector<int64_t>(name.offsets().begin(),
+                                   name.offsets().end()),
+              (std::vector<int64_t>{0, 3, 3, 7, 7}));
+    EXPECT_EQ(std::string_view(name.data().data(), name.data().size()),
+              "a\"blast");
+
+    const simdjson::JsonColumn& rating = columns[2];
+    EXPECT_EQ(rating.double_at(0), 4.0);
+    EXPECT_EQ(rating.double_at(1), 2.5);
+    EXPECT_EQ(rating.null_count(), 2);
+    const simdjson::JsonColumn& active = columns[3];
+    EXPECT_EQ(active.bool_values(), (std::vector<uint8_t>{0b0001}));
+    EXPECT_EQ(active.validity(), (std::vector<uint8_t>{0b0011}));
+    EXPECT_EQ(columns.find("skip"), nullptr);
+
+    // array records by position, appended to the rows so far across
+    // batches of the index
+    simdjson::JsonColumns positions;
+    positions.add_column(size_t(2), JsonColumnType::STRING)
+        .add_column(size_t(0), JsonColumnType::INT64);
     std::string content;
-    ifs >> content;
-    auto json_obj = parser.parse(content);
-    ASSERT_FALSE(json_obj.is_error());
-    ASSERT_TRUE(json_obj.is_array());
+    for (int i = 0; i < 50000; i++) {
+      content += "[" + std::to_string(i) + ", {\"nested\": [1, 2, 3]}, \"v" +
+                 std::to_string(i) + "\", 4]\n";
+    }
+    const simdjson::PaddedString rows(content);
+    ASSERT_GT(rows.size(), simdjson::kDefaultBatchSize);
+    EXPECT_EQ(parser.parse_columns(rows, positions), 50000);
+    EXPECT_EQ(parser.parse_columns(rows, positions), 50000);
+    ASSERT_FALSE(positions.is_error()) << positions.get_error();
+    EXPECT_EQ(positions.row_count(), 100000);
+    EXPECT_EQ(positions[0].string_at(54321), "v4321");
+    EXPECT_EQ(positions[1].int64_at(99999), 49999);
+    EXPECT_EQ(positions[1].null_count(), 0);
+
+    // a value of the wrong type fails the record, the rows before it stay
+    columns.clear();
+    const simdjson::PaddedString mismatch(
+        "{\"id\": 1}\n{\"id\": 2, \"name\": 3}\n{\"id\": 3}\n");
+    EXPECT_EQ(parser.parse_columns(mismatch, columns), 1);
+    EXPECT_EQ(columns.get_error_code(), simdjson::error_code::UNEXPECTED_TYPE);
+    EXPECT_EQ(columns.get_error(), "Unexpected type at byte 28");
+    EXPECT_EQ(columns.row_count(), 1);
+    EXPECT_EQ(columns[1].size(), 1);
+    EXPECT_EQ(columns[1].offsets().size(), 2);
+    for (const char* broken :
+         {"{\"id\": 1.5}", "{\"id\": 9223372036854775808}", "[1]\n3\n",
+          "{\"skip\": [1, 2}", "{\"id\": 1,}", "{\"id\" 1}",
+          "{\"id\": nullx}", "{\"active\": truex}"}) {
+      columns.clear();
+      parser.parse_columns(simdjson::PaddedString(broken), columns);
+      EXPECT_TRUE(columns.is_error()) << broken;
+    }
+  });
+}
+
+// the events of a JsonPushParser as text
+class push_recorder : public simdjson::JsonPushHandler {
+ public:
+  void start_object() override { events += "{"; }
+  void end_object() override { events += "}"; }
+  void start_array() override { events += "["; }
+  void end_array() override { events += "]"; }
+  void key(std::string_view key) override {
+    events += "k:" + std::string(key) + ";";
+  }
+  void string(std::string_view value) override {
+    events += "s:" + std::string(value) + ";";
+  }
+  void number(int64_t value) override {
+    events += "i:" + std::to_string(value) + ";";
+  }
+  void number(uint64_t value) override {
+    events += "u:" + std::to_string(value) + ";";
+  }
+  void number(double value) override {
+    events += "d:" + std::to_string(value) + ";";
+  }
+  void boolean(bool value) override { events += value ? "T" : "F"; }
+  void null() override { events += "N"; }
+  void end_document() override { events += "|"; }
+
+  std::string events;
+};
+
+TEST(simdjson, push_parser) {
+  const std::string json =
+      "{\"id\": 12345, \"name\": \"a\\\"b\\u00e9\\ud83d\\ude00\xc3\xa9\", "
+      "\"list\": [true, false, null, -1.5e3, 18446744073709551615, []], "
+      "\"empty\": {}}\n[\"x\"] 42 \"s\"\n-7";
+  const std::string expected =
+      "{k:id;i:12345;k:name;s:a\"b\xc3\xa9\xf0\x9f\x98\x80\xc3\xa9;k:list;[TFN"
+      "d:-1500.000000;u:18446744073709551615;[]]k:empty;{}}|[s:x;]|i:42;|s:s;"
+      "|i:-7;|";
+  {
+    push_recorder whole;
+    simdjson::JsonPushParser parser(whole);
+    ASSERT_TRUE(parser.feed(json)) << parser.get_error();
+    // the last number may go on
+    EXPECT_EQ(parser.document_count(), 4);
+    ASSERT_TRUE(parser.finish()) << parser.get_error();
+    EXPECT_EQ(parser.document_count(), 5);
+    EXPECT_EQ(whole.events, expected);
+  }
+  // every split point, then one byte at a time
+  for (size_t split = 0; split <= json.size(); split++) {
+    SCOPED_TRACE(split);
+    push_recorder split_events;
+    simdjson::JsonPushParser parser(split_events);
+    ASSERT_TRUE(parser.feed(std::string_view(json).substr(0, split)));
+    ASSERT_TRUE(parser.feed(std::string_view(json).substr(split)));
+    ASSERT_TRUE(parser.finish());
+    EXPECT_EQ(split_events.events, expected);
+  }
+  push_recorder bytes;
+  simdjson::JsonPushParser parser(bytes);
+  for (char c : json) {
+    ASSERT_TRUE(parser.feed(std::string_view(&c, 1))) << parser.get_error();
+  }
+  ASSERT_TRUE(parser.finish());
+  EXPECT_EQ(bytes.events, expected);
+
+  // events come as soon as their bytes arrived
+  push_recorder partial;
+  simdjson::JsonPushParser streaming(partial);
+  ASSERT_TRUE(streaming.feed("[{\"a\": tr"));
+  EXPECT_EQ(partial.events, "[{k:a;");
+  ASSERT_TRUE(streaming.feed("ue}, 1"));
+  EXPECT_EQ(partial.events, "[{k:a;T}");
+  ASSERT_TRUE(streaming.feed("0]"));
+  EXPECT_EQ(partial.events, "[{k:a;T}i:10;]|");
+
+  // errors stop the parser at the failing byte
+  for (const auto& [input, offset] :
+       std::vector<std::pair<std::string, size_t>>{{"[1,]", 3},
+                                                   {"{\"a\" 1}", 5},
+                                                   {"[\"\\x\"]", 3},
+                                                   {"[\"\xc0\xaf\"]", 2},
+                                                   {"[\"\\udc00\"]", 7},
+                                                   {"[trux]", 4},
+                                                   {"1 2x", 3},
+                                                   {"[1}", 2}}) {
+    SCOPED_TRACE(input);
+    push_recorder failing;
+    simdjson::JsonPushParser broken(failing);
+    EXPECT_FALSE(broken.feed(input));
+    EXPECT_TRUE(broken.is_error());
+    EXPECT_EQ(broken.offset(), offset);
+    EXPECT_FALSE(broken.feed("[]"));
+  }
+  // a number spanning chunks fails at its first byte
+  push_recorder split;
+  simdjson::JsonPushParser numbers(split);
+  ASSERT_TRUE(numbers.feed("[10, 1.5e"));
+  EXPECT_FALSE(numbers.feed("999, 2]"));
+  EXPECT_EQ(numbers.get_error_code(),
+            simdjson::error_code::NUMBER_OUT_OF_RANGE);
+  EXPECT_EQ(numbers.offset(), 5);
+  numbers.reset();
+  ASSERT_TRUE(numbers.feed("[1"));
+  ASSERT_TRUE(numbers.feed("0, -"));
+  EXPECT_FALSE(numbers.feed("x]"));
+  EXPECT_EQ(numbers.offset(), 5);
+  numbers.reset();
+  ASSERT_TRUE(numbers.feed("1."));
+  EXPECT_FALSE(numbers.finish());
+  EXPECT_EQ(numbers.offset(), 0);
+    for (const std::string input : {"{\"a\": [1", "\"abc", "nu", "[1.5e"}) {
+    SCOPED_TRACE(input);
+    push_recorder failing;
+    simdjson::JsonPushParser unfinished(failing);
+    EXPECT_TRUE(unfinished.feed(input));
+    EXPECT_FALSE(unfinished.finish());
+  }
+}
+
+TEST(simdjson, parallel_ingest) {
+  std::string content;
+  const int64_t records = 5000;
+  for (int64_t i = 0; i < records; i++) {
+    content += "{\"id\": " + std::to_string(i) + ", \"name\": \"n" +
+               std::to_string(i) + "\"}\n";
+  }
+  const simdjson::PaddedString json(content);
+  simdjson::ParallelOptions options;
+  options.threads = 4;
+  options.chunk_size = 1024;
+  options.queue_depth = 3;
+
+  // ordered: every record in input order, chunk after chunk
+  simdjson::JsonParallelReader reader(json, options);
+  EXPECT_GT(reader.chunk_count(), 4);
+  int64_t expected = 0;
+  size_t index = 0;
+  while (const auto* chunk = reader.next()) {
+    EXPECT_EQ(chunk->index, index++);
+    for (const auto& doc : *chunk) {
+      ASSERT_FALSE(doc.is_error());
+      EXPECT_EQ(doc.root()["id"].get_value<int64_t>(), expected++);
+    }
   }
-}
\ No newline at end of file
+  EXPECT_EQ(expected, records);
+  EXPECT_EQ(reader.next(), nullptr);
+
+  // unordered: every record exactly once
+  std::mutex mutex;
+  std::vector<int> seen(records, 0);
+  simdjson::parse_parallel(
+      json,
+      [&](const simdjson::JsonChunk& chunk) {
+        std::lock_guard lock(mutex);
+        for (const auto& doc : chunk) {
+          seen[doc.root()["id"].get_value<int64_t>()]++;
+        }
+      },
+      options);
+  EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), records);
+
+  // a reader dropped early stops its workers
+  simdjson::JsonParallelReader partial(json, options);
+  EXPECT_NE(partial.next(), nullptr);
+}
+
+TEST(simdjson, parse_file) {
+  const std::string path =
+      std::string(__FILE_PATH__) + "/local_large_json/simple_array.json";
+  std::ifstream ifs(path);
+  ASSERT_TRUE(ifs.is_open());
+  std::string content((std::istreambuf_iterator<char>(ifs)),
+                      std::istreambuf_iterator<char>());
+  for (auto mode : {simdjson::FileLoad::MMAP, simdjson::FileLoad::READ,
+                    simdjson::FileLoad::HUGE_PAGE_READ}) {
+    simdjson::PaddedString json;
+    ASSERT_TRUE(json.load(path, mode));
+    EXPECT_EQ(json.view(), content);
+    simdjson::JsonParser parser;
+    const auto& doc = parser.parse_document(json);
+    ASSERT_FALSE(doc.is_error());
+    EXPECT_EQ(doc.root()[9]["id"].get_value<int64_t>(), 10);
+  }
+
+  simdjson::JsonParser parser;
+  auto json_obj = parser.parse_file(path);
+  ASSERT_TRUE(json_obj.is_array());
+  EXPECT_EQ(json_obj[0]["city"].get_value<std::string>(), "beijing");
+  simdjson::PaddedString missing;
+  EXPECT_FALSE(missing.load(path + ".missing"));
+  EXPECT_FALSE(parser.parse_file(path + ".missing").is_array());
+
+  // parse takes a view, no std::string needed
+  const std::string_view text = "[1, 2] trailing";
+  auto array = parser.parse(text.substr(0, 6));
+  ASSERT_TRUE(array.is_array());
+  EXPECT_EQ(array[1].get_value<int64_t>(), 2);
+}
+
+TEST(simdjson, arena_parse) {
+  std::ifstream ifs(std::string(__FILE_PATH__) +
+                    "/local_large_json/simple_array.json");
+  ASSERT_TRUE(ifs.is_open());
+  std::string content((std::istreambuf_iterator<char>(ifs)),
+                      std::istreambuf_iterator<char>());
+  for_each_kernel([&] {
+    simdjson::JsonParser parser;
+    parser.parse_in_arena(content);
+    parser.parse_in_arena(content);
+    const size_t chunks = parser.arena().chunk_count();
+    EXPECT_EQ(chunks, 1);
+    // once warm, every node comes from the arena: the default resource
+    // refuses to allocate
+    auto* previous =
+        std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    for (int round = 0; round < 3; round++) {
+      auto& json_obj = parser.parse_in_arena(content);
+      ASSERT_TRUE(json_obj.is_array());
+      EXPECT_EQ(json_obj[9]["id"].get_value<int64_t>(), 10);
+    }
+    std::pmr::set_default_resource(previous);
+    EXPECT_EQ(parser.arena().chunk_count(), chunks);
+    EXPECT_GT(parser.arena().used(), 0);
+
+    // a copy leaves the arena and outlives the next parse
+    auto copy = parser.parse_in_arena("{\"key\": [\"value\"]}");
+    parser.parse_in_arena("[]");
+    EXPECT_EQ(copy["key"][0].get_value<std::string>(), "value");
+  });
+}